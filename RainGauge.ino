@@ -13,6 +13,9 @@
 
 #include "inc/WifiManager.h"
 #include "inc/MqttMessageQueue.h"
+#include "inc/MqttRtcStorage.h"
+#include "inc/FlashSpillLog.h"
+#include "inc/CompressedBatch.h"
 #include "inc/Rain.h"
 #include "inc/Battery.h"
 #include "inc/SoilTemp.h"
@@ -22,71 +25,117 @@
 #include "inc/Utils.h"
 #include "inc/SensorScheduler.h"
 #include "inc/NTPSync.h"
+#include "inc/PhaseTrace.h"
+#include "inc/TransmitPolicy.h"
 
 #define DEBUG_MODE_PIN 12
 #define GND_TMP_PIN 33
 #define BATTERY_PIN A1
 #define RAIN_PIN 27
 
-#define MQTT_QUEUE_LENGTH 10
+#define MQTT_QUEUE_LENGTH 40
+#define MQTT_COMPACT_WATERMARK 30  // compress queued readings once this many pile up offline
+#define TRACE_REPORT_WAKES 30
+#define TX_QUEUE_WATERMARK 16                 // buffered readings that trigger a transmit wake
+#define TX_MAX_LATENCY_MS (15UL * 60 * 1000)  // max time readings wait with the radio off
+#define RADIO_WAKE_BUDGET_MS 10000            // wifi + ntp + mqtt, then give up and keep buffering
+#define MQTT_MAX_ATTEMPTS 3
+#define MQTT_RETRY_DELAY_MS 500
+#define MQTT_KEEPALIVE_S (RADIO_WAKE_BUDGET_MS / 1000 + 5)  // no PINGREQ needed within one wake
 
 const char *topic = "backyard/test/";
 
-MqttMessageQueue<MQTT_QUEUE_LENGTH> mqtt_queue;  // max 10 messages
+// messages kept in RTC memory survive deep sleep until the next successful MQTT connection
+// (use MsgPackEncoder instead of JsonEncoder for compact binary payloads on "<topic>msgpack")
+typedef MqttMessageQueue<MQTT_QUEUE_LENGTH, MqttRtcStorage, JsonEncoder> SensorQueue;
+SensorQueue mqtt_queue;  // max 40 messages / MQTT_RTC_QUEUE_BYTES
+FlashSpillLog spillLog;  // overflow tier for long broker outages
+CompressedBatch offlineBatch;  // delta-compressed readings from long offline runs (RTC)
 WiFiManager wifi(WIFI_SSID, WIFI_PASSWORD);
 WiFiClient espclient;
 PubSubClient pub(espclient);
 
 
-//connect to wifi
+//per-device MQTT client id, "raingauge-<mac>"
+char mqttClientId[24] = "";
+
+//one deadline for the whole radio bring-up of a wake
+unsigned long radioDeadline = 0;
+
+unsigned long radioBudgetLeft() {
+  long left = (long)(radioDeadline - millis());
+  return (left > 0) ? (unsigned long)left : 0;
+}
+
+//connect to wifi, starts the radio deadline
 void connectToWifi(){
 
   Serial.printf("(%dms) WIFI...",millis());
+  radioDeadline = millis() + RADIO_WAKE_BUDGET_MS;
   wifi.setStaticIP(LOCAL_IP,GATEWAY_IP, SUBNET_MASK, DNS_SERVER);
   wifi.setFastConnect(WIFI_BSSID, WIFI_CHANNEL);
-  wifi.connect(bootCount);
+  wifi.connect(radioBudgetLeft());
 
 }
 
-//connect to mqtt
+//connect to mqtt within what is left of the radio deadline
 bool connectToMqtt() {
 
   bool ret = false;
 
+  if (!WiFi.isConnected()) {
+    Serial.printf("(%dms) MQTT skipped: WiFi not connected\n", millis());
+    return false;
+  }
+
+  if (mqttClientId[0] == '\0') {
+    uint8_t mac[6];
+    WiFi.macAddress(mac);
+    snprintf(mqttClientId, sizeof(mqttClientId), "raingauge-%02x%02x%02x%02x%02x%02x",
+             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+  }
+
   pub.setServer(mqtt_broker, mqtt_port);
+  pub.setBufferSize(MQTT_CLIENT_BUFFER_BYTES); // once, publishes never resize it
+  pub.setKeepAlive(MQTT_KEEPALIVE_S);
   Serial.printf("(%dms) MQTT...",millis());
   
   int attempts = 0;
-  const int maxAttempts = 5;
   
-  while (!pub.connected() && attempts < maxAttempts) {
+  while (!pub.connected() && attempts < MQTT_MAX_ATTEMPTS && radioBudgetLeft() > 0) {
     attempts++;
     
-    if (pub.connect("esp32Client")) {
-      Serial.print("CONNECTED.\n");
+    //don't wait for the CONNACK past the deadline
+    unsigned long timeoutS = (radioBudgetLeft() + 999) / 1000;
+    pub.setSocketTimeout(timeoutS < MQTT_SOCKET_TIMEOUT ? timeoutS : MQTT_SOCKET_TIMEOUT);
+    
+    if (pub.connect(mqttClientId)) {
+      Serial.printf("CONNECTED as %s.\n", mqttClientId);
       ret = true; 
     } else {
-      Serial.printf("mqtt failed, rc=%d (attempt %d/%d)\n", pub.state(), attempts, maxAttempts);
+      Serial.printf("mqtt failed, rc=%d (attempt %d/%d)\n", pub.state(), attempts, MQTT_MAX_ATTEMPTS);
       
-      if (attempts < maxAttempts) {
-        Serial.println("Reconnecting to WiFi...");
-        wifi.connect(bootCount);
-        Serial.println("Trying MQTT again in 5 seconds");
-        delay(5000);
-      } else {
-        Serial.println("Failed to connect to MQTT after 5 attempts");
+      if (!WiFi.isConnected()) {
+        Serial.println("WiFi lost, giving up");
+        break;
+      }
+      if (attempts < MQTT_MAX_ATTEMPTS && radioBudgetLeft() > MQTT_RETRY_DELAY_MS) {
+        delay(MQTT_RETRY_DELAY_MS);
       }
     }
   }
 
+  if (!ret) {
+    Serial.printf("(%dms) MQTT not connected within the wake budget, readings stay buffered\n", millis());
+  }
   return ret;
 }
 
 //sensors
-battery<MQTT_QUEUE_LENGTH> my_battery(BATTERY_PIN, &pub, &mqtt_queue, "backyard/test/");
-Raingauge<MQTT_QUEUE_LENGTH> rain_gauge(RAIN_PIN, &pub,&mqtt_queue,"backyard/test/");
-Tempsensor<MQTT_QUEUE_LENGTH> temp_sensor(GND_TMP_PIN, &pub,&mqtt_queue,"backyard/test/");
-bmp280sensor<MQTT_QUEUE_LENGTH> bmp_sensor(&pub,&mqtt_queue,"backyard/test/");
+battery<SensorQueue> my_battery(BATTERY_PIN, &pub, &mqtt_queue, "backyard/test/");
+Raingauge<SensorQueue> rain_gauge(RAIN_PIN, &pub,&mqtt_queue,"backyard/test/");
+Tempsensor<SensorQueue> temp_sensor(GND_TMP_PIN, &pub,&mqtt_queue,"backyard/test/");
+bmp280sensor<SensorQueue> bmp_sensor(&pub,&mqtt_queue,"backyard/test/");
 
 //OTA manager
 OTAManager ota;
@@ -100,9 +149,36 @@ SensorScheduler sensorScheduler;
 //NTP sync manager (US Eastern timezone with DST)
 NTPSync ntpSync("EST5EDT,M3.2.0,M11.1.0"); // Sync on every internet connection
 
+//Per-wake phase timing
+PhaseTrace trace;
+
+//Sample vs transmit wake decisions
+TransmitPolicy transmitPolicy(TX_QUEUE_WATERMARK, TX_MAX_LATENCY_MS);
+
+//bring up wifi, ntp and mqtt; returns true if the broker is connected
+bool connectRadio() {
+  trace.begin(PHASE_WIFI);
+  connectToWifi();
+  trace.end(PHASE_WIFI);
+  
+  // NTP time synchronization on every internet connection
+  trace.begin(PHASE_NTP);
+  if (ntpSync.begin()) {
+    unsigned long ntpTimeout = (radioBudgetLeft() < 5000) ? radioBudgetLeft() : 5000; // 5 second timeout to save battery
+    ntpSync.sync(sensorScheduler.getCurrentWakeTime(), ntpTimeout);
+  }
+  trace.end(PHASE_NTP);
+  
+  trace.begin(PHASE_MQTT);
+  bool mqttConnected = connectToMqtt();
+  trace.end(PHASE_MQTT);
+  return mqttConnected;
+}
+
 
 void setup() {
   ++bootCount;
+  trace.onWake();
 
   //setup Serial
   Serial.begin(115200);
@@ -121,6 +197,11 @@ void setup() {
   //report persistent data
   Serial.println("Boot count: " + String(bootCount) + "\nRain count: " + String(latest_Raincount));
 
+  //attach flash overflow tier to the RTC queue
+  if (spillLog.begin()) {
+    mqtt_queue.setSpill(&spillLog);
+  }
+
   //setup sensors with scheduler
   Serial.printf("(%dms) Setting up... yawn.. i need a coffee.\n", millis());
   sensorScheduler.addSensor(&my_battery);
@@ -129,38 +210,107 @@ void setup() {
   sensorScheduler.addSensor(&bmp_sensor);
 
   // Sleep timer will be configured dynamically in loop() based on sensor needs
-  // Still need to configure rain pin for ext0 wakeup
-  esp_sleep_enable_ext0_wakeup((gpio_num_t)RAIN_PIN, 0);
+  // Rain tips are counted by the ULP, or wake the CPU via ext0 (see Raingauge::begin)
 
 }
 
 
 void loop() {
 
-  //handle sensors
-  if (sensorScheduler.hasDataToSend()) {
-    
-    connectToWifi();
-    
-    // NTP time synchronization on every internet connection
-    if (ntpSync.begin()) {
-      ntpSync.sync(sensorScheduler.getCurrentWakeTime(), 5000); // 5 second timeout to save battery
+  unsigned long now = sensorScheduler.getCurrentWakeTime();
+  bool sampleDue = sensorScheduler.hasDataToSend();
+  bool mqttConnected = false;
+
+  //start sensor conversions first so they run side by side (and while the radio comes up on a radio-first wake)
+  if (sampleDue) {
+    sensorScheduler.prepareDueSensors();
+  }
+
+  //readings need a valid clock, so bring the radio up before sampling until NTP has synced
+  //(unless the connection backoff holds the radio off during an outage)
+  bool radioFirst = sampleDue && !ntpSync.isTimeValid() && !transmitPolicy.inBackoff(now);
+  if (radioFirst) {
+    mqttConnected = connectRadio();
+  }
+
+  //sample wake: collect sensor data from all ready sensors into the RTC queue
+  if (sampleDue) {
+    sensorScheduler.printStatus();
+    trace.begin(PHASE_SENSORS);
+    sensorScheduler.checkAndUpdateAll();
+    trace.end(PHASE_SENSORS);
+  }
+
+  //transmit wake: only bring up the radio when the transmit policy asks for it
+  size_t buffered = mqtt_queue.size() + offlineBatch.count();
+  if (radioFirst || transmitPolicy.transmitDue(buffered, now, sensorScheduler.hasPriorityData())) {
+    if (!radioFirst) {
+      mqttConnected = connectRadio();
     }
-    
-    if(connectToMqtt()){
-      
-      //collect sensor data from all ready sensors
-      sensorScheduler.printStatus();
-      sensorScheduler.checkAndUpdateAll();
 
-      //send data to mqtt broker
-      sendQueuedMessages(pub, mqtt_queue);
+    if(mqttConnected){
+
+      //queue phase timing and wifi connect summaries every TRACE_REPORT_WAKES wakes
+      if (trace.reportDue(TRACE_REPORT_WAKES)) {
+        trace.publishSummary(&mqtt_queue, topic);
+        wifi.publishStats(&mqtt_queue, topic);
+      }
+
+      //queue sensor faults and recoveries, wakes saved and radio sessions
+      if (sensorScheduler.healthReportDue()) {
+        sensorScheduler.publishHealth(&mqtt_queue, topic, transmitPolicy.radioSessions());
+      }
+
+      //report the outage that just ended
+      if (transmitPolicy.outageReportDue()) {
+        transmitPolicy.publishOutage(&mqtt_queue, topic, now);
+      }
+
+      //send data to mqtt broker, oldest (compressed) readings first
+      trace.begin(PHASE_PUBLISH);
+      //nothing is dropped before the broker confirmed receipt (QoS 0 has no PUBACK)
+      bool batchSent = offlineBatch.count() > 0 && offlineBatch.publish(pub, topic);
+      bool tipsSent = rain_gauge.publishTipLog();
+      //one PINGREQ round-trip after the last publish confirms all of them
+      PublishStats sent = sendBatchedMessages(pub, mqtt_queue, &espclient, BATCH_ARRAY, batchSent || tipsSent);
+      if (sent.confirmed) {
+        if (batchSent) offlineBatch.clear();
+        if (tipsSent) rain_gauge.clearTipLog();
+      }
+      pub.disconnect(); // clean DISCONNECT, the broker does not wait out the keepalive
+      trace.end(PHASE_PUBLISH);
+
+      //only a confirmed, fully drained upload resets the transmit timer
+      if (mqtt_queue.isEmpty() && offlineBatch.count() == 0 && !rain_gauge.tipLogPending()) {
+        transmitPolicy.markTransmitted(now);
+      } else {
+        Serial.printf("Upload incomplete: %u msgs sent, %u left queued, tip log %s\n",
+                      (unsigned)sent.messages, (unsigned)(mqtt_queue.size() + offlineBatch.count()),
+                      rain_gauge.tipLogPending() ? "unconfirmed" : "sent");
+        transmitPolicy.markFailed(now);
+      }
+    } else {
+      transmitPolicy.markFailed(now);
+      Serial.printf("MQTT offline: %u messages kept for next wake\n", (unsigned)mqtt_queue.size());
+      if (spillLog.count() > 0) {
+        spillLog.printStats();
+      }
     }
   }
 
+  //fold readings into the compressed batch while they wait for upload
+  if (!mqttConnected && mqtt_queue.size() >= MQTT_COMPACT_WATERMARK) {
+    offlineBatch.compact(mqtt_queue, topic);
+  }
+
   //handle debug mode or dynamic deep sleep
   unsigned long sleepTime = sensorScheduler.getNextWakeTime();
+  unsigned long transmitDeadline = transmitPolicy.timeUntilDeadline(mqtt_queue.size() + offlineBatch.count(), now);
+  if (transmitDeadline < sleepTime) {
+    sleepTime = transmitDeadline; // wake for the max latency deadline even if no sensor is due
+  }
   sensorScheduler.prepareSleep(sleepTime);
+  spillLog.sync(); // spilled messages must be on flash before RAM is lost
   
   // Configure dynamic sleep timer based on sensor needs
   esp_err_t ret = esp_sleep_enable_timer_wakeup(1000000ULL * (sleepTime / 1000));
@@ -168,6 +318,11 @@ void loop() {
     Serial.println("WARNING: Sleep timer arg out of bounds");
   }
   Serial.printf("ESP32 to sleep for %lu ms\n", sleepTime);
+
+  if (!dm.getDebugMode()) {
+    trace.record(PHASE_AWAKE, 0, micros());
+    trace.printWake();
+  }
   
   dm.handle(sleepTime);
 
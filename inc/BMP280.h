@@ -6,6 +6,11 @@
 #include "inc/MqttMessageQueue.h"
 #include "inc/BaseSensor.h"
 
+#ifndef BMP280_MEASUREMENT_MS
+#define BMP280_MEASUREMENT_MS 45       // max forced conversion, 2x temp and 16x pressure oversampling
+#endif
+#define BMP280_STATUS_MEASURING 0x08   // status register bit 3, set while converting
+
 // RTC persistent timing for BMP280 sensor
 RTC_DATA_ATTR unsigned long bmp280LastUpdate = 0;
 
@@ -16,7 +21,7 @@ Adafruit_BMP280 bmp; // I2C
 
 /**
  * @brief BMP280 temperature and pressure sensor interface with MQTT integration
- * @tparam QUEUE_SIZE The size of the MQTT message queue
+ * @tparam Queue The MqttMessageQueue type used for message buffering
  * 
  * This template class provides a complete interface for the Bosch BMP280 
  * environmental sensor via I2C communication. Features:
@@ -24,6 +29,8 @@ Adafruit_BMP280 bmp; // I2C
  * - Temperature measurement with Celsius to Fahrenheit conversion
  * - Barometric pressure measurement in Pascals
  * - Forced measurement mode for power-efficient operation
+ * - Conversion started in prepare(), overlapping the other sensors' reads
+ *   (and radio bring-up on the wakes that connect first)
  * - Configurable oversampling and filtering for accuracy vs. speed
  * - Automatic MQTT message queuing for reliable data transmission
  * - Serial debug output with timestamps for monitoring
@@ -43,12 +50,28 @@ Adafruit_BMP280 bmp; // I2C
  * Essential for weather monitoring, altitude sensing, and environmental data logging
  * in battery-powered IoT applications.
  */
-template<size_t QUEUE_SIZE>
+template<class Queue>
 class bmp280sensor : public BaseSensor {
 
   PubSubClient* client;
-  MqttMessageQueue<QUEUE_SIZE>* tx_queue;
+  Queue* tx_queue;
   String topic;
+  bool healthy;     // false after begin() or a measurement failed
+  bool converting;  // forced conversion started and not read yet
+  unsigned long conversionStart;  // millis() when the conversion was started
+
+  /**
+   * @brief Writes the sampling configuration
+   * @param mode MODE_SLEEP to configure only, MODE_FORCED to also start
+   *        one conversion
+   */
+  void applySampling(Adafruit_BMP280::sensor_mode mode) {
+    bmp.setSampling(mode,                             /* Operating Mode. */
+                  Adafruit_BMP280::SAMPLING_X2,     /* Temp. oversampling */
+                  Adafruit_BMP280::SAMPLING_X16,    /* Pressure oversampling */
+                  Adafruit_BMP280::FILTER_X16,      /* Filtering. */
+                  Adafruit_BMP280::STANDBY_MS_500); /* Standby time. */
+  }
 
   public:
   /**
@@ -62,8 +85,8 @@ class bmp280sensor : public BaseSensor {
    * 
    * MQTT format: {"bmp_temperature": temp_f, "bmp_pressure": pressure_pa}
    */
-  bmp280sensor(PubSubClient* cli, MqttMessageQueue<QUEUE_SIZE>* q, String top)
-  :client(cli),tx_queue(q),topic(top)
+  bmp280sensor(PubSubClient* cli, Queue* q, String top)
+  :client(cli),tx_queue(q),topic(top),healthy(true),converting(false),conversionStart(0)
   {
 
   }
@@ -91,14 +114,15 @@ class bmp280sensor : public BaseSensor {
    * 4. Confirms successful initialization via serial output
    * 
    * Configuration Applied:
-   * - MODE_FORCED: Single measurement then sleep (ultra-low power)
+   * - MODE_SLEEP until prepare() or handle() forces a single measurement
    * - Temperature: 2x oversampling (±0.5°C accuracy, 16-bit resolution)
    * - Pressure: 16x oversampling (±0.12 hPa accuracy, 20-bit resolution)
    * - Digital Filter: 16x filtering (reduces noise from environmental vibration)
    * - Standby Time: 500ms between measurements in normal mode
    * 
    * Error Handling:
-   * - Enters infinite loop with error message if sensor not found
+   * - Marks the sensor unhealthy if it is not found; SensorScheduler then
+   *   disables it and retries begin() with backoff on later wakes
    * - Check I2C wiring, power supply, and address conflicts if initialization fails
    * 
    * Alternative address (0x76) configuration is commented but available for
@@ -110,15 +134,13 @@ class bmp280sensor : public BaseSensor {
     if (!bmp.begin()) {
         Serial.println(F("Could not find a valid BMP280 sensor, check wiring or "
                       "try a different address!"));
-        while (1) delay(10);
+        healthy = false;
+        return;
     }
+    healthy = true;
 
-    /* Default settings from datasheet. */
-    bmp.setSampling(Adafruit_BMP280::MODE_FORCED,     /* Operating Mode. */
-                  Adafruit_BMP280::SAMPLING_X2,     /* Temp. oversampling */
-                  Adafruit_BMP280::SAMPLING_X16,    /* Pressure oversampling */
-                  Adafruit_BMP280::FILTER_X16,      /* Filtering. */
-                  Adafruit_BMP280::STANDBY_MS_500); /* Standby time. */
+    /* Default settings from datasheet, idle until a measurement is forced. */
+    applySampling(Adafruit_BMP280::MODE_SLEEP);
 
     Serial.printf("Started bmp280 via I2C\n");
   }
@@ -136,6 +158,38 @@ class bmp280sensor : public BaseSensor {
     return celcius * 1.8 + 32.0;
   }
 
+  /**
+   * @brief Starts one forced conversion
+   * 
+   * Writing MODE_FORCED makes the sensor measure once and return to
+   * sleep. The result is read by handle() without blocking the caller.
+   */
+  void startMeasurement() {
+    applySampling(Adafruit_BMP280::MODE_FORCED);
+    conversionStart = millis();
+    converting = true;
+  }
+
+  /**
+   * @brief Waits for the running conversion to finish
+   * @return true once the result registers are updated, false if the
+   *         sensor still reports measuring after twice the max conversion time
+   */
+  bool waitMeasurement() {
+    while (bmp.getStatus() & BMP280_STATUS_MEASURING) {
+      if (millis() - conversionStart > 2 * BMP280_MEASUREMENT_MS) return false;
+      delay(1);
+    }
+    return true;
+  }
+
+  /**
+   * @brief Start a conversion for this wake's update, collected in handle()
+   */
+  void prepare() override {
+    if (healthy) startMeasurement();
+  }
+
   /**
    * @brief Performs a complete measurement cycle and publishes data via MQTT
    * 
@@ -144,7 +198,8 @@ class bmp280sensor : public BaseSensor {
    * should be called when environmental data is needed.
    * 
    * Measurement Process:
-   * 1. Triggers forced measurement mode (sensor wakes, measures, sleeps)
+   * 1. Waits for the forced conversion started by prepare() (starting one
+   *    if needed), polling the status register measuring bit
    * 2. Reads raw temperature and pressure from sensor registers
    * 3. Converts temperature from Celsius to Fahrenheit
    * 4. Outputs formatted readings to serial with timestamps
@@ -163,7 +218,7 @@ class bmp280sensor : public BaseSensor {
    * 
    * Error Handling:
    * - Prints error message if forced measurement fails
-   * - Still attempts to queue data (may contain stale values)
+   * - Queues nothing and marks the sensor unhealthy on failure
    * - Check I2C connectivity if measurement failures persist
    * 
    * Serial Output Format:
@@ -176,7 +231,14 @@ class bmp280sensor : public BaseSensor {
     float pressure;
 
     //get data
-    if (bmp.takeForcedMeasurement()) {
+    if (!converting) {
+        startMeasurement();
+    }
+    bool measured = waitMeasurement();
+    converting = false;
+
+    if (measured) {
+        Serial.printf("(%dms) BMP conversion done after %lu ms\n", millis(), millis() - conversionStart);
 
         // can now print out the new measurements
         temperature = getF(bmp.readTemperature());
@@ -188,6 +250,8 @@ class bmp280sensor : public BaseSensor {
 
     } else {
         Serial.println("BMP Forced measurement failed!");
+        healthy = false;
+        return;
     }
 
     JsonDocument myObject;
@@ -203,10 +267,18 @@ class bmp280sensor : public BaseSensor {
     return 180000; // 3 minutes for atmospheric sensors
   }
   
+  unsigned long getUpdateTolerance() override {
+    return 45000; // pressure and air temperature change slowly
+  }
+  
   bool needsUpdate() override {
     return false; // Scheduled updates only, not time-critical
   }
   
+  bool isHealthy() override {
+    return healthy;
+  }
+  
   String getSensorId() override {
     return "BMP280";
   }
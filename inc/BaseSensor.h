@@ -27,6 +27,15 @@ public:
      * and queue message for transmission. Reset any timing flags.
      */
     virtual void handle() = 0;
+
+    /**
+     * @brief Start slow work for an update that is due this wake
+     * 
+     * Called by SensorScheduler at the start of the wake, before any sensor
+     * is handled, for each sensor that will be handled. Sensors start
+     * conversions here and collect the result in handle(). Default no-op.
+     */
+    virtual void prepare() {}
     
     /**
      * @brief Get sensor's update interval in milliseconds
@@ -36,6 +45,15 @@ public:
      * Used by SensorScheduler to determine wake times.
      */
     virtual unsigned long getUpdateInterval() = 0;
+
+    /**
+     * @brief Get how early the sensor may be updated, in milliseconds
+     * @return Tolerance window before each deadline, default 0 (exact)
+     *
+     * SensorScheduler runs the sensor early when another sensor's wake falls
+     * within this window, so one wake and radio session serves both.
+     */
+    virtual unsigned long getUpdateTolerance() { return 0; }
     
     /**
      * @brief Check if sensor needs an update right now
@@ -45,7 +63,35 @@ public:
      * Useful for interrupt-driven sensors or immediate data needs.
      */
     virtual bool needsUpdate() = 0;
-    
+
+    /**
+     * @brief Check if needsUpdate() can ever return true for this sensor
+     * @return true if the scheduler should poll needsUpdate(), default false
+     *
+     * Purely interval-driven sensors keep the default so the scheduler
+     * does not poll them on every check.
+     */
+    virtual bool isEventDriven() { return false; }
+
+    /**
+     * @brief Check if the last handle() produced data that should be sent now
+     * @return true to request a transmit wake, default false
+     *
+     * Checked by SensorScheduler right after handle(). Normal readings wait
+     * in the queue until the transmit policy brings up the radio.
+     */
+    virtual bool hasPriorityData() { return false; }
+
+    /**
+     * @brief Check if the sensor hardware is working
+     * @return false after begin() or handle() hit a fault, default true
+     *
+     * Checked by SensorScheduler after begin() and handle(). A faulted
+     * sensor is disabled and begin() is retried on later wakes with
+     * exponential backoff.
+     */
+    virtual bool isHealthy() { return true; }
+
     /**
      * @brief Get sensor's unique identifier
      * @return String identifier for this sensor
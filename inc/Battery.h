@@ -15,7 +15,7 @@ RTC_DATA_ATTR unsigned long batteryLastUpdate = 0;
 
 /**
  * @brief Battery voltage monitoring system with averaged ADC sampling
- * @tparam QUEUE_SIZE The size of the MQTT message queue
+ * @tparam Queue The MqttMessageQueue type used for message buffering
  * 
  * This template class provides battery voltage monitoring for ESP32-based IoT devices
  * using analog-to-digital conversion with statistical averaging for accuracy. Features:
@@ -44,7 +44,7 @@ RTC_DATA_ATTR unsigned long batteryLastUpdate = 0;
  * 
  * Voltage Range: Designed for 3.0V - 4.2V Li-ion/LiPo battery monitoring
  */
-template<size_t QUEUE_SIZE>
+template<class Queue>
 class battery : public BaseSensor {
 private:
     int total;              // the running total
@@ -53,7 +53,7 @@ private:
     int battery_inputPin;
     int battery_numReadings;
     PubSubClient* client;
-    MqttMessageQueue<QUEUE_SIZE>* tx_queue;
+    Queue* tx_queue;
     String topic;
 
 public:
@@ -70,7 +70,7 @@ public:
      * 
      * MQTT format: {"battery": voltage_in_volts}
      */
-    battery(uint8_t pin, PubSubClient* cli, MqttMessageQueue<QUEUE_SIZE>* q, String top)
+    battery(uint8_t pin, PubSubClient* cli, Queue* q, String top)
         : battery_inputPin(pin), tx_queue(q), total(0), average(0.0), vbat(0.0), battery_numReadings(10) {
         client = cli;
         topic = top;
@@ -172,6 +172,10 @@ public:
         return 300000; // 5 minutes for battery monitoring
     }
     
+    unsigned long getUpdateTolerance() override {
+        return 120000; // battery voltage drifts slowly, ride along with other wakes
+    }
+    
     bool needsUpdate() override {
         return false; // Battery is not time-critical, only scheduled updates
     }
@@ -0,0 +1,347 @@
+#ifndef COMPRESSEDBATCH_H
+#define COMPRESSEDBATCH_H
+
+#include "Arduino.h"
+#include <ArduinoJson.h>
+#include <PubSubClient.h>
+#include "inc/MqttMessageQueue.h"
+#include "inc/MqttPublish.h"
+
+#ifndef COMPRESSED_BATCH_BYTES
+#define COMPRESSED_BATCH_BYTES 1024
+#endif
+#if COMPRESSED_BATCH_BYTES > MQTT_PUBLISH_BUFFER_BYTES
+#error "a full compressed batch must fit the MQTT client buffer (MQTT_PUBLISH_BUFFER_BYTES)"
+#endif
+
+#define COMPRESSED_BATCH_VERSION 2
+#define COMPRESSED_BATCH_HEADER_BYTES 4
+#define COMPRESSED_BATCH_FIELDS 9
+#define COMPRESSED_BATCH_MAX_RECORD_BITS (36 + COMPRESSED_BATCH_FIELDS * 37)
+
+/**
+ * @brief Fixed-point scale of one compressible reading field
+ *
+ * Stored value = lround(reading * scale), decoded as stored / scale.
+ */
+struct CompressedField {
+    const char* name;
+    float scale;
+};
+
+// Known sensor fields; order is part of the wire format
+const CompressedField compressedFields[COMPRESSED_BATCH_FIELDS] = {
+    { "rain",            1.0 / 0.01193 },  // bucket tips
+    { "soil_temp",       100.0 },          // centi-degrees F
+    { "bmp_temperature", 100.0 },          // centi-degrees F
+    { "bmp_pressure",    1.0 },            // pascals
+    { "battery",         1000.0 },         // millivolts
+    { "soil_temp_1",     100.0 },          // centi-degrees F, multi-probe profile
+    { "soil_temp_2",     100.0 },
+    { "soil_temp_3",     100.0 },
+    { "soil_temp_4",     100.0 },
+};
+
+/**
+ * @brief Encoder state kept in RTC memory so a batch grows across wakes
+ */
+struct CompressedBatchState {
+    uint32_t bitPos;
+    uint16_t count;
+    uint32_t prevTs;
+    int32_t prevDelta;
+    int32_t prevValue[COMPRESSED_BATCH_FIELDS];
+};
+
+// RTC persistent compressed batch of offline readings
+RTC_DATA_ATTR uint8_t compressedBatchData[COMPRESSED_BATCH_BYTES];
+RTC_DATA_ATTR CompressedBatchState compressedBatchState = {};
+
+/**
+ * @brief Delta/fixed-point compressed batch of readings accumulated offline
+ *
+ * When readings pile up across offline wakes, each queued record repeats
+ * full float text and a timestamp. This batch instead stores them
+ * Gorilla-style as a bit stream in RTC memory:
+ *
+ * Header (4 bytes): version, reserved, uint16_t record count (little endian)
+ *
+ * Per record:
+ * - timestamp: first record raw 32 bits, then delta-of-delta
+ *   '0' = 0, '10' + 7 bits, '110' + 9 bits, '1110' + 12 bits, '1111' + 32 bits
+ * - presence: one bit per field in compressedFields order
+ * - per present field: zigzag delta of the fixed-point value against that
+ *   field's previous value, '0' = 0, '10' + 6 bits, '110' + 12 bits,
+ *   '1110' + 20 bits, '1111' + 32 bits
+ *
+ * Signed values in buckets are zigzag encoded, bits are MSB first. Typical
+ * offline records (one sensor, slowly changing values, regular interval)
+ * take 2-4 bytes instead of 40-60 bytes of JSON in the RTC queue.
+ *
+ * The batch is uploaded as one binary message on "<topic>batch"; decode()
+ * is the reference decoder.
+ */
+class CompressedBatch {
+private:
+    static uint32_t zigzag(int32_t v) {
+        return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+    }
+
+    static int32_t unzigzag(uint32_t v) {
+        return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+    }
+
+    static void writeBits(uint8_t* data, uint32_t& pos, uint32_t value, uint8_t bits) {
+        for (int8_t i = bits - 1; i >= 0; i--) {
+            uint32_t byte = pos >> 3;
+            uint8_t mask = 0x80 >> (pos & 7);
+            if ((value >> i) & 1) data[byte] |= mask;
+            else data[byte] &= ~mask;
+            pos++;
+        }
+    }
+
+    /**
+     * @brief Reads bits MSB first; bits at or past limit read as 0
+     */
+    static uint32_t readBits(const uint8_t* data, uint32_t& pos, uint8_t bits, uint32_t limit) {
+        uint32_t value = 0;
+        for (uint8_t i = 0; i < bits; i++) {
+            uint32_t bit = (pos < limit) ? (data[pos >> 3] >> (7 - (pos & 7))) & 1 : 0;
+            value = (value << 1) | bit;
+            pos++;
+        }
+        return value;
+    }
+
+    /**
+     * @brief Writes a zigzag value with the smallest bucket that fits
+     * @param widths Payload bits of the 4 prefixed buckets ('0' is value 0)
+     */
+    static void writeBucket(uint8_t* data, uint32_t& pos, uint32_t value, const uint8_t* widths) {
+        if (value == 0) {
+            writeBits(data, pos, 0, 1);
+            return;
+        }
+        for (uint8_t b = 0; b < 4; b++) {
+            if (b == 3 || value < (1UL << widths[b])) {
+                // prefix: b+1 ones followed by a zero, except the last bucket
+                writeBits(data, pos, (b < 3) ? ((1UL << (b + 2)) - 2) : 0xF, (b < 3) ? b + 2 : 4);
+                writeBits(data, pos, value, widths[b]);
+                return;
+            }
+        }
+    }
+
+    static uint32_t readBucket(const uint8_t* data, uint32_t& pos, const uint8_t* widths, uint32_t limit) {
+        uint8_t ones = 0;
+        while (ones < 4 && readBits(data, pos, 1, limit) == 1) ones++;
+        if (ones == 0) return 0;
+        return readBits(data, pos, widths[ones - 1], limit);
+    }
+
+    static const uint8_t* tsWidths() {
+        static const uint8_t widths[4] = { 7, 9, 12, 32 };
+        return widths;
+    }
+
+    static const uint8_t* valueWidths() {
+        static const uint8_t widths[4] = { 6, 12, 20, 32 };
+        return widths;
+    }
+
+    static int fieldIndex(const char* name) {
+        for (int i = 0; i < COMPRESSED_BATCH_FIELDS; i++) {
+            if (strcmp(compressedFields[i].name, name) == 0) return i;
+        }
+        return -1;
+    }
+
+    void writeHeader() {
+        compressedBatchData[0] = COMPRESSED_BATCH_VERSION;
+        compressedBatchData[1] = 0;
+        compressedBatchData[2] = compressedBatchState.count & 0xFF;
+        compressedBatchData[3] = compressedBatchState.count >> 8;
+    }
+
+public:
+    /**
+     * @brief Attaches to the RTC batch, resetting it if the state is invalid
+     */
+    CompressedBatch() {
+        if (compressedBatchState.bitPos < COMPRESSED_BATCH_HEADER_BYTES * 8 ||
+            compressedBatchState.bitPos > COMPRESSED_BATCH_BYTES * 8 ||
+            compressedBatchData[0] != COMPRESSED_BATCH_VERSION) {
+            clear();
+        }
+    }
+
+    /**
+     * @brief Appends one reading record
+     * @param timestamp Unix time of the record
+     * @param fields Object of numeric readings, all named in compressedFields
+     * @return false if a field is unknown/non-numeric or the batch is full;
+     *         nothing is written in that case
+     */
+    bool append(time_t timestamp, JsonObjectConst fields) {
+        int32_t values[COMPRESSED_BATCH_FIELDS];
+        bool present[COMPRESSED_BATCH_FIELDS] = {};
+
+        for (JsonPairConst kv : fields) {
+            int i = fieldIndex(kv.key().c_str());
+            if (i < 0 || !kv.value().is<float>()) return false;
+            values[i] = lroundf(kv.value().as<float>() * compressedFields[i].scale);
+            present[i] = true;
+        }
+        if (full()) {
+            return false;
+        }
+
+        CompressedBatchState& st = compressedBatchState;
+        uint32_t ts = (uint32_t)timestamp;
+        if (st.count == 0) {
+            writeBits(compressedBatchData, st.bitPos, ts, 32);
+            st.prevDelta = 0;
+        } else {
+            int32_t delta = (int32_t)(ts - st.prevTs);
+            writeBucket(compressedBatchData, st.bitPos, zigzag(delta - st.prevDelta), tsWidths());
+            st.prevDelta = delta;
+        }
+        st.prevTs = ts;
+
+        for (int i = 0; i < COMPRESSED_BATCH_FIELDS; i++) {
+            writeBits(compressedBatchData, st.bitPos, present[i] ? 1 : 0, 1);
+        }
+        for (int i = 0; i < COMPRESSED_BATCH_FIELDS; i++) {
+            if (!present[i]) continue;
+            writeBucket(compressedBatchData, st.bitPos, zigzag(values[i] - st.prevValue[i]), valueWidths());
+            st.prevValue[i] = values[i];
+        }
+
+        st.count++;
+        writeHeader();
+        return true;
+    }
+
+    /**
+     * @brief Checks whether the batch may have no room for another record
+     */
+    bool full() const {
+        return compressedBatchState.bitPos + COMPRESSED_BATCH_MAX_RECORD_BITS > COMPRESSED_BATCH_BYTES * 8;
+    }
+
+    /**
+     * @brief Moves compressible records from a queue into the batch
+     * @tparam Queue MqttMessageQueue type holding the records
+     * @param queue Queue to drain
+     * @param topic Only records for exactly this topic are compacted
+     * @return Number of records moved
+     *
+     * Looks at every queued record once. Records for other topics or with
+     * fields the batch cannot encode (status, health, trace reports) are
+     * moved to the back of the queue with requeueFront(), so they keep
+     * their timestamps and are still published. Stops when the batch is
+     * full. Frees RTC queue space during long offline runs.
+     */
+    template<class Queue>
+    size_t compact(Queue& queue, const char* topic) {
+        MqttRecord msg;
+        size_t moved = 0;
+        size_t skipped = 0;
+        char queuedTopic[MQTT_MAX_TOPIC_LENGTH];
+        snprintf(queuedTopic, sizeof(queuedTopic), "%s%s", topic, Queue::RecordEncoder::topicSuffix());
+
+        for (size_t n = queue.size(); n > 0 && !full() && queue.peek(msg); n--) {
+            JsonDocument doc;
+            if (strcmp(msg.topic, queuedTopic) == 0 &&
+                !Queue::RecordEncoder::decode(doc, msg.payload, msg.length) &&
+                doc.is<JsonObject>() &&
+                append(msg.timestamp, doc.as<JsonObjectConst>())) {
+                queue.pop();
+                moved++;
+            } else {
+                queue.requeueFront();
+                skipped++;
+            }
+        }
+        if (moved > 0) {
+            Serial.printf("Compressed batch: +%u records (%u skipped), %u records in %u bytes\n",
+                         (unsigned)moved, (unsigned)skipped, (unsigned)count(), (unsigned)bytes());
+        }
+        return moved;
+    }
+
+    /**
+     * @brief Publishes the batch as one binary message on "<topic>batch"
+     * @return true if the whole batch was written to the client
+     */
+    bool publish(PubSubClient& mqttClient, const char* topic) {
+        char batchTopic[MQTT_MAX_TOPIC_LENGTH];
+        snprintf(batchTopic, sizeof(batchTopic), "%sbatch", topic);
+
+        size_t length = bytes();
+        Serial.printf("Sending compressed batch: %u records, %u bytes\n", (unsigned)count(), (unsigned)length);
+        return publishPacket(mqttClient, batchTopic, compressedBatchData, length);
+    }
+
+    /**
+     * @brief Decodes a batch into an array of {"field": value, ..., "ts": t}
+     * @return false on an unknown version or truncated stream
+     */
+    static bool decode(const uint8_t* data, size_t length, JsonDocument& out) {
+        if (length < COMPRESSED_BATCH_HEADER_BYTES || data[0] != COMPRESSED_BATCH_VERSION) return false;
+
+        uint16_t n = data[2] | (data[3] << 8);
+        uint32_t limit = length * 8;
+        uint32_t pos = COMPRESSED_BATCH_HEADER_BYTES * 8;
+        uint32_t ts = 0;
+        int32_t delta = 0;
+        int32_t prev[COMPRESSED_BATCH_FIELDS] = {};
+
+        for (uint16_t r = 0; r < n; r++) {
+            if (r == 0) {
+                ts = readBits(data, pos, 32, limit);
+            } else {
+                delta += unzigzag(readBucket(data, pos, tsWidths(), limit));
+                ts += delta;
+            }
+
+            bool present[COMPRESSED_BATCH_FIELDS];
+            for (int i = 0; i < COMPRESSED_BATCH_FIELDS; i++) {
+                present[i] = readBits(data, pos, 1, limit);
+            }
+
+            JsonObject item = out.add<JsonObject>();
+            for (int i = 0; i < COMPRESSED_BATCH_FIELDS; i++) {
+                if (!present[i]) continue;
+                prev[i] += unzigzag(readBucket(data, pos, valueWidths(), limit));
+                item[compressedFields[i].name] = prev[i] / compressedFields[i].scale;
+            }
+            item["ts"] = ts;
+            if (pos > limit) return false;
+        }
+        return true;
+    }
+
+    size_t count() const {
+        return compressedBatchState.count;
+    }
+
+    /**
+     * @brief Get encoded size in bytes, including the header
+     */
+    size_t bytes() const {
+        return (compressedBatchState.bitPos + 7) / 8;
+    }
+
+    /**
+     * @brief Empties the batch (after a successful upload)
+     */
+    void clear() {
+        memset(&compressedBatchState, 0, sizeof(compressedBatchState));
+        compressedBatchState.bitPos = COMPRESSED_BATCH_HEADER_BYTES * 8;
+        writeHeader();
+    }
+};
+
+#endif
@@ -0,0 +1,472 @@
+#ifndef FLASHSPILLLOG_H
+#define FLASHSPILLLOG_H
+
+#include "Arduino.h"
+#include <LittleFS.h>
+#include "inc/MqttMessageQueue.h"
+
+#define SPILL_DIR "/spill"
+#define SPILL_SEGMENT_BYTES 4096     // one flash erase block per segment
+#define SPILL_MAX_SEGMENTS 16        // 64 KB of spilled messages
+#define SPILL_HEADER_BYTES 8
+#define SPILL_MAGIC 0x53504C31       // "SPL1"
+
+// RTC persistent spill log position (rebuilt by scanning flash on cold boot)
+RTC_DATA_ATTR uint32_t spillMagic = 0;
+RTC_DATA_ATTR uint32_t spillFirstSeq = 0;      // oldest segment still holding records
+RTC_DATA_ATTR uint32_t spillLastSeq = 0;       // segment currently appended to
+RTC_DATA_ATTR uint32_t spillReadOffset = 0;    // next record in the oldest segment
+RTC_DATA_ATTR uint32_t spillWriteOffset = 0;   // size of the newest segment
+RTC_DATA_ATTR uint32_t spillCount = 0;
+
+// RTC persistent spill log statistics
+RTC_DATA_ATTR uint32_t spillAppends = 0;
+RTC_DATA_ATTR uint32_t spillDrained = 0;
+RTC_DATA_ATTR uint32_t spillDropped = 0;
+RTC_DATA_ATTR uint32_t spillUnreadable = 0;    // of spillDropped: lost to unreadable records/flash
+RTC_DATA_ATTR uint32_t spillSegmentsErased = 0;
+RTC_DATA_ATTR uint32_t spillBytesWritten = 0;
+
+/**
+ * @brief Append-only flash ring log used as MqttMessageQueue overflow tier
+ *
+ * When the RTC queue is full during long broker outages, messages are
+ * spilled here instead of being dropped, then drained oldest-first after
+ * the next successful MQTT connection.
+ *
+ * Layout on the LittleFS partition:
+ * - SPILL_DIR holds segment files named by increasing sequence number
+ * - Each segment is appended until it reaches SPILL_SEGMENT_BYTES
+ * - A fully drained segment is deleted; when SPILL_MAX_SEGMENTS are in use
+ *   the oldest segment is deleted and its records counted as dropped
+ *
+ * Record layout: uint16_t payload length, uint8_t topic length, uint8_t
+ * reserved, uint32_t timestamp, topic bytes, payload bytes.
+ *
+ * Segments are only ever appended and deleted as a whole, never rewritten,
+ * and new segments rotate through fresh file names, so erases are spread
+ * across the partition by LittleFS's block allocator. Read/write positions
+ * live in RTC memory; after a power loss they are rebuilt by scanning the
+ * segment files (records already drained from the oldest segment may then
+ * be sent again), and a record torn by the power loss is cut off.
+ *
+ * A record that cannot be read back (corrupt header, failed mount or read)
+ * is skipped together with the rest of its segment and counted as dropped,
+ * so one bad record never blocks the queue behind it.
+ *
+ * The filesystem is mounted lazily: wakes that never spill or drain don't
+ * pay for the mount.
+ *
+ * The newest segment stays open across the appends of a spill burst and
+ * is only committed by sync(), before draining and before deep sleep.
+ * Reopening a LittleFS file to append copies its partly written last block
+ * into a freshly erased one and commits metadata on every close, so one
+ * open per record costs about an erase per record; held open, the data
+ * blocks fill sequentially and cost one erase per block. Records appended
+ * since the last sync() are lost on a power loss (not on deep sleep).
+ */
+class FlashSpillLog : public MqttSpillTarget {
+private:
+    bool mounted;
+    bool staged;
+    File appendFile;                // newest segment while a spill burst appends
+    char stagedTopic[MQTT_MAX_TOPIC_LENGTH];
+    char stagedPayload[MQTT_MAX_PAYLOAD_LENGTH];
+    MqttRecord stagedRecord;
+
+    static void segmentPath(char* path, uint32_t seq) {
+        snprintf(path, 32, SPILL_DIR "/%08lu.log", (unsigned long)seq);
+    }
+
+    /**
+     * @brief Mounts LittleFS once per wake, formatting it on first use
+     */
+    bool mount() {
+        if (mounted) return true;
+
+        unsigned long start = millis();
+        if (!LittleFS.begin(true)) {
+            Serial.println("Spill: LittleFS mount failed");
+            return false;
+        }
+        if (!LittleFS.exists(SPILL_DIR)) {
+            LittleFS.mkdir(SPILL_DIR);
+        }
+        mounted = true;
+        Serial.printf("(%dms) Spill: mounted in %lu ms\n", millis(), millis() - start);
+        return true;
+    }
+
+    /**
+     * @brief Get a segment's file size in bytes (0 if missing)
+     */
+    static size_t segmentSize(uint32_t seq) {
+        char path[32];
+        segmentPath(path, seq);
+        File f = LittleFS.open(path, "r");
+        if (!f) return 0;
+        size_t size = f.size();
+        f.close();
+        return size;
+    }
+
+    /**
+     * @brief Counts complete records in a segment starting at the given offset
+     * @param end Receives the offset just past the last complete record
+     */
+    uint32_t countRecords(uint32_t seq, uint32_t offset, uint32_t* end = nullptr) {
+        char path[32];
+        segmentPath(path, seq);
+        if (end) *end = offset;
+        File f = LittleFS.open(path, "r");
+        if (!f) return 0;
+
+        uint32_t n = 0;
+        uint8_t header[SPILL_HEADER_BYTES];
+        size_t size = f.size();
+        while (offset + SPILL_HEADER_BYTES <= size) {
+            f.seek(offset);
+            if (f.read(header, SPILL_HEADER_BYTES) != SPILL_HEADER_BYTES) break;
+            uint16_t length;
+            memcpy(&length, header, sizeof(length));
+            offset += SPILL_HEADER_BYTES + header[2] + length;
+            if (offset > size) break; // torn write at power loss
+            n++;
+            if (end) *end = offset;
+        }
+        f.close();
+        return n;
+    }
+
+    /**
+     * @brief Cuts a segment back to its first bytes (drops a torn record)
+     *
+     * LittleFS files cannot be truncated in place, so the kept bytes are
+     * copied to a temporary file that then replaces the segment.
+     */
+    bool truncateSegment(uint32_t seq, uint32_t size) {
+        char path[32];
+        segmentPath(path, seq);
+        const char* tmpPath = SPILL_DIR "/truncate.tmp";
+
+        File src = LittleFS.open(path, "r");
+        File dst = LittleFS.open(tmpPath, "w");
+        bool ok = src && dst;
+        uint8_t chunk[64];
+        for (uint32_t copied = 0; ok && copied < size; ) {
+            size_t n = size - copied < sizeof(chunk) ? size - copied : sizeof(chunk);
+            ok = src.read(chunk, n) == n && dst.write(chunk, n) == n;
+            copied += n;
+        }
+        if (src) src.close();
+        if (dst) dst.close();
+        ok = ok && LittleFS.remove(path) && LittleFS.rename(tmpPath, path);
+        if (!ok) LittleFS.remove(tmpPath);
+        return ok;
+    }
+
+    /**
+     * @brief Rebuilds RTC positions from the segment files after a cold boot
+     */
+    void recover() {
+        spillFirstSeq = 0;
+        spillLastSeq = 0;
+        spillReadOffset = 0;
+        spillWriteOffset = 0;
+        spillCount = 0;
+
+        bool any = false;
+        size_t lastSize = 0;
+        File dir = LittleFS.open(SPILL_DIR);
+        File f = dir.openNextFile();
+        while (f) {
+            const char* name = strrchr(f.name(), '/');
+            name = name ? name + 1 : f.name();
+            if (strstr(name, ".log") != nullptr) {
+                uint32_t seq = strtoul(name, nullptr, 10);
+                if (!any || seq < spillFirstSeq) spillFirstSeq = seq;
+                if (!any || seq > spillLastSeq) {
+                    spillLastSeq = seq;
+                    lastSize = f.size();
+                }
+                any = true;
+            }
+            f.close();
+            f = dir.openNextFile();
+        }
+        dir.close();
+
+        if (any) {
+            for (uint32_t seq = spillFirstSeq; seq < spillLastSeq; seq++) {
+                spillCount += countRecords(seq, 0);
+            }
+            // appends continue after the last complete record, not after a torn one
+            spillCount += countRecords(spillLastSeq, 0, &spillWriteOffset);
+            if (spillWriteOffset < lastSize) {
+                Serial.printf("Spill: cutting %lu bytes of a torn record\n",
+                             (unsigned long)(lastSize - spillWriteOffset));
+                if (!truncateSegment(spillLastSeq, spillWriteOffset)) {
+                    spillLastSeq++;     // leave the torn segment read-only
+                    spillWriteOffset = 0;
+                }
+            }
+            Serial.printf("Spill: recovered %lu messages in segments %lu..%lu\n",
+                         (unsigned long)spillCount, (unsigned long)spillFirstSeq, (unsigned long)spillLastSeq);
+        }
+        spillMagic = SPILL_MAGIC;
+    }
+
+    /**
+     * @brief Deletes the oldest segment and advances the read position
+     */
+    void eraseOldestSegment() {
+        sync();
+        char path[32];
+        segmentPath(path, spillFirstSeq);
+        LittleFS.remove(path);
+        spillSegmentsErased++;
+
+        if (spillFirstSeq == spillLastSeq) {
+            spillFirstSeq++;
+            spillLastSeq = spillFirstSeq;
+            spillWriteOffset = 0;
+        } else {
+            spillFirstSeq++;
+        }
+        spillReadOffset = 0;
+        staged = false;
+    }
+
+    /**
+     * @brief Drops the unreadable rest of the oldest segment
+     *
+     * Counts the records it held (all remaining records if it is the only
+     * segment, or if flash cannot be mounted at all) as dropped. A count
+     * that drifted because of a corrupt header is settled when the last
+     * segment runs out.
+     */
+    void dropUnreadable(bool flashUsable) {
+        uint32_t lost = spillCount;
+        if (flashUsable && spillFirstSeq < spillLastSeq) {
+            lost = countRecords(spillFirstSeq, spillReadOffset);   // 0 for a torn tail
+            if (lost > spillCount) lost = spillCount;
+        }
+        spillCount -= lost;
+        spillDropped += lost;
+        spillUnreadable += lost;
+        Serial.printf("Spill: segment %lu unreadable, dropped %lu messages\n",
+                     (unsigned long)spillFirstSeq, (unsigned long)lost);
+
+        if (!flashUsable) {
+            // skip past every segment; recover() finds leftover files after a power loss
+            spillLastSeq++;
+            spillFirstSeq = spillLastSeq;
+            spillReadOffset = 0;
+            spillWriteOffset = 0;
+            staged = false;
+        } else {
+            eraseOldestSegment();
+        }
+        if (spillCount == 0) {
+            spillFirstSeq = spillLastSeq;
+            spillReadOffset = 0;
+        }
+    }
+
+    /**
+     * @brief Reads the record at the read position into the staging buffers
+     * @return false if it cannot be read
+     */
+    bool stage() {
+        char path[32];
+        segmentPath(path, spillFirstSeq);
+        File f = LittleFS.open(path, "r");
+        if (!f) return false;
+        if (!f.seek(spillReadOffset)) {
+            f.close();
+            return false;
+        }
+
+        uint8_t header[SPILL_HEADER_BYTES];
+        if (f.read(header, SPILL_HEADER_BYTES) != SPILL_HEADER_BYTES) {
+            f.close();
+            return false;
+        }
+        uint16_t length;
+        uint32_t ts;
+        memcpy(&length, header, sizeof(length));
+        memcpy(&ts, header + 4, sizeof(ts));
+        uint8_t topicLength = header[2];
+        if (topicLength == 0 || topicLength >= MQTT_MAX_TOPIC_LENGTH || length >= MQTT_MAX_PAYLOAD_LENGTH) {
+            f.close();
+            return false;
+        }
+
+        bool ok = f.read((uint8_t*)stagedTopic, topicLength) == topicLength &&
+                  f.read((uint8_t*)stagedPayload, length) == length;
+        f.close();
+        if (!ok) return false;
+
+        stagedTopic[topicLength] = '\0';
+        stagedPayload[length] = '\0';
+        stagedRecord.topic = stagedTopic;
+        stagedRecord.payload = stagedPayload;
+        stagedRecord.length = length;
+        stagedRecord.timestamp = (time_t)ts;
+        staged = true;
+        return true;
+    }
+
+public:
+    /**
+     * @brief Constructs the spill log; the filesystem is mounted on first use
+     */
+    FlashSpillLog() : mounted(false), staged(false) {}
+
+    /**
+     * @brief Validates RTC state, scanning flash after a cold boot
+     * @return true if the spill log is usable
+     *
+     * After deep sleep the RTC positions are trusted and nothing is mounted.
+     * After power-on the partition is mounted and scanned once.
+     */
+    bool begin() {
+        if (spillMagic == SPILL_MAGIC) return true;
+        if (!mount()) return false;
+        recover();
+        return true;
+    }
+
+    /**
+     * @brief Appends one serialized message to the newest segment
+     * @return true if the record was written
+     *
+     * The segment stays open for the next append until sync(). Starts a new segment when the current one is full and deletes the
+     * oldest segment (dropping its records) once SPILL_MAX_SEGMENTS are used.
+     */
+    bool append(const char* topic, size_t topicLength, const char* payload,
+                size_t payloadLength, time_t timestamp) override {
+        if (!mount()) return false;
+
+        size_t size = SPILL_HEADER_BYTES + topicLength + payloadLength;
+        if (spillWriteOffset > 0 && spillWriteOffset + size > SPILL_SEGMENT_BYTES) {
+            sync();
+            spillLastSeq++;
+            spillWriteOffset = 0;
+            if (spillLastSeq - spillFirstSeq >= SPILL_MAX_SEGMENTS) {
+                uint32_t lost = countRecords(spillFirstSeq, spillReadOffset);
+                spillCount -= lost;
+                spillDropped += lost;
+                Serial.printf("Spill: log full, dropped %lu oldest messages\n", (unsigned long)lost);
+                eraseOldestSegment();
+            }
+        }
+        if (spillCount == 0) {
+            spillFirstSeq = spillLastSeq;
+            spillReadOffset = 0;
+        }
+
+        uint8_t header[SPILL_HEADER_BYTES];
+        uint16_t length = payloadLength;
+        uint32_t ts = (uint32_t)timestamp;
+        memcpy(header, &length, sizeof(length));
+        header[2] = topicLength;
+        header[3] = 0;
+        memcpy(header + 4, &ts, sizeof(ts));
+
+        if (!appendFile) {
+            char path[32];
+            segmentPath(path, spillLastSeq);
+            appendFile = LittleFS.open(path, "a");
+            if (!appendFile) {
+                Serial.println("Spill: open for append failed");
+                return false;
+            }
+        }
+        size_t written = appendFile.write(header, SPILL_HEADER_BYTES);
+        written += appendFile.write((const uint8_t*)topic, topicLength);
+        written += appendFile.write((const uint8_t*)payload, payloadLength);
+        if (written != size) {
+            Serial.println("Spill: short write");
+            return false;
+        }
+
+        spillWriteOffset += size;
+        spillBytesWritten += size;
+        spillCount++;
+        spillAppends++;
+        return true;
+    }
+
+    /**
+     * @brief Reads the oldest readable record into the staging buffers
+     * @param record Receives a view of the staged topic/payload
+     * @return false if the log is empty
+     *
+     * The staged record is reused until popFront() so repeated peeks don't
+     * touch flash again. Unreadable records are dropped (see
+     * dropUnreadable()) until a readable one is found or the log is empty.
+     */
+    bool front(MqttRecord& record) override {
+        if (spillCount > 0 && !staged) sync();   // readers only see committed appends
+        while (spillCount > 0 && !staged) {
+            bool flashUsable = mount();
+            if (flashUsable && stage()) break;
+            dropUnreadable(flashUsable);
+        }
+        if (!staged) return false;
+        record = stagedRecord;
+        return true;
+    }
+
+    /**
+     * @brief Drops the oldest record, deleting its segment once fully drained
+     */
+    void popFront() override {
+        MqttRecord unused;
+        if (!front(unused)) return;
+
+        spillReadOffset += SPILL_HEADER_BYTES + strlen(stagedTopic) + stagedRecord.length;
+        spillCount--;
+        spillDrained++;
+        staged = false;
+
+        bool segmentDone = spillFirstSeq < spillLastSeq ?
+            spillReadOffset >= segmentSize(spillFirstSeq) :
+            spillCount == 0;
+        if (segmentDone) {
+            eraseOldestSegment();
+        }
+    }
+
+    size_t count() override {
+        return spillCount;
+    }
+
+    /**
+     * @brief Commits and closes the segment held open by append()
+     *
+     * Call before deep sleep: appends still in LittleFS's cache would be
+     * lost with the RAM, while their count already sits in RTC memory.
+     */
+    void sync() {
+        if (appendFile) appendFile.close();
+    }
+
+    /**
+     * @brief Prints spill throughput and flash wear statistics
+     *
+     * Block erases are left to LittleFS and not estimated here; deleted
+     * segments and bytes written are what this log controls.
+     */
+    void printStats() const {
+        Serial.printf("Spill: %lu queued, %lu appended, %lu drained, %lu dropped (%lu unreadable), "
+                     "%lu segments deleted, %lu bytes written\n",
+                     (unsigned long)spillCount, (unsigned long)spillAppends,
+                     (unsigned long)spillDrained, (unsigned long)spillDropped,
+                     (unsigned long)spillUnreadable,
+                     (unsigned long)spillSegmentsErased, (unsigned long)spillBytesWritten);
+    }
+};
+
+#endif
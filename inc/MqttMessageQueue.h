@@ -4,6 +4,14 @@
 #include <ArduinoJson.h>
 #include <time.h>
 
+#ifndef MQTT_MAX_TOPIC_LENGTH
+#define MQTT_MAX_TOPIC_LENGTH 48     // including terminator
+#endif
+
+#ifndef MQTT_MAX_PAYLOAD_LENGTH
+#define MQTT_MAX_PAYLOAD_LENGTH 256  // including terminator
+#endif
+
 /**
  * @brief Container for MQTT message data with topic, payload, and timestamp
  * 
@@ -23,15 +31,446 @@ struct MqttMessage {
     MqttMessage() : timestamp(0) {}
 };
 
+/**
+ * @brief Read-only view of a queued MQTT message
+ * 
+ * Points directly into the queue storage so messages can be published
+ * in place. Valid until the message is popped from the queue.
+ */
+struct MqttRecord {
+    const char* topic;
+    const char* payload;
+    uint16_t length;        // payload length without terminator
+    time_t timestamp;
+};
+
+/**
+ * @brief Fixed-capacity queue slot with inline topic and payload buffers
+ * @tparam MAX_TOPIC Topic buffer size in bytes, including terminator
+ * @tparam MAX_PAYLOAD Payload buffer size in bytes, including terminator
+ * 
+ * Lives inside the queue storage so enqueue/publish never touch the heap.
+ * The payload is serialized directly into the buffer and published in place.
+ */
+template<size_t MAX_TOPIC, size_t MAX_PAYLOAD>
+struct MqttSlot {
+    char topic[MAX_TOPIC];
+    char payload[MAX_PAYLOAD];
+    uint16_t length;        // payload length without terminator
+    time_t timestamp;
+};
+
+/**
+ * @brief Fixed buffer that batch payloads are spliced into
+ * 
+ * put() never writes past the capacity; a batch that does not fit sets
+ * overflow instead of being sent truncated. A null data pointer only
+ * counts bytes, to size a batch before writing it.
+ */
+struct MqttBatchBuffer {
+    uint8_t* data;
+    size_t capacity;
+    size_t length;
+    bool overflow;
+
+    MqttBatchBuffer(uint8_t* d, size_t cap) : data(d), capacity(cap), length(0), overflow(false) {}
+
+    void put(const void* bytes, size_t n) {
+        if (length + n > capacity) { overflow = true; return; }
+        if (data != nullptr) memcpy(data + length, bytes, n);
+        length += n;
+    }
+    void put(uint8_t byte) { put(&byte, 1); }
+};
+
+/**
+ * @brief Encoded members of a stored record that holds an object
+ * 
+ * Points into the queue storage: [begin, end) are the record's key/value
+ * pairs exactly as encoded, so a batch copies them without re-encoding.
+ */
+struct MqttRecordMembers {
+    const char* begin;
+    const char* end;
+    size_t count;
+};
+
+/**
+ * @brief Default MqttMessageQueue payload encoder: text JSON
+ * 
+ * Encoder policy interface used by MqttMessageQueue and sendBatchedMessages():
+ * - topicSuffix(): appended to the topic so the backend can pick a decoder
+ * - measure(): encoded size of a document in bytes
+ * - serialize(): encodes into a buffer or straight into a Print (MQTT client)
+ * - decode(): parses a stored payload back into a document
+ * - members()/nextMember(): walk the key/value pairs of a stored object
+ * - beginArray()/endArray(), beginObject()/endObject(), separator() and
+ *   timestamp(): the framing sendBatchedMessages() splices members into
+ */
+struct JsonEncoder {
+    static const char* topicSuffix() { return ""; }
+    static size_t measure(const JsonDocument& doc) { return measureJson(doc); }
+    static size_t serialize(const JsonDocument& doc, char* buffer, size_t size) {
+        return serializeJson(doc, buffer, size);
+    }
+    static size_t serialize(const JsonDocument& doc, Print& out) {
+        return serializeJson(doc, out);
+    }
+    static DeserializationError decode(JsonDocument& doc, const char* payload, size_t length) {
+        return deserializeJson(doc, payload, length);
+    }
+
+    /**
+     * @brief Finds the members of a stored object (as written by serializeJson())
+     * @return false if the payload is not an object
+     */
+    static bool members(const char* payload, size_t length, MqttRecordMembers& m) {
+        if (length < 2 || payload[0] != '{' || payload[length - 1] != '}') return false;
+        m.begin = payload + 1;
+        m.end = payload + length - 1;
+        m.count = 0;
+        const char* key;
+        size_t keyLength;
+        for (const char* at = m.begin; at < m.end; m.count++) {
+            if (!nextMember(at, m.end, key, keyLength)) return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Steps over one member
+     * @param at Start of the member, moved past it and its separator
+     * @param key Receives the key as encoded (without quotes)
+     * @return false if the member is malformed
+     */
+    static bool nextMember(const char*& at, const char* end, const char*& key, size_t& keyLength) {
+        if (at >= end || *at != '"') return false;
+        key = ++at;
+        while (at < end && *at != '"') at += *at == '\\' ? 2 : 1;
+        if (at >= end) return false;
+        keyLength = at - key;
+        if (++at >= end || *at++ != ':') return false;
+
+        int depth = 0;
+        bool inString = false;
+        for (; at < end; at++) {
+            if (inString) {
+                if (*at == '\\') at++;
+                else if (*at == '"') inString = false;
+            } else if (*at == '"') {
+                inString = true;
+            } else if (*at == '{' || *at == '[') {
+                depth++;
+            } else if (*at == '}' || *at == ']') {
+                if (--depth < 0) return false;
+            } else if (*at == ',' && depth == 0) {
+                at++;
+                return at < end;    // a member must follow the comma
+            }
+        }
+        return depth == 0 && !inString;
+    }
+
+    static void beginArray(MqttBatchBuffer& out, size_t) { out.put('['); }
+    static void endArray(MqttBatchBuffer& out) { out.put(']'); }
+    static void beginObject(MqttBatchBuffer& out, size_t) { out.put('{'); }
+    static void endObject(MqttBatchBuffer& out) { out.put('}'); }
+    static void separator(MqttBatchBuffer& out) { out.put(','); }
+    static void timestamp(MqttBatchBuffer& out, time_t ts) {
+        char member[24];
+        int n = snprintf(member, sizeof(member), "\"ts\":%lld", (long long)ts);
+        out.put(member, n);
+    }
+};
+
+/**
+ * @brief Compact binary payload encoder: MessagePack
+ * 
+ * Floats such as bmp_pressure and rain take 5 bytes instead of their
+ * decimal text, and keys lose their quotes, shrinking airtime and RTC
+ * queue usage. Messages go to "<topic>msgpack" so the backend can route
+ * them to a MessagePack decoder (e.g. Telegraf's msgpack data format).
+ * 
+ * Payloads are binary and may contain NUL bytes; always use the record
+ * length rather than treating them as C strings.
+ */
+struct MsgPackEncoder {
+    static const char* topicSuffix() { return "msgpack"; }
+    static size_t measure(const JsonDocument& doc) { return measureMsgPack(doc); }
+    static size_t serialize(const JsonDocument& doc, char* buffer, size_t size) {
+        return serializeMsgPack(doc, buffer, size);
+    }
+    static size_t serialize(const JsonDocument& doc, Print& out) {
+        return serializeMsgPack(doc, out);
+    }
+    static DeserializationError decode(JsonDocument& doc, const char* payload, size_t length) {
+        return deserializeMsgPack(doc, payload, length);
+    }
+
+    /**
+     * @brief Finds the members of a stored map
+     * @return false if the payload is not a map or is malformed
+     */
+    static bool members(const char* payload, size_t length, MqttRecordMembers& m) {
+        const uint8_t* p = (const uint8_t*)payload;
+        size_t header;
+        if (length >= 1 && (p[0] & 0xF0) == 0x80) {
+            m.count = p[0] & 0x0F;
+            header = 1;
+        } else if (length >= 3 && p[0] == 0xDE) {
+            m.count = big(p + 1, 2);
+            header = 3;
+        } else if (length >= 5 && p[0] == 0xDF) {
+            m.count = big(p + 1, 4);
+            header = 5;
+        } else {
+            return false;
+        }
+        m.begin = payload + header;
+        m.end = payload + length;
+        const char* at = m.begin;
+        const char* key;
+        size_t keyLength;
+        for (size_t i = 0; i < m.count; i++) {
+            if (!nextMember(at, m.end, key, keyLength)) return false;
+        }
+        return at == m.end;
+    }
+
+    /**
+     * @brief Steps over one key/value pair
+     * @param at Start of the pair, moved past it
+     * @param key Receives the key bytes
+     * @return false if the pair is malformed or its key is not a string
+     */
+    static bool nextMember(const char*& at, const char* end, const char*& key, size_t& keyLength) {
+        const uint8_t* p = (const uint8_t*)at;
+        const uint8_t* e = (const uint8_t*)end;
+        if (p >= e) return false;
+        size_t lengthBytes = *p == 0xD9 ? 1 : *p == 0xDA ? 2 : *p == 0xDB ? 4 : 0;
+        if ((*p & 0xE0) == 0xA0) {
+            keyLength = *p++ & 0x1F;
+        } else if (lengthBytes > 0 && (size_t)(e - p) > lengthBytes) {
+            keyLength = big(p + 1, lengthBytes);
+            p += 1 + lengthBytes;
+        } else {
+            return false;
+        }
+        if ((size_t)(e - p) < keyLength) return false;
+        key = (const char*)p;
+        p += keyLength;
+        if (!skipValue(p, e)) return false;
+        at = (const char*)p;
+        return true;
+    }
+
+    static void beginArray(MqttBatchBuffer& out, size_t n) { header(out, 0x90, 0xDC, n); }
+    static void endArray(MqttBatchBuffer&) {}
+    static void beginObject(MqttBatchBuffer& out, size_t n) { header(out, 0x80, 0xDE, n); }
+    static void endObject(MqttBatchBuffer&) {}
+    static void separator(MqttBatchBuffer&) {}
+    static void timestamp(MqttBatchBuffer& out, time_t ts) {
+        out.put("\xA2ts", 3);
+        uint64_t v = (uint64_t)ts;      // smallest unsigned form, like serializeMsgPack()
+        if (v < 0x80) {
+            out.put((uint8_t)v);
+        } else if (v <= 0xFF) {
+            out.put(0xCC);
+            out.put((uint8_t)v);
+        } else if (v <= 0xFFFF) {
+            out.put(0xCD);
+            putBig(out, v, 2);
+        } else if (v <= 0xFFFFFFFF) {
+            out.put(0xCE);
+            putBig(out, v, 4);
+        } else {
+            out.put(0xCF);
+            putBig(out, v, 8);
+        }
+    }
+
+private:
+    static size_t big(const uint8_t* p, size_t n) {
+        size_t v = 0;
+        while (n--) v = v << 8 | *p++;
+        return v;
+    }
+
+    static void putBig(MqttBatchBuffer& out, uint64_t v, size_t n) {
+        while (n--) out.put((uint8_t)(v >> (8 * n)));
+    }
+
+    /**
+     * @brief Array (fix 0x90, 16-bit 0xDC) or map (0x80, 0xDE) header, 32-bit form one past the 16-bit one
+     */
+    static void header(MqttBatchBuffer& out, uint8_t fix, uint8_t wide, size_t n) {
+        if (n < 16) {
+            out.put((uint8_t)(fix | n));
+        } else if (n <= 0xFFFF) {
+            out.put(wide);
+            putBig(out, n, 2);
+        } else {
+            out.put((uint8_t)(wide + 1));
+            putBig(out, n, 4);
+        }
+    }
+
+    /**
+     * @brief Steps over one value, nested containers included
+     */
+    static bool skipValue(const uint8_t*& p, const uint8_t* e) {
+        size_t pending = 1;             // values still to skip
+        while (pending > 0) {
+            if (p >= e) return false;
+            uint8_t b = *p++;
+            pending--;
+            size_t fixed = 0;           // bytes after the type byte
+            size_t lengthBytes = 0;     // size of a length field that follows
+            size_t children = 0;
+            if (b <= 0x7F || b >= 0xE0 || b == 0xC0 || b == 0xC2 || b == 0xC3) {
+            } else if ((b & 0xF0) == 0x80) {
+                children = 2 * (b & 0x0F);
+            } else if ((b & 0xF0) == 0x90) {
+                children = b & 0x0F;
+            } else if ((b & 0xE0) == 0xA0) {
+                fixed = b & 0x1F;
+            } else if (b == 0xCC || b == 0xD0) {
+                fixed = 1;
+            } else if (b == 0xCD || b == 0xD1) {
+                fixed = 2;
+            } else if (b == 0xCA || b == 0xCE || b == 0xD2) {
+                fixed = 4;
+            } else if (b == 0xCB || b == 0xCF || b == 0xD3) {
+                fixed = 8;
+            } else if (b == 0xC4 || b == 0xD9) {
+                lengthBytes = 1;
+            } else if (b == 0xC5 || b == 0xDA || b == 0xDC || b == 0xDE) {
+                lengthBytes = 2;
+            } else if (b == 0xC6 || b == 0xDB || b == 0xDD || b == 0xDF) {
+                lengthBytes = 4;
+            } else {
+                return false;           // extension types are never stored
+            }
+            if (lengthBytes > 0) {
+                if ((size_t)(e - p) < lengthBytes) return false;
+                size_t n = big(p, lengthBytes);
+                p += lengthBytes;
+                if (b == 0xDC || b == 0xDD) children = n;
+                else if (b == 0xDE || b == 0xDF) children = 2 * n;
+                else fixed = n;
+            }
+            if ((size_t)(e - p) < fixed) return false;
+            p += fixed;
+            pending += children;
+        }
+        return true;
+    }
+};
+
+/**
+ * @brief Overflow tier for MqttMessageQueue
+ * 
+ * Receives already-serialized messages once the queue's primary storage is
+ * full, and hands them back oldest-first after the primary storage drains.
+ * Implemented by FlashSpillLog.
+ */
+class MqttSpillTarget {
+public:
+    virtual bool append(const char* topic, size_t topicLength, const char* payload,
+                        size_t payloadLength, time_t timestamp) = 0;
+    virtual bool front(MqttRecord& record) = 0;
+    virtual void popFront() = 0;
+    virtual size_t count() = 0;
+    virtual ~MqttSpillTarget() {}
+};
+
+/**
+ * @brief Default MqttMessageQueue storage policy: fixed slots in RAM
+ * @tparam MAX_SIZE Number of slots
+ * @tparam MAX_TOPIC Per-message topic capacity in bytes, including terminator
+ * @tparam MAX_PAYLOAD Per-message payload capacity in bytes, including terminator
+ * 
+ * Storage policy interface used by MqttMessageQueue:
+ * - append(): reserves a record, copies topic/timestamp and returns the
+ *   payload buffer (payloadLength + 1 bytes) for in-place serialization
+ * - front(): fills an MqttRecord view of the oldest record
+ * - at(): fills an MqttRecord view of the record at a FIFO index
+ * - popFront(): drops the oldest record
+ * - count(): number of stored records
+ * 
+ * Contents are lost on deep sleep. See MqttRtcStorage for a policy that
+ * survives deep sleep.
+ */
+template<size_t MAX_SIZE, size_t MAX_TOPIC = MQTT_MAX_TOPIC_LENGTH, size_t MAX_PAYLOAD = MQTT_MAX_PAYLOAD_LENGTH>
+class MqttSlotStorage {
+public:
+  MqttSlotStorage() : _head(0), _tail(0), _count(0) {}
+
+  char* append(const char* topic, size_t topicLength, size_t payloadLength, time_t timestamp) {
+    if (_count == MAX_SIZE || topicLength >= MAX_TOPIC || payloadLength >= MAX_PAYLOAD) {
+      return nullptr;
+    }
+
+    Slot& slot = _slots[_tail];
+    memcpy(slot.topic, topic, topicLength + 1);
+    slot.length = payloadLength;
+    slot.timestamp = timestamp;
+
+    _tail = (_tail + 1) % MAX_SIZE;
+    _count++;
+    return slot.payload;
+  }
+
+  bool front(MqttRecord& record) const {
+    return at(0, record);
+  }
+
+  bool at(size_t index, MqttRecord& record) const {
+    if (index >= _count) { return false; }
+    const Slot& slot = _slots[(_head + index) % MAX_SIZE];
+    record.topic = slot.topic;
+    record.payload = slot.payload;
+    record.length = slot.length;
+    record.timestamp = slot.timestamp;
+    return true;
+  }
+
+  void popFront() {
+    if (_count == 0) { return; }
+    _head = (_head + 1) % MAX_SIZE;
+    _count--;
+  }
+
+  size_t count() const {
+    return _count;
+  }
+
+private:
+  typedef MqttSlot<MAX_TOPIC, MAX_PAYLOAD> Slot;
+
+  size_t _head;
+  size_t _tail;
+  size_t _count;
+  Slot _slots[MAX_SIZE];
+};
+
 /**
  * @brief Thread-safe circular queue for buffering MQTT messages
  * @tparam MAX_SIZE Maximum number of messages the queue can hold
+ * @tparam Storage Storage policy holding the records (RAM slots by default,
+ *         MqttRtcStorage to keep messages across deep sleep)
+ * @tparam Encoder Payload encoder (JsonEncoder by default, MsgPackEncoder
+ *         for compact binary payloads)
  * 
  * This template class implements a circular queue specifically designed for
  * reliable MQTT message handling in IoT applications. Features:
  * 
  * - Fixed-size circular buffer with compile-time size specification
- * - Automatic JSON serialization from ArduinoJson documents
+ * - Inline topic/payload buffers: no heap allocation on enqueue or publish
+ * - Pluggable storage policy (RAM slots or RTC memory records)
+ * - Optional overflow tier (flash spill log) for long broker outages
+ * - Automatic JSON or MessagePack serialization from ArduinoJson documents
+ * - peek()/pop() API for publishing messages in place
  * - Thread-safe operations for interrupt-driven sensor data
  * - Overflow protection with full queue detection
  * - Memory-efficient design suitable for constrained embedded systems
@@ -45,44 +484,165 @@ struct MqttMessage {
  * The queue maintains FIFO (First In, First Out) ordering and provides
  * safe overflow handling by rejecting new messages when full.
  */
-template<size_t MAX_SIZE>
+template<size_t MAX_SIZE, class Storage = MqttSlotStorage<MAX_SIZE>, class Encoder = JsonEncoder>
 class MqttMessageQueue {
 public:
+  typedef Encoder RecordEncoder;
+
   /**
-   * @brief Constructs an empty MQTT message queue
+   * @brief Constructs an MQTT message queue on top of its storage policy
    * 
-   * Initializes circular queue with zero messages, sets pointers to 0.
-   * Ready for immediate use with full MAX_SIZE capacity available.
+   * RAM storage starts empty; RTC storage resumes with any messages kept
+   * from previous wake cycles.
    */
-  MqttMessageQueue()
-  : _head(0), _tail(0), _count(0) 
-  {
+  MqttMessageQueue() : _spill(nullptr) {}
+
+  /**
+   * @brief Attaches an overflow tier used once the primary storage is full
+   * @param spill Spill target (e.g. FlashSpillLog), nullptr to disable
+   * 
+   * While the spill holds messages, new messages are appended to it as well
+   * so FIFO order is kept: primary storage drains first, then the spill.
+   */
+  void setSpill(MqttSpillTarget* spill) {
+    _spill = spill;
   }
 
   /**
-   * @brief Adds a new MQTT message to the queue with JSON serialization and timestamp
-   * @param topic The MQTT topic string for message publication
+   * @brief Adds a new MQTT message to the queue with encoding and timestamp
+   * @param topic The MQTT topic string for message publication (the
+   *        encoder's topic suffix is appended)
    * @param doc ArduinoJson document containing the message data
-   * @return true if message was successfully queued, false if queue is full
+   * @return true if message was successfully queued, false if queue is full,
+   *         the storage has no room for the topic/payload, or the suffixed
+   *         topic exceeds MQTT_MAX_TOPIC_LENGTH
    * 
-   * Checks space, serializes JsonDocument to payload, stores topic/payload/timestamp,
-   * updates tail pointer with wraparound. Rejects if full to prevent overflow.
+   * Checks space, reserves a record in the storage, encodes the JsonDocument
+   * straight into the record's payload buffer. Rejects if full to prevent overflow.
    * 
    * Automatically captures current Unix timestamp for message ordering and debugging.
    * Thread-safe for single producer/consumer. External sync needed for multiple.
    */
+  bool enqueue(const char* topic, const JsonDocument& doc) {
+    char suffixed[MQTT_MAX_TOPIC_LENGTH];
+    const char* suffix = Encoder::topicSuffix();
+    if (suffix[0] != '\0') {
+      int n = snprintf(suffixed, sizeof(suffixed), "%s%s", topic, suffix);
+      if (n < 0 || (size_t)n >= sizeof(suffixed)) {
+        Serial.printf("MQTT queue: topic %s%s longer than %u bytes, message dropped\n",
+                      topic, suffix, (unsigned)(MQTT_MAX_TOPIC_LENGTH - 1));
+        return false;
+      }
+      topic = suffixed;
+    }
+
+    size_t topicLength = strlen(topic);
+    size_t payloadLength = Encoder::measure(doc);
+
+    if (_spill != nullptr && (primaryFull() || _spill->count() > 0)) {
+      return spill(topic, topicLength, doc, payloadLength);
+    }
+    if (primaryFull()) { return false; }
+
+    char* payload = _storage.append(topic, topicLength, payloadLength, time(nullptr));
+    if (payload == nullptr && _spill != nullptr) {
+      return spill(topic, topicLength, doc, payloadLength);
+    }
+    if (payload == nullptr) {
+      Serial.printf("MQTT queue: no room for message (topic %u, payload %u bytes)\n",
+                    (unsigned)topicLength, (unsigned)payloadLength);
+      return false;
+    }
+
+    Encoder::serialize(doc, payload, payloadLength + 1);
+    payload[payloadLength] = '\0';
+    return true;
+  }
+
+  /**
+   * @brief String convenience overload of enqueue()
+   */
   bool enqueue(const String& topic, const JsonDocument& doc) {
-    if (isFull()) { return false; }
+    return enqueue(topic.c_str(), doc);
+  }
 
-    String payload;
-    serializeJson(doc, payload);
+  /**
+   * @brief Returns a view of the oldest message without removing it
+   * @param record Receives pointers to the topic/payload in storage
+   * @return true if a message was available, false if queue is empty
+   * 
+   * Lets the caller publish directly from the storage buffers. The view
+   * stays valid until pop() is called. Call pop() only once the message
+   * has been handed to the MQTT client. Spilled messages are returned
+   * once the primary storage is empty.
+   */
+  bool peek(MqttRecord& record) const {
+    if (_storage.front(record)) { return true; }
+    return _spill != nullptr && _spill->front(record);
+  }
 
-    _queue[_tail].topic = topic;
-    _queue[_tail].payload = payload;
-    _queue[_tail].timestamp = time(nullptr); // Capture current Unix timestamp
+  /**
+   * @brief Returns a view of the message at a FIFO position without removing it
+   * @param index 0 for the oldest message
+   * @param record Receives pointers to the topic/payload in storage
+   * @return true if a message exists at that position
+   * 
+   * Used to look ahead when batching several messages into one publish.
+   * Only the oldest spilled message is reachable, so look-ahead stops at
+   * the first message in the spill tier.
+   */
+  bool peekAt(size_t index, MqttRecord& record) const {
+    size_t primary = _storage.count();
+    if (index < primary) { return _storage.at(index, record); }
+    return index == primary && _spill != nullptr && _spill->front(record);
+  }
 
-    _tail = (_tail + 1) % MAX_SIZE;
-    _count++;
+  /**
+   * @brief Removes the oldest message from the queue
+   * 
+   * No-op on an empty queue.
+   */
+  void pop() {
+    if (_storage.count() > 0) {
+      _storage.popFront();
+    } else if (_spill != nullptr) {
+      _spill->popFront();
+    }
+  }
+
+  /**
+   * @brief Moves the oldest message to the back of the queue
+   * @return true if it was moved; false if the queue is empty or the
+   *         message could not be stored again (it is then dropped)
+   * 
+   * The encoded payload and original timestamp are kept. Lets a consumer
+   * that only handles some messages (e.g. CompressedBatch::compact()) step
+   * past the others without dropping them.
+   */
+  bool requeueFront() {
+    MqttRecord record;
+    if (!peek(record)) { return false; }
+
+    char topic[MQTT_MAX_TOPIC_LENGTH];
+    char payload[MQTT_MAX_PAYLOAD_LENGTH];
+    size_t topicLength = strlen(record.topic);
+    size_t payloadLength = record.length;
+    time_t timestamp = record.timestamp;
+    if (topicLength >= sizeof(topic) || payloadLength >= sizeof(payload)) { return false; }
+    memcpy(topic, record.topic, topicLength + 1);
+    memcpy(payload, record.payload, payloadLength);
+    payload[payloadLength] = '\0';
+    pop();
+
+    if (_spill != nullptr && (primaryFull() || _spill->count() > 0)) {
+      return _spill->append(topic, topicLength, payload, payloadLength, timestamp);
+    }
+    char* stored = primaryFull() ? nullptr : _storage.append(topic, topicLength, payloadLength, timestamp);
+    if (stored == nullptr) {
+      Serial.printf("MQTT queue: no room to requeue message on %s, dropped\n", topic);
+      return false;
+    }
+    memcpy(stored, payload, payloadLength + 1);
     return true;
   }
 
@@ -91,21 +651,30 @@ public:
    * @param message Reference to MqttMessage that will receive the dequeued data
    * @return true if message was successfully retrieved, false if queue is empty
    * 
-   * FIFO retrieval: checks if empty, copies head message to reference,
-   * updates head pointer with wraparound, decrements count.
-   * 
-   * Returns false if empty. Used by MQTT transmission during connectivity.
-   * Thread-safe for single producer/consumer.
+   * FIFO retrieval: copies the head record into the String-based MqttMessage,
+   * then pops it. Kept for callers that need an owned copy; this path
+   * allocates, prefer peek()/pop() for publishing. Text payloads only: a
+   * binary (MessagePack) payload is cut at its first NUL byte.
    */
   bool dequeue(MqttMessage& message) {
-    if (isEmpty()) {return false;}
+    MqttRecord record;
+    if (!peek(record)) {return false;}
 
-    message = _queue[_head];
-    _head = (_head + 1) % MAX_SIZE;
-    _count--;
+    message.topic = record.topic;
+    message.payload = record.payload;
+    message.timestamp = record.timestamp;
+    pop();
     return true;
   }
 
+  /**
+   * @brief Get number of messages currently queued
+   * @return Message count, including messages in the spill tier
+   */
+  size_t size() const {
+    return _storage.count() + (_spill != nullptr ? _spill->count() : 0);
+  }
+
   /**
    * @brief Checks if the queue contains no messages
    * @return true if queue is empty (count = 0), false otherwise
@@ -114,26 +683,42 @@ public:
    * queues, check pending messages, and loop through queued messages.
    */
   bool isEmpty() const {
-    return _count == 0;
+    return size() == 0;
   }
 
   /**
    * @brief Checks if the queue has reached maximum capacity
-   * @return true if queue is full (count = MAX_SIZE), false otherwise
+   * @return true if primary storage is full (count = MAX_SIZE) and no
+   *         spill tier is attached, false otherwise
    * 
    * Const method for capacity check. Used to prevent overflow, implement
    * backpressure handling, monitor utilization, and trigger alternative
-   * processing when buffer saturated.
+   * processing when buffer saturated. Storage may still reject a message
+   * when not full if it runs out of bytes (RTC storage).
    */
   bool isFull() const {
-    return _count == MAX_SIZE;
+    return _spill == nullptr && primaryFull();
   }
 
 private:
-  size_t _head;
-  size_t _tail;
-  size_t _count;
-  MqttMessage _queue[MAX_SIZE];
+  bool primaryFull() const {
+    return _storage.count() >= MAX_SIZE;
+  }
+
+  /**
+   * @brief Encodes a message to a stack buffer and appends it to the spill tier
+   */
+  bool spill(const char* topic, size_t topicLength, const JsonDocument& doc, size_t payloadLength) {
+    char payload[MQTT_MAX_PAYLOAD_LENGTH];
+    if (topicLength >= MQTT_MAX_TOPIC_LENGTH || payloadLength >= MQTT_MAX_PAYLOAD_LENGTH) {
+      return false;
+    }
+    Encoder::serialize(doc, payload, sizeof(payload));
+    return _spill->append(topic, topicLength, payload, payloadLength, time(nullptr));
+  }
+
+  Storage _storage;
+  MqttSpillTarget* _spill;
 };
 
 #endif
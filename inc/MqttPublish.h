@@ -0,0 +1,77 @@
+#ifndef MQTTPUBLISH_H
+#define MQTTPUBLISH_H
+
+#include "Arduino.h"
+#include <ArduinoJson.h>
+#include <PubSubClient.h>
+#include "inc/MqttMessageQueue.h"
+
+#ifndef MQTT_PUBLISH_BUFFER_BYTES
+#define MQTT_PUBLISH_BUFFER_BYTES 1024   // largest payload encoded for one publish
+#endif
+
+// PubSubClient buffer: set once before connecting and never resized, so
+// it holds any packet with a payload up to MQTT_PUBLISH_BUFFER_BYTES
+#define MQTT_CLIENT_BUFFER_BYTES (MQTT_MAX_HEADER_SIZE + 2 + MQTT_MAX_TOPIC_LENGTH + MQTT_PUBLISH_BUFFER_BYTES)
+
+// Payloads are encoded here right before their publish; nothing is kept
+// across publishes, so one buffer serves every encoder and nothing is
+// allocated per packet.
+uint8_t mqttPublishBuffer[MQTT_PUBLISH_BUFFER_BYTES];
+
+/**
+ * @brief Largest payload that can be published on a topic
+ * @return The smaller of mqttPublishBuffer and what the client buffer
+ *         leaves for the payload after the header and topic
+ */
+size_t publishCapacity(PubSubClient& mqttClient, const char* topic) {
+    size_t overhead = MQTT_MAX_HEADER_SIZE + 2 + strlen(topic);
+    size_t room = mqttClient.getBufferSize() > overhead ? mqttClient.getBufferSize() - overhead : 0;
+    return room < sizeof(mqttPublishBuffer) ? room : sizeof(mqttPublishBuffer);
+}
+
+/**
+ * @brief Publishes a payload as one PUBLISH packet in a single socket write
+ * @param mqttClient Connected client
+ * @param topic Topic to publish on
+ * @param payload Encoded payload
+ * @param length Payload length in bytes
+ * @return true if the whole packet was written
+ *
+ * PubSubClient::publish() assembles header, topic and payload in its own
+ * buffer and hands them to the socket in one write(), so the packet leaves
+ * in as few TCP segments as possible with Nagle left on. Streaming with
+ * beginPublish() instead writes the header and every serializer token
+ * separately. The client buffer is never resized here (that would
+ * reallocate it mid-upload); callers keep payloads within
+ * publishCapacity() and a larger packet is refused.
+ */
+bool publishPacket(PubSubClient& mqttClient, const char* topic, const uint8_t* payload, size_t length) {
+    size_t packet = MQTT_MAX_HEADER_SIZE + 2 + strlen(topic) + length;
+    if (packet > mqttClient.getBufferSize()) {
+        Serial.printf("%u byte MQTT packet exceeds the %u byte client buffer\n",
+                      (unsigned)packet, (unsigned)mqttClient.getBufferSize());
+        return false;
+    }
+    return mqttClient.publish(topic, payload, length);
+}
+
+/**
+ * @brief Encodes a document into mqttPublishBuffer and publishes it in one write
+ * @tparam Encoder Payload encoder (JsonEncoder or MsgPackEncoder)
+ * @return true if the whole packet was written, false also if the
+ *         payload exceeds publishCapacity()
+ */
+template<class Encoder>
+bool publishDocument(PubSubClient& mqttClient, const char* topic, const JsonDocument& doc) {
+    size_t length = Encoder::measure(doc);
+    // + terminator written by serializeJson()
+    if (length >= sizeof(mqttPublishBuffer) || length > publishCapacity(mqttClient, topic)) {
+        Serial.printf("%u byte payload exceeds the publish buffer\n", (unsigned)length);
+        return false;
+    }
+    return Encoder::serialize(doc, (char*)mqttPublishBuffer, sizeof(mqttPublishBuffer)) == length &&
+           publishPacket(mqttClient, topic, mqttPublishBuffer, length);
+}
+
+#endif
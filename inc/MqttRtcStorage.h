@@ -0,0 +1,189 @@
+#ifndef MQTTRTCSTORAGE_H
+#define MQTTRTCSTORAGE_H
+
+#include "Arduino.h"
+#include "inc/MqttMessageQueue.h"
+
+#ifndef MQTT_RTC_QUEUE_BYTES
+#define MQTT_RTC_QUEUE_BYTES 2048    // multiple of 4
+#endif
+
+#define MQTT_RTC_MAGIC 0x4D515231    // "MQR1"
+#define MQTT_RTC_HEADER_BYTES 8
+
+// RTC persistent record ring (word array keeps records 32-bit aligned)
+RTC_DATA_ATTR uint32_t mqttRtcWords[MQTT_RTC_QUEUE_BYTES / 4];
+RTC_DATA_ATTR uint32_t mqttRtcMagic = 0;
+RTC_DATA_ATTR uint16_t mqttRtcHead = 0;
+RTC_DATA_ATTR uint16_t mqttRtcTail = 0;
+RTC_DATA_ATTR uint16_t mqttRtcCount = 0;
+
+/**
+ * @brief MqttMessageQueue storage policy keeping records in RTC slow memory
+ *
+ * Stores queued messages as compact, length-prefixed records in a byte ring
+ * placed in RTC_DATA_ATTR memory, so anything not yet published survives
+ * esp_deep_sleep_start(). Readings taken on offline wakes accumulate and are
+ * flushed together on the next successful MQTT connection.
+ *
+ * Record layout (padded to a multiple of 4 bytes):
+ * - uint16_t size: total record bytes, 0 marks a wrap to offset 0
+ * - uint16_t length: payload length without terminator
+ * - uint32_t timestamp: Unix time in seconds
+ * - topic, NUL terminated
+ * - payload, NUL terminated
+ *
+ * Records never straddle the end of the buffer so they can be published in
+ * place. Only one instance may exist since the ring lives in globals.
+ * State is validated on construction and reset if inconsistent.
+ */
+class MqttRtcStorage {
+public:
+  /**
+   * @brief Attaches to the RTC ring, resetting it on cold boot or corruption
+   */
+  MqttRtcStorage() {
+    if (mqttRtcMagic != MQTT_RTC_MAGIC || mqttRtcHead >= MQTT_RTC_QUEUE_BYTES ||
+        mqttRtcTail >= MQTT_RTC_QUEUE_BYTES) {
+      clear();
+      return;
+    }
+    if (mqttRtcCount > 0) {
+      Serial.printf("MQTT RTC queue: resuming with %u messages\n", mqttRtcCount);
+    }
+  }
+
+  /**
+   * @brief Reserves a record and returns its payload buffer
+   * @return Pointer to payloadLength + 1 bytes, or nullptr if the ring is full
+   */
+  char* append(const char* topic, size_t topicLength, size_t payloadLength, time_t timestamp) {
+    if (topicLength >= MQTT_MAX_TOPIC_LENGTH || payloadLength >= MQTT_MAX_PAYLOAD_LENGTH) {
+      return nullptr;
+    }
+
+    size_t size = (MQTT_RTC_HEADER_BYTES + topicLength + 1 + payloadLength + 1 + 3) & ~(size_t)3;
+    size_t offset;
+
+    if (mqttRtcCount == 0) {
+      mqttRtcHead = 0;
+      mqttRtcTail = 0;
+      offset = 0;
+      if (size > MQTT_RTC_QUEUE_BYTES) return nullptr;
+    } else if (mqttRtcTail > mqttRtcHead) {
+      if ((size_t)(MQTT_RTC_QUEUE_BYTES - mqttRtcTail) >= size) {
+        offset = mqttRtcTail;
+      } else if (mqttRtcHead >= size) {
+        writeU16(mqttRtcTail, 0); // wrap marker
+        offset = 0;
+      } else {
+        return nullptr;
+      }
+    } else {
+      if ((size_t)(mqttRtcHead - mqttRtcTail) < size) return nullptr;
+      offset = mqttRtcTail;
+    }
+
+    uint8_t* record = buffer() + offset;
+    writeU16(offset, size);
+    writeU16(offset + 2, payloadLength);
+    uint32_t ts = (uint32_t)timestamp;
+    memcpy(record + 4, &ts, sizeof(ts));
+    memcpy(record + MQTT_RTC_HEADER_BYTES, topic, topicLength + 1);
+
+    mqttRtcTail = (offset + size) % MQTT_RTC_QUEUE_BYTES;
+    mqttRtcCount++;
+    return (char*)(record + MQTT_RTC_HEADER_BYTES + topicLength + 1);
+  }
+
+  /**
+   * @brief Fills a view of the oldest record
+   * @return false if the ring is empty
+   */
+  bool front(MqttRecord& record) const {
+    return at(0, record);
+  }
+
+  /**
+   * @brief Fills a view of the record at a FIFO index
+   * @return false if fewer than index + 1 records are stored
+   * 
+   * Walks the ring from the head, so cost is linear in index.
+   */
+  bool at(size_t index, MqttRecord& record) const {
+    if (index >= mqttRtcCount) return false;
+
+    size_t offset = mqttRtcHead;
+    for (size_t i = 0; i < index; i++) {
+      offset += readU16(offset);
+      if (offset >= MQTT_RTC_QUEUE_BYTES || readU16(offset) == 0) offset = 0;
+    }
+
+    const uint8_t* data = buffer() + offset;
+    uint32_t ts;
+    memcpy(&ts, data + 4, sizeof(ts));
+
+    record.topic = (const char*)(data + MQTT_RTC_HEADER_BYTES);
+    record.length = readU16(offset + 2);
+    record.payload = record.topic + strlen(record.topic) + 1;
+    record.timestamp = (time_t)ts;
+    return true;
+  }
+
+  /**
+   * @brief Drops the oldest record, skipping a wrap marker if one follows
+   */
+  void popFront() {
+    if (mqttRtcCount == 0) return;
+
+    mqttRtcHead = (mqttRtcHead + readU16(mqttRtcHead)) % MQTT_RTC_QUEUE_BYTES;
+    mqttRtcCount--;
+
+    if (mqttRtcCount == 0) {
+      mqttRtcHead = 0;
+      mqttRtcTail = 0;
+    } else if (readU16(mqttRtcHead) == 0) {
+      mqttRtcHead = 0;
+    }
+  }
+
+  size_t count() const {
+    return mqttRtcCount;
+  }
+
+  /**
+   * @brief Get bytes currently occupied by records, including padding
+   */
+  size_t bytesUsed() const {
+    if (mqttRtcCount == 0) return 0;
+    if (mqttRtcTail > mqttRtcHead) return mqttRtcTail - mqttRtcHead;
+    return MQTT_RTC_QUEUE_BYTES - mqttRtcHead + mqttRtcTail;
+  }
+
+  /**
+   * @brief Drops all records and re-arms the RTC ring
+   */
+  void clear() {
+    mqttRtcHead = 0;
+    mqttRtcTail = 0;
+    mqttRtcCount = 0;
+    mqttRtcMagic = MQTT_RTC_MAGIC;
+  }
+
+private:
+  static uint8_t* buffer() {
+    return (uint8_t*)mqttRtcWords;
+  }
+
+  static uint16_t readU16(size_t offset) {
+    uint16_t v;
+    memcpy(&v, buffer() + offset, sizeof(v));
+    return v;
+  }
+
+  static void writeU16(size_t offset, uint16_t v) {
+    memcpy(buffer() + offset, &v, sizeof(v));
+  }
+};
+
+#endif
@@ -0,0 +1,214 @@
+#ifndef PHASETRACE_H
+#define PHASETRACE_H
+
+#include "Arduino.h"
+#include <ArduinoJson.h>
+
+#ifndef TRACE_BUCKETS
+#define TRACE_BUCKETS 48    // log buckets per phase, 1 ms growing by 1/4 per bucket (~28 s)
+#endif
+
+/**
+ * @brief Wake cycle phases tracked by PhaseTrace
+ */
+enum TracePhase : uint8_t {
+    PHASE_WIFI = 0,     // connectToWifi()
+    PHASE_NTP,          // NTPSync::begin() + sync()
+    PHASE_MQTT,         // connectToMqtt()
+    PHASE_SENSORS,      // SensorScheduler::checkAndUpdateAll()
+    PHASE_PUBLISH,      // sendQueuedMessages()
+    PHASE_AWAKE,        // boot until deep sleep entry
+    PHASE_COUNT
+};
+
+// RTC persistent per-phase duration histograms of the current report window
+RTC_DATA_ATTR uint16_t traceHistogram[PHASE_COUNT][TRACE_BUCKETS];
+RTC_DATA_ATTR uint32_t traceMaxUs[PHASE_COUNT];
+RTC_DATA_ATTR uint16_t traceWakesSinceReport = 0;
+
+/**
+ * @brief Lightweight span recorder for per-wake phase timing
+ *
+ * Times each wake phase (WiFi, NTP, MQTT, sensor updates, publishing,
+ * total awake time) with micros() and adds the duration to a per-phase
+ * histogram in RTC memory. The histograms survive deep sleep and cover
+ * exactly the wakes since the last summary, so the p50/p95/max published
+ * every N wakes describe that whole window regardless of its length.
+ *
+ * Buckets grow geometrically from 1 ms by 1/4, so percentiles are
+ * reported as a bucket's upper bound with at most 25% error (capped at
+ * the exact max), in 2 bytes of RTC memory per bucket.
+ *
+ * Usage:
+ * - onWake() once per boot
+ * - begin(phase) / end(phase) around each phase
+ * - publishSummary() when connected to queue one MQTT summary message
+ */
+class PhaseTrace {
+private:
+    uint32_t openStart[PHASE_COUNT];
+    uint32_t wakeUs[PHASE_COUNT];   // durations of this wake, for printWake()
+
+    static const char* phaseName(uint8_t phase) {
+        switch (phase) {
+            case PHASE_WIFI:    return "wifi";
+            case PHASE_NTP:     return "ntp";
+            case PHASE_MQTT:    return "mqtt";
+            case PHASE_SENSORS: return "sensors";
+            case PHASE_PUBLISH: return "publish";
+            case PHASE_AWAKE:   return "awake";
+            default:            return "unknown";
+        }
+    }
+
+    /**
+     * @brief Get the exclusive upper bound of a histogram bucket
+     */
+    static uint32_t bucketLimitUs(uint8_t bucket) {
+        uint32_t limit = 1000;
+        for (uint8_t i = 0; i < bucket; i++) {
+            limit += limit / 4;
+        }
+        return limit;
+    }
+
+    static uint8_t bucketOf(uint32_t durationUs) {
+        uint32_t limit = 1000;
+        uint8_t bucket = 0;
+        while (durationUs >= limit && bucket < TRACE_BUCKETS - 1) {
+            limit += limit / 4;
+            bucket++;
+        }
+        return bucket;
+    }
+
+    /**
+     * @brief Get the duration below which a given share of samples fall
+     * @param percent Percentile, 0-100
+     * @return Upper bound of the bucket holding that rank, at most the max
+     */
+    static uint32_t percentileUs(uint8_t phase, uint32_t samples, uint8_t percent) {
+        uint32_t rank = (samples - 1) * percent / 100;
+        uint32_t seen = 0;
+        for (uint8_t b = 0; b < TRACE_BUCKETS; b++) {
+            seen += traceHistogram[phase][b];
+            if (seen > rank) {
+                uint32_t limit = bucketLimitUs(b);
+                return (b < TRACE_BUCKETS - 1 && limit < traceMaxUs[phase]) ? limit : traceMaxUs[phase];
+            }
+        }
+        return traceMaxUs[phase];
+    }
+
+public:
+    /**
+     * @brief Constructs a trace recorder with no open spans
+     */
+    PhaseTrace() {
+        for (uint8_t i = 0; i < PHASE_COUNT; i++) {
+            openStart[i] = 0;
+            wakeUs[i] = 0;
+        }
+    }
+
+    /**
+     * @brief Marks the start of a new wake cycle
+     */
+    void onWake() {
+        traceWakesSinceReport++;
+    }
+
+    /**
+     * @brief Opens a span for the given phase
+     * @param phase Phase being started
+     */
+    void begin(TracePhase phase) {
+        openStart[phase] = micros();
+    }
+
+    /**
+     * @brief Closes the span opened by begin() and records it
+     * @param phase Phase being finished
+     */
+    void end(TracePhase phase) {
+        record(phase, openStart[phase], micros());
+    }
+
+    /**
+     * @brief Adds a completed span to its phase histogram
+     * @param phase Phase the span belongs to
+     * @param startUs Span start in micros()
+     * @param endUs Span end in micros()
+     */
+    void record(TracePhase phase, uint32_t startUs, uint32_t endUs) {
+        uint32_t duration = endUs - startUs;
+        uint16_t& count = traceHistogram[phase][bucketOf(duration)];
+        if (count < 0xFFFF) count++;
+        if (duration > traceMaxUs[phase]) traceMaxUs[phase] = duration;
+        wakeUs[phase] += duration;
+    }
+
+    /**
+     * @brief Check whether a summary should be published this wake
+     * @param everyWakes Number of wakes between summaries
+     * @return true once at least everyWakes wakes passed since the last summary
+     */
+    bool reportDue(uint16_t everyWakes) const {
+        return traceWakesSinceReport >= everyWakes;
+    }
+
+    /**
+     * @brief Queues a p50/p95/max summary of every phase as one MQTT message
+     * @tparam Queue MQTT message queue type
+     * @param queue Queue receiving the summary
+     * @param topic MQTT topic for the summary
+     * @return true if the summary was queued
+     *
+     * Durations are reported in milliseconds, "n" is the number of samples
+     * in the window. Phases without samples are omitted. Format:
+     * {"trace_wakes": n, "trace": {"wifi": {"n": n, "p50": ms, "p95": ms, "max": ms}, ...}}
+     *
+     * Starts a new window on success.
+     */
+    template<class Queue>
+    bool publishSummary(Queue* queue, const char* topic) {
+        JsonDocument doc;
+        doc["trace_wakes"] = traceWakesSinceReport;
+        JsonObject phases = doc["trace"].to<JsonObject>();
+
+        for (uint8_t phase = 0; phase < PHASE_COUNT; phase++) {
+            uint32_t samples = 0;
+            for (uint8_t b = 0; b < TRACE_BUCKETS; b++) {
+                samples += traceHistogram[phase][b];
+            }
+            if (samples == 0) continue;
+
+            JsonObject stats = phases[phaseName(phase)].to<JsonObject>();
+            stats["n"] = samples;
+            stats["p50"] = percentileUs(phase, samples, 50) / 1000;
+            stats["p95"] = percentileUs(phase, samples, 95) / 1000;
+            stats["max"] = traceMaxUs[phase] / 1000;
+        }
+
+        if (!queue->enqueue(topic, doc)) {
+            Serial.println("Trace: summary not queued (queue full)");
+            return false;
+        }
+        memset(traceHistogram, 0, sizeof(traceHistogram));
+        memset(traceMaxUs, 0, sizeof(traceMaxUs));
+        traceWakesSinceReport = 0;
+        return true;
+    }
+
+    /**
+     * @brief Prints phase durations recorded during the current wake
+     */
+    void printWake() const {
+        for (uint8_t phase = 0; phase < PHASE_COUNT; phase++) {
+            if (wakeUs[phase] == 0) continue;
+            Serial.printf("Trace: %s took %lu ms\n", phaseName(phase), (unsigned long)(wakeUs[phase] / 1000));
+        }
+    }
+};
+
+#endif
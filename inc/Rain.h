@@ -5,8 +5,19 @@
 #include "Arduino.h"
 #include <ArduinoJson.h>
 #include <FunctionalInterrupt.h>
+#include <atomic>
+#include "esp_sleep.h"
 #include "inc/MqttMessageQueue.h"
 #include "inc/BaseSensor.h"
+#include "inc/RainTipLog.h"
+
+#ifndef RAIN_ULP_COUNTER
+#define RAIN_ULP_COUNTER 1  // count tips on the ULP instead of waking the CPU per tip
+#endif
+
+#if RAIN_ULP_COUNTER
+#include "inc/UlpRainCounter.h"
+#endif
 
 // Forward declarations
 class PubSubClient;
@@ -17,15 +28,51 @@ class PubSubClient;
 //persistent data
 RTC_DATA_ATTR int bootCount = 0;
 RTC_DATA_ATTR int latest_Raincount = 0;
+RTC_DATA_ATTR std::atomic<uint32_t> rainPendingTips{0};  // tips counted by isr(), not yet in latest_Raincount
 
 // Rain gauge persistent timing data
 RTC_DATA_ATTR unsigned long rainGaugeLastUpdate = 0;
 
+// Rain gauge persistent rate tracking
+RTC_DATA_ATTR time_t rainLastReadTime = 0;         // time() of the last scheduled read
+RTC_DATA_ATTR time_t rainLastTipTime = 0;          // time() of the last tip, 0 if unknown
+RTC_DATA_ATTR uint32_t rainTipIntervalMs = 0;      // smoothed time between recent tips, 0 if unknown
+RTC_DATA_ATTR uint32_t rainRateTipsPerHour = 0;    // rate from the recent tip intervals
+RTC_DATA_ATTR uint16_t rainDryReads = 0;           // consecutive reads without tips
+
 float unit_of_rain = 0.01193;//inches per pulse
 
+#ifndef RAIN_ALERT_TIPS_PER_HOUR
+#define RAIN_ALERT_TIPS_PER_HOUR 180      // ~2.1 in/h since the last read triggers an immediate report
+#endif
+#ifndef RAIN_ALERT_MIN_TIPS
+#define RAIN_ALERT_MIN_TIPS 3             // tips needed before the alert rate is judged (~0.036 in)
+#endif
+#ifndef RAIN_INTENSE_TIPS_PER_HOUR
+#define RAIN_INTENSE_TIPS_PER_HOUR 120    // ~1.4 in/h, report at the intense cadence
+#endif
+#ifndef RAIN_DRY_READS
+#define RAIN_DRY_READS 15                 // dry reads before stretching the cadence
+#endif
+#ifndef RAIN_RATE_SMOOTHING
+#define RAIN_RATE_SMOOTHING 4             // tips in the moving average of tip intervals
+#endif
+#ifndef RAIN_SHOWER_GAP_S
+#define RAIN_SHOWER_GAP_S 1800            // a longer pause ends the shower and its rate
+#endif
+#ifndef RAIN_INTERVAL_INTENSE_MS
+#define RAIN_INTERVAL_INTENSE_MS 20000
+#endif
+#ifndef RAIN_INTERVAL_MS
+#define RAIN_INTERVAL_MS 60000
+#endif
+#ifndef RAIN_INTERVAL_DRY_MS
+#define RAIN_INTERVAL_DRY_MS 300000
+#endif
+
 /**
  * @brief Tipping bucket rain gauge interface with interrupt-driven measurement
- * @tparam QUEUE_SIZE The size of the MQTT message queue
+ * @tparam Queue The MqttMessageQueue type used for message buffering
  * 
  * This template class provides a complete interface for tipping bucket rain gauges
  * with interrupt-based rain detection and MQTT integration. Features:
@@ -39,8 +86,28 @@ float unit_of_rain = 0.01193;//inches per pulse
  * 
  * Uses RTC_DATA_ATTR variables to maintain rain counts across ESP32 deep sleep cycles.
  * Handles both active rain detection and scheduled periodic updates.
+ *
+ * With RAIN_ULP_COUNTER (default) tips are counted by UlpRainCounter while
+ * the CPU sleeps and collected on each scheduled update; otherwise every
+ * tip wakes the CPU via ext0 and is counted by isr().
+ *
+ * The rain rate is measured from the time between tips: a moving average
+ * over about RAIN_RATE_SMOOTHING tip intervals, decaying as the time since
+ * the last tip grows past it and cleared after RAIN_SHOWER_GAP_S without
+ * a tip. Tips without a time stamp are spread over their read interval.
+ * Reporting cadence adapts to this rate:
+ * RAIN_INTERVAL_INTENSE_MS above RAIN_INTENSE_TIPS_PER_HOUR,
+ * RAIN_INTERVAL_DRY_MS after RAIN_DRY_READS dry reads, RAIN_INTERVAL_MS
+ * otherwise. Bursts are reported without waiting: once RAIN_ALERT_MIN_TIPS
+ * are pending (the ULP wakes the CPU at that count), needsUpdate() is
+ * raised if they fell at RAIN_ALERT_TIPS_PER_HOUR or more since the last
+ * read; a slow drizzle reaching the same count is left to the cadence.
+ *
+ * Individual tip times go to a RainTipLog uploaded with publishTipLog().
+ * The ULP stamps tips itself; without it, tips that wake the CPU via ext0
+ * are logged at boot and tips while awake are only counted.
  */
-template<size_t QUEUE_SIZE>
+template<class Queue>
 class Raingauge : public BaseSensor {
   
 public:
@@ -51,29 +118,48 @@ public:
    * @param q Pointer to MqttMessageQueue for message buffering
    * @param top MQTT topic string for rainfall data publication
    * 
-   * Configures GPIO as INPUT_PULLUP for tipping bucket, sets up MQTT
-   * integration, initializes timing for interrupt debouncing.
-   * Pin connects to normally-closed bucket that pulls LOW on tip.
+   * Sets up MQTT integration and initializes timing for interrupt
+   * debouncing. The pin is configured in begin(): left to the ULP counter's
+   * RTC IO setup, or INPUT_PULLUP for the interrupt path. Pin connects to
+   * normally-closed bucket that pulls LOW on tip.
    */
-  Raingauge(uint8_t reqPin, PubSubClient* cli, MqttMessageQueue<QUEUE_SIZE>* q, String top) 
+  Raingauge(uint8_t reqPin, PubSubClient* cli, Queue* q, String top) 
   : PIN(reqPin),client(cli),tx_queue(q),topic(top)
+#if RAIN_ULP_COUNTER
+  ,ulpCounter(reqPin)
+#endif
   {
-    
-    pinMode(PIN, INPUT_PULLUP);
     _lastMillis = millis();
   };
 
   /**
-   * @brief Initializes interrupt-based rain detection and begins operation
+   * @brief Initializes rain detection and begins operation
    * 
-   * Attaches hardware interrupt to GPIO pin for tipping bucket detection.
-   * FALLING edge trigger when bucket tips and pulls pin LOW.
+   * Starts the ULP tip counter when enabled; the digital GPIO setup is
+   * then skipped, since pinMode() would move the pad off the RTC IO mux.
+   * Otherwise (or if the ULP fails to start) configures INPUT_PULLUP,
+   * attaches a hardware interrupt to the GPIO pin and enables ext0
+   * wakeup. FALLING edge trigger when bucket tips and pulls pin LOW.
    * 
    * Call once during setup. Interrupt active until destructor called.
    * Prints initialization confirmation to serial.
    */
   void begin(){
+#if !RAIN_ULP_COUNTER
+    if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_EXT0) {
+      recordTip(time(nullptr)); // the tip that woke us
+    }
+#else
+    if (ulpCounter.begin()) {
+      // tips the CPU woke for but judged too slow don't keep the alert spent
+      ulpCounter.armAlert(ulpCounter.pendingTips() + RAIN_ALERT_MIN_TIPS);
+      Serial.printf("Started Raingauge on pin %d (ULP counter)\n", PIN);
+      return;
+    }
+#endif
+    pinMode(PIN, INPUT_PULLUP);
     attachInterrupt(PIN, std::bind(&Raingauge::isr,this), FALLING);
+    esp_sleep_enable_ext0_wakeup((gpio_num_t)PIN, 0); // every tip wakes the CPU
     Serial.printf("Started Raingauge on pin %d\n", PIN);
   }
 
@@ -93,18 +179,30 @@ public:
    * Called when bucket tips and pulls pin LOW. 100ms debouncing prevents
    * mechanical bounce while allowing rapid rain detection.
    * 
-   * Process: Check debounce time, increment counters, update RTC data,
-   * set rain flags, update timestamp.
-   * 
+   * Only does a lock-free atomic increment of the pending tip count; the
+   * main loop takes the tips with takePendingTips(). The count lives in RTC
+   * memory, so a tip after the last take still survives deep sleep and is
+   * taken on the next wake. _lastMillis is only touched here.
    */
   void ARDUINO_ISR_ATTR isr(){
-    if(millis()-_lastMillis > 100) {
-      _rainBucketsDumped += 1;
-      latest_Raincount += _rainBucketsDumped;
-      _lastMillis = millis();
+    unsigned long now = millis();
+    if(now - _lastMillis > 100) {
+      rainPendingTips.fetch_add(1, std::memory_order_relaxed);
+      _lastMillis = now;
     }
   }
 
+  /**
+   * @brief Moves tips counted by the ISR into the RTC rain count
+   * 
+   * Atomic exchange snapshots and zeroes the pending count in one step, so
+   * a tip arriving concurrently is either in this snapshot or the next,
+   * never lost or counted twice.
+   */
+  void takePendingTips() {
+    latest_Raincount += rainPendingTips.exchange(0, std::memory_order_relaxed);
+  }
+
 
   /**
    * @brief Checks if active rainfall has been detected
@@ -129,17 +227,16 @@ public:
    */
   void updateRain(){
 
-    static unsigned long hourCount = 0;
-
     //if it rained this hour print the stats
     float rainLastHour = 0.0;
     if (isRaining()) {
       rainLastHour = (float)latest_Raincount*unit_of_rain; //inches per bucket
       Serial.printf("Update: Rainfall LastHour=%f inches\n", rainLastHour);
-      
-      _rainBucketsDumped = 0;
     } 
 
+    updateRate(latest_Raincount);
+    _heavyRain = latest_Raincount >= RAIN_ALERT_MIN_TIPS && rainRateTipsPerHour >= RAIN_ALERT_TIPS_PER_HOUR;
+
     JsonDocument myObject;
     myObject["rain"] = rainLastHour;
     tx_queue->enqueue(topic.c_str(), myObject);
@@ -147,6 +244,82 @@ public:
     latest_Raincount = 0;
   }
 
+  /**
+   * @brief Logs a tip and folds the time since the previous tip into the rate
+   * @param tipTime time() of the tip
+   *
+   * A tip after more than RAIN_SHOWER_GAP_S starts a new shower: its rate
+   * is unknown until the next tip.
+   */
+  void recordTip(time_t tipTime) {
+    tipLog.log(tipTime);
+    if (rainLastTipTime > 0 && tipTime >= rainLastTipTime) {
+      if (tipTime - rainLastTipTime > RAIN_SHOWER_GAP_S) {
+        rainTipIntervalMs = 0;
+      } else {
+        addTipInterval((uint32_t)(tipTime - rainLastTipTime) * 1000UL);
+      }
+    }
+    rainLastTipTime = tipTime;
+  }
+
+  /**
+   * @brief Adds one tip interval to the moving average
+   * @param intervalMs Time between two tips, stamps have 1 s resolution
+   */
+  static void addTipInterval(uint32_t intervalMs) {
+    if (intervalMs < 1000) intervalMs = 1000; // tips within the same second
+    if (rainTipIntervalMs == 0) {
+      rainTipIntervalMs = intervalMs;
+    } else {
+      rainTipIntervalMs = rainTipIntervalMs - rainTipIntervalMs / RAIN_RATE_SMOOTHING + intervalMs / RAIN_RATE_SMOOTHING;
+    }
+  }
+
+  /**
+   * @brief Updates the RTC rain rate from the recent tip intervals
+   * @param tips Tips counted since the previous read
+   * 
+   * Tips of a read without a time stamp (interrupt-path tips while awake,
+   * or all of them if the ULP stamps are lost) count as evenly spread
+   * over the read interval. The rate is one tip per average interval, or
+   * per time since the last tip once that is longer, so it decays while
+   * the rain stops.
+   */
+  void updateRate(uint32_t tips) {
+    time_t now = time(nullptr);
+    unsigned long elapsedMs = getUpdateInterval();
+    if (rainLastReadTime > 0 && now > rainLastReadTime) {
+      elapsedMs = (unsigned long)(now - rainLastReadTime) * 1000UL;
+    }
+    if (tips > 0 && rainLastTipTime <= rainLastReadTime) {
+      for (uint32_t i = 0; i < tips && i < RAIN_RATE_SMOOTHING; i++) {
+        addTipInterval(elapsedMs / tips);
+      }
+      rainLastTipTime = now;
+    }
+    rainLastReadTime = now;
+
+    unsigned long sinceTipMs = 0;
+    if (rainLastTipTime > 0 && now > rainLastTipTime) {
+      if (now - rainLastTipTime > RAIN_SHOWER_GAP_S) {
+        rainTipIntervalMs = 0; // shower over
+      } else {
+        sinceTipMs = (unsigned long)(now - rainLastTipTime) * 1000UL;
+      }
+    }
+    unsigned long spacingMs = (sinceTipMs > rainTipIntervalMs) ? sinceTipMs : rainTipIntervalMs;
+    rainRateTipsPerHour = (rainTipIntervalMs > 0) ? (uint32_t)(3600000UL / spacingMs) : 0;
+    if (tips > 0) {
+      rainDryReads = 0;
+    } else if (rainDryReads < RAIN_DRY_READS) {
+      rainDryReads++;
+    }
+    Serial.printf("Rain rate: %lu tips/h (%f in/h, %lu ms between tips), next report in %lu ms\n",
+                  (unsigned long)rainRateTipsPerHour, rainRateTipsPerHour * unit_of_rain,
+                  (unsigned long)rainTipIntervalMs, getUpdateInterval());
+  }
+
   /**
    * @brief Prints detailed rainfall statistics to serial console for debugging
    * 
@@ -164,25 +337,101 @@ public:
   /**
    * @brief Main processing method for scheduled rainfall updates
    * 
-   * Called by SensorScheduler during scheduled updates only.
+   * Called by SensorScheduler on scheduled updates and on rain alerts.
    * Processes accumulated rain data and transmits via MQTT.
    * 
    * Process: Report debug info and update/transmit rainfall data.
    * 
-   * Only called during scheduled intervals, not on rain interrupts.
+   * Not called from the rain interrupt or the ULP counter directly.
    */
   void handle() {
+#if RAIN_ULP_COUNTER
+    time_t tipTimes[ULP_RAIN_RING_LENGTH];
+    uint16_t timed;
+    uint16_t tips = ulpCounter.takeTips(tipTimes, ULP_RAIN_RING_LENGTH, timed);
+    for (uint16_t i = 0; i < timed; i++) {
+      recordTip(tipTimes[i]);
+    }
+    latest_Raincount += tips;
+    ulpCounter.armAlert(RAIN_ALERT_MIN_TIPS);
+#endif
+    takePendingTips();
+    tipLog.reconcile(latest_Raincount);
     reportRain();
     updateRain();
   }
 
   // BaseSensor interface implementation
   unsigned long getUpdateInterval() override {
-    return 60000; // 60 seconds for rain gauge
+    if (rainRateTipsPerHour >= RAIN_INTENSE_TIPS_PER_HOUR) {
+      return RAIN_INTERVAL_INTENSE_MS; // cloudburst, report often
+    }
+    if (rainDryReads >= RAIN_DRY_READS) {
+      return RAIN_INTERVAL_DRY_MS; // dry spell, save power
+    }
+    return RAIN_INTERVAL_MS;
+  }
+  
+  unsigned long getUpdateTolerance() override {
+    return 5000; // rain totals are summed, a few seconds early is harmless
   }
   
+  /**
+   * @brief Checks for a rain burst worth reporting before the next read
+   * @return true if RAIN_ALERT_MIN_TIPS or more tips are pending and they
+   *         fell at RAIN_ALERT_TIPS_PER_HOUR or more since the last read
+   * 
+   * Without a valid clock or earlier read, the pending tips are spread over
+   * a full update interval.
+   */
   bool needsUpdate() override {
-    return false; // Only scheduled updates via SensorScheduler
+#if RAIN_ULP_COUNTER
+    uint32_t pending = latest_Raincount + ulpCounter.pendingTips();
+#else
+    uint32_t pending = latest_Raincount + rainPendingTips.load(std::memory_order_relaxed);
+#endif
+    if (pending < RAIN_ALERT_MIN_TIPS) return false;
+
+    time_t now = time(nullptr);
+    unsigned long elapsedMs = getUpdateInterval();
+    if (rainLastReadTime > 0 && now > rainLastReadTime) {
+      elapsedMs = (unsigned long)(now - rainLastReadTime) * 1000UL;
+    }
+    return (uint64_t)pending * 3600000ULL >= (uint64_t)RAIN_ALERT_TIPS_PER_HOUR * elapsedMs;
+  }
+  
+  bool isEventDriven() override {
+    return true; // burst alerts via needsUpdate()
+  }
+  
+  bool hasPriorityData() override {
+    // heavy rain, or a tip log about to overflow, is sent without waiting for the transmit watermark
+    return _heavyRain || tipLog.nearlyFull();
+  }
+  
+  /**
+   * @brief Uploads the per-tip log on "<topic>tips"
+   * @return true if the log was written, false if empty or the publish failed
+   * 
+   * Call on transmit wakes while MQTT is connected; the log is kept until
+   * clearTipLog().
+   */
+  bool publishTipLog() {
+    return tipLog.publish(*client, topic.c_str());
+  }
+
+  /**
+   * @brief Check if the tip log still holds tips not confirmed by the broker
+   */
+  bool tipLogPending() const {
+    return tipLog.pending();
+  }
+
+  /**
+   * @brief Empties the tip log after the broker confirmed its upload
+   */
+  void clearTipLog() {
+    tipLog.clear();
   }
   
   String getSensorId() override {
@@ -196,11 +445,14 @@ public:
 private:
     const uint8_t PIN;
     PubSubClient* client;
-    MqttMessageQueue<QUEUE_SIZE>* tx_queue;
+    Queue* tx_queue;
     String topic;
-    volatile uint32_t _rainBucketsDumped;
-    volatile bool _rain = false;
     volatile unsigned long _lastMillis = 0;
+    bool _heavyRain = false;
+    RainTipLog tipLog;
+#if RAIN_ULP_COUNTER
+    UlpRainCounter ulpCounter;
+#endif
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,138 @@
+#ifndef RAINTIPLOG_H
+#define RAINTIPLOG_H
+
+#include "Arduino.h"
+#include <ArduinoJson.h>
+#include <PubSubClient.h>
+#include "inc/MqttMessageQueue.h"
+#include "inc/MqttPublish.h"
+
+#ifndef RAIN_TIP_LOG_LENGTH
+#define RAIN_TIP_LOG_LENGTH 128
+#endif
+
+#define RAIN_TIP_LOG_MAX_DELTA 0xFFFF   // seconds (~18 h) between logged tips
+
+// RTC persistent tip log (survives deep sleep until uploaded)
+RTC_DATA_ATTR uint16_t rainTipLogDeltas[RAIN_TIP_LOG_LENGTH];
+RTC_DATA_ATTR uint16_t rainTipLogCount = 0;
+RTC_DATA_ATTR time_t rainTipLogFirst = 0;        // time of the first logged tip
+RTC_DATA_ATTR time_t rainTipLogLast = 0;         // time of the last logged tip
+RTC_DATA_ATTR uint32_t rainTipLogDropped = 0;    // tips only in the aggregate "rain" total
+RTC_DATA_ATTR uint32_t rainTipLogPeriod = 0;     // tips logged since the last reconcile()
+
+/**
+ * @brief RTC log of individual bucket tip times, uploaded in bulk
+ *
+ * Each tip is stored as a 16-bit delta in seconds to the previous logged
+ * tip, so the backend can rebuild 1-minute intensity curves while the
+ * device keeps its normal transmit cadence. The log is published on
+ * "<topic>tips" as:
+ *
+ * {"t0": first_tip_unix_time, "dt": [0, 12, 9, ...], "dropped": n}
+ *
+ * Tip i happened at t0 + dt[0] + ... + dt[i]. When the log is full, the
+ * clock is not valid yet, or a gap exceeds RAIN_TIP_LOG_MAX_DELTA, tips
+ * are only counted in "dropped"; they are still part of the aggregate
+ * {"rain": inches} readings.
+ */
+class RainTipLog {
+public:
+    /**
+     * @brief Logs one tip
+     * @param tipTime Unix time of the tip
+     */
+    void log(time_t tipTime) {
+        if (rainTipLogCount >= RAIN_TIP_LOG_LENGTH || tipTime < 1000000000) {
+            rainTipLogDropped++;
+            return;
+        }
+
+        uint16_t delta = 0;
+        if (rainTipLogCount == 0) {
+            rainTipLogFirst = tipTime;
+            rainTipLogLast = tipTime;
+        } else if (tipTime > rainTipLogLast) {
+            if (tipTime - rainTipLogLast > RAIN_TIP_LOG_MAX_DELTA) {
+                rainTipLogDropped++;
+                return;
+            }
+            delta = (uint16_t)(tipTime - rainTipLogLast);
+            rainTipLogLast = tipTime;
+        } // clock stepped back (NTP correction): log with delta 0
+        rainTipLogDeltas[rainTipLogCount++] = delta;
+        rainTipLogPeriod++;
+    }
+
+    /**
+     * @brief Counts tips of a read period that were not logged individually
+     * @param tips Tips counted by the gauge since the last reconcile()
+     */
+    void reconcile(uint32_t tips) {
+        if (tips > rainTipLogPeriod) {
+            rainTipLogDropped += tips - rainTipLogPeriod;
+        }
+        rainTipLogPeriod = 0;
+    }
+
+    size_t count() const {
+        return rainTipLogCount;
+    }
+
+    /**
+     * @brief Check if tips or a dropped count wait for a confirmed upload
+     */
+    bool pending() const {
+        return rainTipLogCount > 0 || rainTipLogDropped > 0;
+    }
+
+    /**
+     * @brief Check if the log is at least 3/4 full and should be uploaded
+     */
+    bool nearlyFull() const {
+        return rainTipLogCount >= RAIN_TIP_LOG_LENGTH * 3 / 4;
+    }
+
+    /**
+     * @brief Publishes the log on "<topic>tips"
+     * @return true if the log was written, false if empty or the publish failed
+     *
+     * The log is kept until clear(), so it is sent again if the broker
+     * never confirms receipt.
+     */
+    bool publish(PubSubClient& mqttClient, const char* topic) {
+        if (rainTipLogCount == 0 && rainTipLogDropped == 0) return false;
+
+        char tipsTopic[MQTT_MAX_TOPIC_LENGTH];
+        snprintf(tipsTopic, sizeof(tipsTopic), "%stips", topic);
+
+        JsonDocument doc;
+        if (rainTipLogCount > 0) {
+            doc["t0"] = rainTipLogFirst;
+        }
+        JsonArray deltas = doc["dt"].to<JsonArray>();
+        for (uint16_t i = 0; i < rainTipLogCount; i++) {
+            deltas.add(rainTipLogDeltas[i]);
+        }
+        doc["dropped"] = rainTipLogDropped;
+
+        size_t length = measureJson(doc);
+        Serial.printf("Sending tip log: %u tips, %lu dropped (%u bytes)\n",
+                     rainTipLogCount, (unsigned long)rainTipLogDropped, (unsigned)length);
+        if (!publishDocument<JsonEncoder>(mqttClient, tipsTopic, doc)) {
+            Serial.println("Tip log publish failed, kept for next transmit");
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Empties the log once its upload was confirmed
+     */
+    void clear() {
+        rainTipLogCount = 0;
+        rainTipLogDropped = 0;
+    }
+};
+
+#endif
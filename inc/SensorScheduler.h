@@ -3,13 +3,42 @@
 
 #include "Arduino.h"
 #include "inc/BaseSensor.h"
+#include <ArduinoJson.h>
 #include <vector>
+#include <algorithm>
 #include "esp_sleep.h"
+#include "esp_rtc_time.h"
 
 // RTC persistent variables for scheduler timing
 RTC_DATA_ATTR unsigned long schedulerLastWakeTime = 0;
 RTC_DATA_ATTR unsigned long schedulerSleepDuration = 0;
+RTC_DATA_ATTR uint64_t schedulerSleepStartUs = 0;       // RTC clock when prepareSleep() ran
 
+#ifndef SCHEDULER_MAX_SENSORS
+#define SCHEDULER_MAX_SENSORS 8                 // sensors with RTC health tracking
+#endif
+
+// RTC persistent wake coalescing statistics
+RTC_DATA_ATTR unsigned long schedulerSensorWakes = 0;     // wakes that ran sensors
+RTC_DATA_ATTR unsigned long schedulerCoalescedRuns = 0;   // runs pulled into an earlier wake
+RTC_DATA_ATTR unsigned long schedulerWakesSaved = 0;      // deadlines of pulled runs no wake landed on
+RTC_DATA_ATTR unsigned long schedulerSkippedDeadlines[SCHEDULER_MAX_SENSORS];  // not yet passed
+RTC_DATA_ATTR uint8_t schedulerSkippedCount = 0;
+#ifndef SENSOR_RETRY_BASE_MS
+#define SENSOR_RETRY_BASE_MS 300000UL           // first retry of a failed sensor after 5 min
+#endif
+#ifndef SENSOR_RETRY_MAX_MS
+#define SENSOR_RETRY_MAX_MS 21600000UL          // backoff doubles up to one retry every 6 h
+#endif
+#ifndef SCHEDULER_HEALTH_REPORT_MS
+#define SCHEDULER_HEALTH_REPORT_MS 21600000UL   // health and coalescing report at least every 6 h
+#endif
+
+// RTC persistent sensor health, indexed by registration order
+RTC_DATA_ATTR uint8_t schedulerSensorFailures[SCHEDULER_MAX_SENSORS];        // consecutive faults, 0 if healthy
+RTC_DATA_ATTR unsigned long schedulerSensorFailedAt[SCHEDULER_MAX_SENSORS];  // wake time of the last fault
+RTC_DATA_ATTR bool schedulerHealthChanged = false;                          // changed since the last health report
+RTC_DATA_ATTR unsigned long schedulerHealthReportedAt = 0;                  // wake time of the last health report
 
 /**
  * @brief Manages sensor update scheduling for ESP32 deep sleep cycles
@@ -17,6 +46,22 @@ RTC_DATA_ATTR unsigned long schedulerSleepDuration = 0;
  * Coordinates multiple sensors with different update intervals across deep sleep
  * wake cycles. Uses RTC persistent variables to track timing since millis() 
  * resets to 0 on each wake. Optimizes sleep duration based on sensor needs.
+ *
+ * Enabled sensors are kept in an index ordered by time until their next
+ * update, so the next wake time is read from the front in O(1) and due
+ * sensors are visited in O(k). Only sensors that report isEventDriven()
+ * are polled through needsUpdate().
+ *
+ * Wake coalescing: a sensor whose deadline is within its
+ * getUpdateTolerance() of the current wake runs early on that wake instead
+ * of causing its own wake (and radio session) shortly after.
+ *
+ * Sensor health: a sensor that reports !isHealthy() after begin() or
+ * handle() is disabled through removeSensor(). addSensor() skips begin()
+ * on later wakes until a backoff of SENSOR_RETRY_BASE_MS, doubling per
+ * consecutive fault up to SENSOR_RETRY_MAX_MS, has passed. Faults and
+ * recoveries are reported with publishHealth(), as are the wakes saved
+ * by coalescing every SCHEDULER_HEALTH_REPORT_MS.
  */
 class SensorScheduler {
 private:
@@ -28,20 +73,178 @@ private:
         unsigned long interval;     // Update interval in milliseconds
         unsigned long* lastUpdate;  // Pointer to RTC persistent last update time
         bool enabled;              // Whether this sensor is active
+        String id;                  // Cached getSensorId()
+        unsigned long tolerance;    // Cached getUpdateTolerance()
+        unsigned long dueIn;        // Milliseconds from currentWakeTime until due, 0 if due
         
-        SensorTask(BaseSensor* s, unsigned long inter, unsigned long* lastUpd) 
-            : sensor(s), interval(inter), lastUpdate(lastUpd), enabled(true) {}
+        SensorTask(BaseSensor* s, unsigned long inter, unsigned long* lastUpd, const String& sensorId) 
+            : sensor(s), interval(inter), lastUpdate(lastUpd), enabled(true), id(sensorId), tolerance(0), dueIn(0) {}
     };
     
     std::vector<SensorTask> tasks;
+    std::vector<size_t> schedule;     // Enabled task indices ordered by (dueIn, index)
+    std::vector<size_t> eventDriven;  // Enabled task indices polled via needsUpdate()
     unsigned long currentWakeTime;
+    unsigned long maxTolerance;       // Largest tolerance of any task, bounds the coalescing scan
     bool firstBoot;
+    bool priorityData;                // A sensor raised priority data this wake
+    
+    /**
+     * @brief Compute time until a task is due in the current wake's timebase
+     * 
+     * Never-run sensors and timing resyncs (lastUpdate ahead of the current
+     * wake time) are due immediately.
+     */
+    unsigned long computeDueIn(const SensorTask& task) const {
+        if (*task.lastUpdate == 0 || currentWakeTime < *task.lastUpdate) return 0;
+        unsigned long timeSinceUpdate = currentWakeTime - *task.lastUpdate;
+        return (timeSinceUpdate >= task.interval) ? 0 : task.interval - timeSinceUpdate;
+    }
+    
+    bool scheduledBefore(size_t a, size_t b) const {
+        if (tasks[a].dueIn != tasks[b].dueIn) return tasks[a].dueIn < tasks[b].dueIn;
+        return a < b;
+    }
+    
+    void insertScheduled(size_t index) {
+        auto pos = std::upper_bound(schedule.begin(), schedule.end(), index,
+            [this](size_t a, size_t b) { return scheduledBefore(a, b); });
+        schedule.insert(pos, index);
+    }
+    
+    static void eraseIndex(std::vector<size_t>& list, size_t index) {
+        list.erase(std::remove(list.begin(), list.end(), index), list.end());
+    }
+    
+    /**
+     * @brief Get the retry backoff after a number of consecutive faults
+     */
+    static unsigned long retryBackoff(uint8_t failures) {
+        unsigned long backoff = SENSOR_RETRY_BASE_MS;
+        for (uint8_t i = 1; i < failures && backoff < SENSOR_RETRY_MAX_MS; i++) {
+            backoff *= 2;
+        }
+        return (backoff < SENSOR_RETRY_MAX_MS) ? backoff : SENSOR_RETRY_MAX_MS;
+    }
+    
+    /**
+     * @brief Get milliseconds until a faulted task may retry begin()
+     * @return 0 if the task is healthy or its backoff has passed
+     */
+    unsigned long retryIn(size_t index) const {
+        if (index >= SCHEDULER_MAX_SENSORS || schedulerSensorFailures[index] == 0) return 0;
+        unsigned long backoff = retryBackoff(schedulerSensorFailures[index]);
+        unsigned long elapsed = currentWakeTime - schedulerSensorFailedAt[index];
+        return (elapsed < backoff) ? backoff - elapsed : 0;
+    }
+    
+    /**
+     * @brief Record a fault of a task and disable it until its retry
+     */
+    void recordFault(size_t index) {
+        SensorTask& task = tasks[index];
+        if (index < SCHEDULER_MAX_SENSORS) {
+            if (schedulerSensorFailures[index] < 255) schedulerSensorFailures[index]++;
+            schedulerSensorFailedAt[index] = currentWakeTime;
+            schedulerHealthChanged = true;
+            Serial.printf("Sensor %s fault #%u, retry in %lu ms\n", task.id.c_str(),
+                         schedulerSensorFailures[index], retryIn(index));
+        }
+        removeSensor(task.id);
+    }
+    
+    /**
+     * @brief Record a successful update, clearing earlier faults
+     */
+    void recordHealthy(size_t index) {
+        if (index >= SCHEDULER_MAX_SENSORS || schedulerSensorFailures[index] == 0) return;
+        Serial.printf("Sensor %s recovered after %u faults\n", tasks[index].id.c_str(),
+                     schedulerSensorFailures[index]);
+        schedulerSensorFailures[index] = 0;
+        schedulerHealthChanged = true;
+    }
     
+    /**
+     * @brief Run one task and move it back into the schedule by its new deadline
+     */
+    void runTask(size_t index, bool intervalDue, bool immediateNeed) {
+        SensorTask& task = tasks[index];
+        Serial.printf("Updating sensor %s (interval: %s, immediate: %s, firstBoot: %s, early: %lu ms)\n", 
+                     task.id.c_str(),
+                     (intervalDue && !firstBoot) ? "YES" : "NO",
+                     immediateNeed ? "YES" : "NO",
+                     firstBoot ? "YES" : "NO",
+                     task.dueIn);
+        
+        task.sensor->handle();
+        *task.lastUpdate = currentWakeTime;
+        if (!task.sensor->isHealthy()) {
+            recordFault(index);
+            return;
+        }
+        recordHealthy(index);
+        if (task.sensor->hasPriorityData()) {
+            Serial.printf("Sensor %s raised priority data\n", task.id.c_str());
+            priorityData = true;
+        }
+        
+        eraseIndex(schedule, index);
+        task.interval = task.sensor->getUpdateInterval(); // adaptive sensors may change cadence
+        task.dueIn = task.interval;
+        insertScheduled(index);
+    }
+    
+    /**
+     * @brief Find the first event-driven sensor with an immediate need
+     * @return Task index, or tasks.size() if none
+     */
+    size_t findImmediateNeed() {
+        for (size_t index : eventDriven) {
+            if (tasks[index].sensor->needsUpdate()) return index;
+        }
+        return tasks.size();
+    }
+    
+    /**
+     * @brief Remembers the deadline of a run that was pulled into this wake
+     *
+     * The run saved a wake only if no later wake lands on that deadline
+     * anyway; settleSkippedDeadlines() decides once the deadline has passed.
+     */
+    void skipDeadline(unsigned long deadline) {
+        for (uint8_t i = 0; i < schedulerSkippedCount; i++) {
+            if (schedulerSkippedDeadlines[i] == deadline) return;
+        }
+        if (schedulerSkippedCount < SCHEDULER_MAX_SENSORS) {
+            schedulerSkippedDeadlines[schedulerSkippedCount++] = deadline;
+        }
+    }
+
+    /**
+     * @brief Counts skipped deadlines this wake went past as saved wakes
+     *
+     * A deadline equal to the current wake time was not saved: the device
+     * wakes then regardless.
+     */
+    void settleSkippedDeadlines() {
+        uint8_t kept = 0;
+        if (schedulerSkippedCount > SCHEDULER_MAX_SENSORS) schedulerSkippedCount = 0;
+        for (uint8_t i = 0; i < schedulerSkippedCount; i++) {
+            long left = (long)(schedulerSkippedDeadlines[i] - currentWakeTime);
+            if (left < 0) {
+                schedulerWakesSaved++;
+            } else if (left > 0) {
+                schedulerSkippedDeadlines[kept++] = schedulerSkippedDeadlines[i];
+            }
+        }
+        schedulerSkippedCount = kept;
+    }
+
 public:
     /**
      * @brief Constructor initializes timing for current wake cycle
      */
-    SensorScheduler() {
+    SensorScheduler() : maxTolerance(0), priorityData(false) {
         esp_sleep_wakeup_cause_t wakeup_reason = esp_sleep_get_wakeup_cause();
         
         if (schedulerLastWakeTime == 0) {
@@ -49,44 +252,70 @@ public:
             currentWakeTime = millis();
             firstBoot = true;
             Serial.printf("First boot detected - currentWakeTime: %lu\n", currentWakeTime);
+        } else if (wakeup_reason != ESP_SLEEP_WAKEUP_TIMER) {
+            // Rain interrupt or ULP alert: the sleep was cut short, advance
+            // only by the time actually slept (RTC clock keeps running)
+            uint64_t sleptMs = (esp_rtc_get_time_us() - schedulerSleepStartUs) / 1000;
+            if (sleptMs > schedulerSleepDuration) sleptMs = schedulerSleepDuration;
+            currentWakeTime = schedulerLastWakeTime + (unsigned long)sleptMs;
+            Serial.printf("Early wake after %lu of %lu ms - currentWakeTime: %lu\n",
+                         (unsigned long)sleptMs, schedulerSleepDuration, currentWakeTime);
+            firstBoot = false;
         } else {
-            // Always advance by full intended duration regardless of wake reason
-            // This ensures timer-based sensor scheduling isn't disrupted by rain interrupts
+            // Timer wakes land on the planned time
             currentWakeTime = schedulerLastWakeTime + schedulerSleepDuration;
-            
-            if (wakeup_reason == ESP_SLEEP_WAKEUP_EXT0) {
-                Serial.printf("Rain wake - treating as timer wake for scheduling: %lu (last: %lu + duration: %lu)\n", 
-                             currentWakeTime, schedulerLastWakeTime, schedulerSleepDuration);
-            } else {
-                Serial.printf("Timer wake - currentWakeTime: %lu (last: %lu + duration: %lu)\n", 
-                             currentWakeTime, schedulerLastWakeTime, schedulerSleepDuration);
-            }
+            Serial.printf("Timer wake - currentWakeTime: %lu (last: %lu + duration: %lu)\n", 
+                         currentWakeTime, schedulerLastWakeTime, schedulerSleepDuration);
             firstBoot = false;
         }
+        settleSkippedDeadlines();
     }
     
     /**
      * @brief Add a sensor to the scheduling system
      * @param sensor Pointer to sensor implementing BaseSensor interface
      * 
-     * Registers sensor with scheduler using its getUpdateInterval().
-     * Calls sensor->begin() to initialize hardware.
+     * Registers sensor with scheduler using its getUpdateInterval(), which
+     * is re-read after every update so sensors can adapt their cadence.
+     * Calls sensor->begin() to initialize hardware, unless the sensor
+     * faulted on an earlier wake and its retry backoff has not passed yet.
+     * A sensor that is unhealthy after begin() is registered disabled.
      * Each sensor manages its own RTC persistent timing data.
      */
     void addSensor(BaseSensor* sensor) {
         if (sensor == nullptr) return;
         
-        sensor->begin();
+        unsigned long backoff = retryIn(tasks.size());
+        if (backoff == 0) {
+            sensor->begin();
+        }
         
         unsigned long* persistentLastUpdate = sensor->getLastUpdatePtr();
         if (persistentLastUpdate != nullptr) {
-            SensorTask task(sensor, sensor->getUpdateInterval(), persistentLastUpdate);
+            SensorTask task(sensor, sensor->getUpdateInterval(), persistentLastUpdate, sensor->getSensorId());
+            task.tolerance = sensor->getUpdateTolerance();
+            task.dueIn = computeDueIn(task);
+            if (task.tolerance > maxTolerance) maxTolerance = task.tolerance;
             tasks.push_back(task);
             
-            Serial.printf("Added sensor %s with %lu ms interval (lastUpdate: %lu)\n", 
-                         sensor->getSensorId().c_str(), 
-                         sensor->getUpdateInterval(),
+            size_t index = tasks.size() - 1;
+            insertScheduled(index);
+            if (sensor->isEventDriven()) {
+                eventDriven.push_back(index);
+            }
+            
+            Serial.printf("Added sensor %s with %lu ms interval, %lu ms tolerance (lastUpdate: %lu)\n", 
+                         task.id.c_str(), 
+                         task.interval,
+                         task.tolerance,
                          *persistentLastUpdate);
+            
+            if (backoff > 0) {
+                Serial.printf("Sensor %s faulted, retry in %lu ms\n", task.id.c_str(), backoff);
+                removeSensor(task.id);
+            } else if (!sensor->isHealthy()) {
+                recordFault(index);
+            }
         }
     }
     
@@ -98,76 +327,96 @@ public:
      * Useful for temporarily disabling problematic sensors.
      */
     void removeSensor(String sensorId) {
-        for (auto& task : tasks) {
-            if (task.sensor->getSensorId() == sensorId) {
-                task.enabled = false;
+        for (size_t i = 0; i < tasks.size(); i++) {
+            if (tasks[i].enabled && tasks[i].id == sensorId) {
+                tasks[i].enabled = false;
+                eraseIndex(schedule, i);
+                eraseIndex(eventDriven, i);
                 Serial.printf("Disabled sensor %s\n", sensorId.c_str());
                 break;
             }
         }
     }
     
+    /**
+     * @brief Let sensors that will run this wake start slow conversions
+     * 
+     * Calls prepare() on the sensors checkAndUpdateAll() is going to
+     * handle (due, within tolerance, or with an immediate need), so their
+     * conversions run side by side and a wake waits for the slowest one
+     * rather than their sum. Call once per wake before checkAndUpdateAll();
+     * only a wake that connects before sampling (clock not yet synced) also
+     * overlaps them with WiFi/NTP/MQTT bring-up.
+     */
+    void prepareDueSensors() {
+        for (size_t index : schedule) {
+            const SensorTask& task = tasks[index];
+            if (task.dueIn > maxTolerance) break;
+            if (task.dueIn <= task.tolerance) task.sensor->prepare();
+        }
+        for (size_t index : eventDriven) {
+            const SensorTask& task = tasks[index];
+            if (task.dueIn > task.tolerance && task.sensor->needsUpdate()) task.sensor->prepare();
+        }
+    }
+    
     /**
      * @brief Process all sensors that are ready for updates
      * 
-     * Checks each enabled sensor against their intervals using persistent timing.
-     * Handles both scheduled updates and immediate sensor needs (interrupts).
-     * Updates RTC timing variables for next sleep cycle.
+     * Runs the due prefix of the schedule (earliest deadline first), then
+     * sensors due within their tolerance window, then any event-driven
+     * sensors with immediate needs (interrupts). Each sensor runs at most
+     * once per call.
      */
     void checkAndUpdateAll() {
-        for (auto& task : tasks) {
-            if (!task.enabled) continue;
-            
-            bool intervalDue = (*task.lastUpdate == 0) || (currentWakeTime - *task.lastUpdate) >= task.interval;
-            bool immediateNeed = task.sensor->needsUpdate();
-            
-            if (intervalDue || immediateNeed) {
-                Serial.printf("Updating sensor %s (interval: %s, immediate: %s, firstBoot: %s)\n", 
-                             task.sensor->getSensorId().c_str(),
-                             (intervalDue && !firstBoot) ? "YES" : "NO",
-                             immediateNeed ? "YES" : "NO",
-                             firstBoot ? "YES" : "NO");
-                
-                task.sensor->handle();
-                *task.lastUpdate = currentWakeTime;
+        std::vector<size_t> due;
+        size_t coalesced = 0;
+        for (size_t index : schedule) {
+            const SensorTask& task = tasks[index];
+            if (task.dueIn > maxTolerance) break;
+            if (task.dueIn <= task.tolerance) {
+                due.push_back(index);
+                if (task.dueIn > 0) {
+                    coalesced++;
+                    skipDeadline(currentWakeTime + task.dueIn);
+                }
             }
         }
+        for (size_t index : due) {
+            if (!tasks[index].enabled) continue;
+            runTask(index, tasks[index].dueIn == 0, false);
+        }
         
-        // Update persistent timing for next wake cycle
-        schedulerLastWakeTime = currentWakeTime;
+        if (!due.empty()) {
+            schedulerSensorWakes++;
+            schedulerCoalescedRuns += coalesced;
+        }
+        
+        std::vector<size_t> polled = eventDriven; // runTask() may disable a faulted sensor
+        for (size_t index : polled) {
+            if (!tasks[index].enabled) continue;
+            if (std::find(due.begin(), due.end(), index) != due.end()) continue;
+            if (tasks[index].sensor->needsUpdate()) {
+                runTask(index, false, true);
+            }
+        }
     }
     
     /**
      * @brief Calculate the next wake time for deep sleep optimization
      * @return Milliseconds until next sensor update is due
      * 
-     * Finds the earliest required wake time across all enabled sensors.
+     * Reads the earliest deadline from the front of the schedule.
      * Uses persistent timing to work across deep sleep cycles.
      * Returns shortest interval for sleep timer configuration.
      */
     unsigned long getNextWakeTime() {
-        unsigned long shortestInterval = ULONG_MAX;
-        
-        for (const auto& task : tasks) {
-            if (!task.enabled) continue;
-            
-            if (task.sensor->needsUpdate()) {
-                return 0; // Immediate wake needed
-            }
-            
-            unsigned long timeSinceLastUpdate = currentWakeTime - *task.lastUpdate;
-            unsigned long timeUntilNextUpdate = 0;
-            
-            if (timeSinceLastUpdate < task.interval) {
-                timeUntilNextUpdate = task.interval - timeSinceLastUpdate;
-            }
-            
-            if (timeUntilNextUpdate < shortestInterval) {
-                shortestInterval = timeUntilNextUpdate;
-            }
+        if (findImmediateNeed() < tasks.size()) {
+            return 0; // Immediate wake needed
         }
         
-        return (shortestInterval == ULONG_MAX) ? 60000 : shortestInterval; // Default 60s
+        if (schedule.empty()) return 60000; // Default 60s
+        return tasks[schedule.front()].dueIn;
     }
     
     /**
@@ -175,10 +424,13 @@ public:
      * @param sleepTimeMs Milliseconds the system will sleep
      * 
      * Updates RTC persistent variables so scheduler can track time
-     * across deep sleep cycles. Call before esp_deep_sleep_start().
+     * across deep sleep cycles. Call before esp_deep_sleep_start(), also on
+     * wakes that ran no sensors (transmit-only or rain interrupt wakes).
      */
     void prepareSleep(unsigned long sleepTimeMs) {
+        schedulerLastWakeTime = currentWakeTime;
         schedulerSleepDuration = sleepTimeMs;
+        schedulerSleepStartUs = esp_rtc_get_time_us();
         //Serial.printf("Preparing sleep for %lu ms\n", sleepTimeMs);
     }
     
@@ -192,60 +444,101 @@ public:
     bool hasDataToSend() {
         Serial.printf("Checking hasDataToSend... firstBoot: %s\n", firstBoot ? "YES" : "NO");
         
-        for (const auto& task : tasks) {
-            if (!task.enabled) continue;
-            
-            // Immediate needs (interrupts, etc.)
-            if (task.sensor->needsUpdate()) {
-                Serial.printf("Sensor %s needs immediate update\n", task.sensor->getSensorId().c_str());
-                return true;
-            }
-            
-            // First boot: all sensors should run
-            if (firstBoot) {
-                Serial.printf("First boot - sensor %s should run\n", task.sensor->getSensorId().c_str());
-                return true;
-            }
-            
-            // Scheduled updates (first time or interval elapsed)  
-            bool isDue = false;
-            unsigned long timeSinceUpdate = 0;
-            
-            if (*task.lastUpdate == 0) {
-                isDue = true; // First time running this sensor
-                timeSinceUpdate = 0;
-            } else if (currentWakeTime >= *task.lastUpdate) {
-                timeSinceUpdate = currentWakeTime - *task.lastUpdate;
-                isDue = (timeSinceUpdate >= task.interval);
-            } else {
-                // Clock rollover or timing issue - force update to resync
-                Serial.printf("Timing resync needed for %s (current: %lu < last: %lu)\n", 
-                             task.sensor->getSensorId().c_str(), currentWakeTime, *task.lastUpdate);
-                isDue = true;
-                timeSinceUpdate = 0;
-            }
-            
-            Serial.printf("Sensor %s: currentTime=%lu, lastUpdate=%lu, timeSince=%lu, interval=%lu, isDue=%s\n", 
-                         task.sensor->getSensorId().c_str(), currentWakeTime, *task.lastUpdate, timeSinceUpdate, task.interval, isDue ? "YES" : "NO");
-            
-            if (isDue) {
-                return true;
-            }
+        if (schedule.empty() && eventDriven.empty()) {
+            Serial.println("No sensors need updating");
+            return false;
+        }
+        
+        // Immediate needs (interrupts, etc.)
+        size_t immediate = findImmediateNeed();
+        if (immediate < tasks.size()) {
+            Serial.printf("Sensor %s needs immediate update\n", tasks[immediate].id.c_str());
+            return true;
+        }
+        
+        // First boot: all sensors should run
+        if (firstBoot) {
+            Serial.println("First boot - all sensors should run");
+            return true;
+        }
+        
+        // Scheduled updates: the earliest deadline is at the front
+        const SensorTask& next = tasks[schedule.front()];
+        Serial.printf("Next sensor %s: currentTime=%lu, lastUpdate=%lu, interval=%lu, dueIn=%lu\n", 
+                     next.id.c_str(), currentWakeTime, *next.lastUpdate, next.interval, next.dueIn);
+        
+        if (next.dueIn == 0) {
+            return true;
         }
         Serial.println("No sensors need updating");
         return false;
     }
     
+    /**
+     * @brief Check if any sensor updated this wake raised priority data
+     * @return true if readings should be transmitted without waiting
+     */
+    bool hasPriorityData() const {
+        return priorityData;
+    }
+    
+    /**
+     * @brief Check if sensor health changed since the last health report,
+     *        or SCHEDULER_HEALTH_REPORT_MS have passed
+     */
+    bool healthReportDue() const {
+        return schedulerHealthChanged || currentWakeTime - schedulerHealthReportedAt >= SCHEDULER_HEALTH_REPORT_MS;
+    }
+    
+    /**
+     * @brief Queues the health of every sensor as one MQTT message
+     * @tparam Queue MQTT message queue type
+     * @param queue Queue receiving the report
+     * @param topic MQTT topic for the report
+     * @param radioSessions Transmit wakes so far (TransmitPolicy::radioSessions())
+     * @return true if the report was queued
+     *
+     * Format:
+     * {"sensor_health": {"BMP280": {"ok": false, "faults": n, "retry_s": s}, "Battery": {"ok": true}, ...},
+     *  "wakes_saved": n, "radio_sessions": n}
+     *
+     * "faults" counts consecutive faults; "retry_s" is the time until the
+     * next begin() retry, 0 if it is retried on the next wake.
+     * "wakes_saved" (schedulerWakesSaved) and "radio_sessions" count since
+     * power-on.
+     */
+    template<class Queue>
+    bool publishHealth(Queue* queue, const char* topic, unsigned long radioSessions) {
+        JsonDocument doc;
+        JsonObject health = doc["sensor_health"].to<JsonObject>();
+        
+        for (size_t i = 0; i < tasks.size(); i++) {
+            JsonObject state = health[tasks[i].id].to<JsonObject>();
+            uint8_t failures = (i < SCHEDULER_MAX_SENSORS) ? schedulerSensorFailures[i] : 0;
+            state["ok"] = (failures == 0);
+            if (failures > 0) {
+                state["faults"] = failures;
+                state["retry_s"] = retryIn(i) / 1000;
+            }
+        }
+        doc["wakes_saved"] = schedulerWakesSaved;
+        doc["radio_sessions"] = radioSessions;
+        
+        if (!queue->enqueue(topic, doc)) {
+            Serial.println("Scheduler: health report not queued (queue full)");
+            return false;
+        }
+        schedulerHealthChanged = false;
+        schedulerHealthReportedAt = currentWakeTime;
+        return true;
+    }
+    
     /**
      * @brief Get count of active sensors
      * @return Number of enabled sensors in scheduler
      */
     size_t getActiveSensorCount() {
-        size_t count = 0;
-        for (const auto& task : tasks) {
-            if (task.enabled) count++;
-        }
-        return count;
+        return schedule.size();
     }
     
     /**
@@ -285,16 +578,21 @@ public:
         }
         Serial.printf("Actual Elapsed: %lu ms\n", actualElapsed);
         
-        for (const auto& task : tasks) {
+        Serial.printf("Coalescing: %lu sensor wakes, %lu coalesced runs, %lu wakes saved\n",
+                     schedulerSensorWakes, schedulerCoalescedRuns, schedulerWakesSaved);
+        
+        for (size_t i = 0; i < tasks.size(); i++) {
+            const SensorTask& task = tasks[i];
             unsigned long timeSinceUpdate = currentWakeTime - *task.lastUpdate;
             bool isDue = timeSinceUpdate >= task.interval;
             
-            Serial.printf("Sensor: %s | Enabled: %s | Due: %s | Last: %lums ago | Interval: %lums\n",
-                         task.sensor->getSensorId().c_str(),
+            Serial.printf("Sensor: %s | Enabled: %s | Due: %s | Last: %lums ago | Interval: %lums | Faults: %u\n",
+                         task.id.c_str(),
                          task.enabled ? "YES" : "NO",
                          isDue ? "YES" : "NO",
                          timeSinceUpdate,
-                         task.interval);
+                         task.interval,
+                         (i < SCHEDULER_MAX_SENSORS) ? schedulerSensorFailures[i] : 0);
         }
         Serial.println("==============================");
     }
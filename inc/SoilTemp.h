@@ -10,6 +10,33 @@
 // RTC persistent timing for soil temperature sensor
 RTC_DATA_ATTR unsigned long soilTempLastUpdate = 0;
 
+#define DS18B20_CONVERSION_MS 750  // worst case 12-bit conversion time
+
+#ifndef SOIL_TEMP_RESOLUTION
+#define SOIL_TEMP_RESOLUTION 12     // configured resolution, 9-12 bits
+#endif
+#ifndef SOIL_TEMP_ADAPTIVE
+#define SOIL_TEMP_ADAPTIVE 1        // drop to SOIL_TEMP_STABLE_RESOLUTION while stable
+#endif
+#define SOIL_TEMP_STABLE_RESOLUTION 10  // 0.25 C steps, 188 ms conversion
+#define SOIL_TEMP_STABLE_F 0.5          // max change between reads that counts as stable
+#define SOIL_TEMP_STABLE_READS 3        // stable reads before lowering the resolution
+
+#ifndef SOIL_TEMP_MAX_PROBES
+#define SOIL_TEMP_MAX_PROBES 4      // e.g. a 5/10/20/50 cm profile on one bus
+#endif
+#define SOIL_TEMP_ROM_MAGIC 0x53544D50  // "STMP"
+
+// RTC persistent ROM codes of the probes on the bus (searched once)
+RTC_DATA_ATTR uint8_t soilTempRoms[SOIL_TEMP_MAX_PROBES][8];
+RTC_DATA_ATTR uint8_t soilTempProbeCount = 0;
+RTC_DATA_ATTR uint32_t soilTempRomMagic = 0;
+
+// RTC persistent resolution state
+RTC_DATA_ATTR uint8_t soilTempResolution = 0;      // bits in the probes' scratchpad, 0 = unknown
+RTC_DATA_ATTR uint8_t soilTempStableReads = 0;
+RTC_DATA_ATTR float soilTempLastF[SOIL_TEMP_MAX_PROBES];
+
 // Forward declarations
 class PubSubClient;
 
@@ -17,21 +44,31 @@ class PubSubClient;
 
 /**
  * @brief Dallas DS18B20 temperature sensor interface with MQTT integration
- * @tparam QUEUE_SIZE The size of the MQTT message queue
+ * @tparam Queue The MqttMessageQueue type used for message buffering
  * 
  * This template class provides a complete interface for Dallas DS18B20 OneWire
  * temperature sensors commonly used for soil temperature monitoring. Features:
  * 
- * - Non-blocking temperature conversion with state management
- * - Automatic sensor discovery and initialization
+ * - Asynchronous conversion started in prepare(), overlapping the other
+ *   sensors' reads (and radio bring-up on the wakes that connect first)
+ * - Multiple probes on one bus: ROM codes enumerated once and cached in RTC
+ * - One Skip-ROM broadcast conversion for all probes, CRC checked reads
  * - Temperature readings in both Celsius and Fahrenheit
  * - MQTT message queuing for reliable data transmission
  * - Serial debug output for monitoring
  * 
  * Requires a 4.7K pull-up resistor on the OneWire data line.
- * Supports multiple sensor resolution modes (9-12 bit).
+ * Supports multiple sensor resolution modes (9-12 bit): SOIL_TEMP_RESOLUTION
+ * is written to the probes (and their EEPROM) once, and conversions wait
+ * exactly 94/188/375/750 ms. With SOIL_TEMP_ADAPTIVE the resolution drops
+ * to SOIL_TEMP_STABLE_RESOLUTION (scratchpad only) while readings stay
+ * within SOIL_TEMP_STABLE_F, and returns on the first larger change.
+ *
+ * With one probe the reading is published as "soil_temp". With several,
+ * probe i (1-based, in ROM search order as logged at enumeration) is
+ * published as "soil_temp_<i>" in the same message.
  */
-template<size_t QUEUE_SIZE>
+template<class Queue>
 class Tempsensor : public BaseSensor {
   
 public:
@@ -45,8 +82,8 @@ public:
    * Initializes DS18B20 sensor with MQTT integration. Publishes readings
    * to specified topic via message queue system.
    */
-  Tempsensor(uint8_t pin, PubSubClient* cli, MqttMessageQueue<QUEUE_SIZE>* q, String top)
-  :ds(pin),type_s(0),client(cli),tx_queue(q),topic(top)
+  Tempsensor(uint8_t pin, PubSubClient* cli, Queue* q, String top)
+  :ds(pin),type_s(0),parasite(false),converting(false),conversionStart(0),client(cli),tx_queue(q),topic(top)
   {
     saved_pin = pin;
   }
@@ -58,54 +95,215 @@ public:
   /**
    * @brief Initializes the temperature sensor and begins operation
    * 
-   * Discovers DS18B20 on OneWire bus, stores address, starts first conversion.
+   * Uses the ROM codes cached in RTC, enumerating the bus only on cold
+   * boot or after all probes failed to read. Checks whether any probe
+   * runs on parasite power. Conversions are started by prepare().
    * Call once during setup after construction.
-   * 
-   * Prints error and resets search if no sensor found.
    */
   void begin(){
 
     Serial.printf("Started Soiltemp on pin %d\n", saved_pin);
     
-    if ( !ds.search(addr)) {
-        Serial.println("No more addresses.");
-        ds.reset_search();
-        delay(250);   
+    bool enumerated = false;
+    if (soilTempRomMagic != SOIL_TEMP_ROM_MAGIC || soilTempProbeCount == 0) {
+      enumerateProbes();
+      enumerated = true;
     }
 
-    startConversion();
+    // Read Power Supply: parasite powered devices pull the bus low
+    ds.reset();
+    ds.skip();
+    ds.write(0xB4);
+    parasite = (ds.read_bit() == 0);
+
+    if (enumerated && soilTempProbeCount > 0) {
+      setResolution(SOIL_TEMP_RESOLUTION, true); // once per enumeration, persisted in EEPROM
+      soilTempStableReads = 0;
+    }
+
+  }
+
+  /**
+   * @brief Writes the resolution to all probes' configuration registers
+   * @param bits Resolution, 9-12 bits
+   * @param persist true to also copy the scratchpads to the probes' EEPROM
+   * 
+   * Write Scratchpad (0x4E) always sets TH, TL and config together, so
+   * each probe's scratchpad is read first and its TH/TL written back
+   * unchanged (with Match ROM, as probes may hold different alarm values).
+   * The config byte is then read back, and soilTempResolution (and with it
+   * the conversion wait on a parasite bus) follows the slowest probe, or
+   * stays unknown (750 ms) if a probe could not be read. Copy Scratchpad
+   * (0x48) keeps the setting across probe power loss; EEPROM writes wear
+   * the probe, so adaptive changes only touch the scratchpad.
+   */
+  void setResolution(uint8_t bits, bool persist){
+    uint8_t config = ((bits - 9) << 5) | 0x1F;  // R1 R0 in bits 6..5
+    uint8_t slowest = 0;
+    bool known = true;
+    for (uint8_t probe = 0; probe < soilTempProbeCount; probe++) {
+      if (soilTempRoms[probe][0] == 0x10) continue;  // DS18S20: fixed 9 bit, no config register
+      if (!readScratchpad(probe)) {
+        known = false;
+        continue;
+      }
+      if (data[4] != config) {
+        uint8_t th = data[2], tl = data[3];
+        ds.reset();
+        ds.select(soilTempRoms[probe]);
+        ds.write(0x4E);                  // Write Scratchpad
+        ds.write(th);                    // TH and TL as they were
+        ds.write(tl);
+        ds.write(config);
+        if (!readScratchpad(probe)) {
+          known = false;
+          continue;
+        }
+      }
+      uint8_t probeBits = ((data[4] >> 5) & 0x03) + 9;
+      if (probeBits > slowest) slowest = probeBits;
+    }
 
+    if (persist) {
+      ds.reset();
+      ds.skip();
+      ds.write(0x48, parasite ? 1 : 0);  // Copy Scratchpad to EEPROM
+      delay(10);                         // EEPROM write time
+      if (parasite) ds.depower();
+    }
+    soilTempResolution = !known ? 0 : (slowest > 0 ? slowest : bits);
+    Serial.printf("(%dms) SoilTemp: resolution %u bits, %u read back (%lu ms)%s\n", millis(), bits,
+                  soilTempResolution, conversionTimeMs(), persist ? ", saved to EEPROM" : "");
+  }
+
+  /**
+   * @brief Reads one probe's scratchpad for setResolution()
+   * @return true if the CRC matches and the config byte is well formed
+   *         (an all-zero scratchpad also passes the CRC)
+   */
+  bool readScratchpad(uint8_t probe){
+    return readData(probe) && (data[4] & 0x9F) == 0x1F;
+  }
+
+  /**
+   * @brief Get conversion time of the current resolution
+   * @return 94/188/375/750 ms for 9-12 bits, 750 ms if unknown or a
+   *         DS18S20 (fixed 750 ms) is on the bus
+   */
+  unsigned long conversionTimeMs(){
+    if (soilTempResolution < 9 || soilTempResolution > 12) return DS18B20_CONVERSION_MS;
+    for (uint8_t i = 0; i < soilTempProbeCount; i++) {
+      if (soilTempRoms[i][0] == 0x10) return DS18B20_CONVERSION_MS;
+    }
+    uint8_t shift = 12 - soilTempResolution;
+    return (DS18B20_CONVERSION_MS + (1UL << shift) - 1) >> shift;
+  }
+
+  /**
+   * @brief Get the resolution the next conversion should use
+   */
+  uint8_t targetResolution(){
+#if SOIL_TEMP_ADAPTIVE
+    if (soilTempStableReads >= SOIL_TEMP_STABLE_READS && SOIL_TEMP_STABLE_RESOLUTION < SOIL_TEMP_RESOLUTION) {
+      return SOIL_TEMP_STABLE_RESOLUTION;
+    }
+#endif
+    return SOIL_TEMP_RESOLUTION;
+  }
+
+  /**
+   * @brief Searches the bus for DS18x20 probes and caches their ROM codes
+   * 
+   * Skips devices with a bad ROM CRC or another family code. Keeps at most
+   * SOIL_TEMP_MAX_PROBES probes.
+   */
+  void enumerateProbes(){
+    uint8_t rom[8];
+    soilTempProbeCount = 0;
+    ds.reset_search();
+
+    while (soilTempProbeCount < SOIL_TEMP_MAX_PROBES && ds.search(rom)) {
+      if (OneWire::crc8(rom, 7) != rom[7]) {
+        Serial.println("SoilTemp: ROM CRC mismatch, skipping device");
+        continue;
+      }
+      if (rom[0] != 0x28 && rom[0] != 0x10 && rom[0] != 0x22) {
+        continue; // not a DS18B20/DS18S20/DS1822
+      }
+      memcpy(soilTempRoms[soilTempProbeCount], rom, 8);
+      soilTempProbeCount++;
+      Serial.printf("SoilTemp: probe %u ROM %02X%02X%02X%02X%02X%02X%02X%02X\n", soilTempProbeCount,
+                    rom[0], rom[1], rom[2], rom[3], rom[4], rom[5], rom[6], rom[7]);
+    }
+    ds.reset_search();
+
+    if (soilTempProbeCount == 0) {
+      Serial.println("No more addresses.");
+    }
+    soilTempRomMagic = SOIL_TEMP_ROM_MAGIC;
   }
   
   /**
-   * @brief Initiates a temperature conversion
+   * @brief Initiates a temperature conversion on every probe
    * 
    * Starts DS18B20 conversion (up to 750ms for 12-bit). Resets bus,
-   * selects sensor, sends 0x44 command.
+   * addresses all probes with Skip ROM, sends 0x44 command. Parasite
+   * powered sensors get strong pull-up power for the whole conversion.
    */
   void startConversion(){
+    if (soilTempResolution != targetResolution()) {
+      setResolution(targetResolution(), false);
+    }
     ds.reset();
-    ds.select(addr);
-    ds.write(0x44, 1);        // start conversion, with parasite power on at the end
+    ds.skip();
+    ds.write(0x44, parasite ? 1 : 0); // start conversion on all probes
+    conversionStart = millis();
+    converting = true;
+  }
+
+  /**
+   * @brief Check if the running conversion has finished
+   * @return true once the result can be read from the scratchpad
+   * 
+   * Externally powered sensors answer read slots with 1 once done.
+   * Parasite powered sensors cannot signal, so the conversion time of the
+   * configured resolution is assumed.
+   */
+  bool conversionDone(){
+    if (millis() - conversionStart >= conversionTimeMs()) return true;
+    return !parasite && ds.read_bit() == 1;
+  }
+
+  /**
+   * @brief Start a conversion for this wake's update, collected in handle()
+   */
+  void prepare() override {
+    startConversion();
   }
   
 
   /**
-   * @brief Reads temperature data from the DS18B20 sensor
+   * @brief Reads temperature data from one probe
+   * @param probe Index into the cached ROM codes
+   * @return true if a probe answered and the scratchpad CRC matches
    * 
    * Retrieves 9-byte scratchpad after conversion complete. Resets bus,
    * selects sensor, sends 0xBE command, reads data.
    * 
    * Call after conversion is complete. Use getC()/getF() for temperature.
    */
-  void readData(){
-    ds.reset();             //present
-    ds.select(addr);    
+  bool readData(uint8_t probe){
+    const uint8_t* rom = soilTempRoms[probe];
+    type_s = (rom[0] == 0x10);
+
+    if (!ds.reset()) return false;  //present
+    ds.select(rom);    
     ds.write(0xBE);         // Read Scratchpad
  
     for (int i = 0; i < 9; i++) {           // we need 9 bytes
       data[i] = ds.read();
     }
+    return OneWire::crc8(data, 8) == data[8];
   }
 
   /**
@@ -158,28 +356,68 @@ public:
   /**
    * @brief Handles complete temperature reading and MQTT publishing cycle
    * 
-   * Complete workflow: reads data, reports to serial, creates JSON,
-   * queues for MQTT. Call after waitForDataReady() shows complete.
+   * Complete workflow: waits for the conversion started by prepare()
+   * (starting one if needed), reads every probe, reports to serial,
+   * creates JSON, queues for MQTT. Probes failing the CRC twice are left
+   * out of the message.
    * 
    * Handles all steps from data retrieval to message queuing.
-   * Format: {"soil_temp": temperature_in_fahrenheit}
+   * Format: {"soil_temp": temperature_in_fahrenheit} or
+   * {"soil_temp_1": f, "soil_temp_2": f, ...} with several probes
    */
   void handle(){
-    Serial.printf("(%dms) Starting soil temp conversion...\n", millis());
-    
-    // Use existing methods for conversion
-    startConversion();
-    delay(1000); // Wait for DS18B20 conversion (750ms + margin)
-    readData();
-    
-    // Report and queue data
-    reportF();
+    if (!converting) {
+      Serial.printf("(%dms) Starting soil temp conversion...\n", millis());
+      startConversion();
+    }
+    while (!conversionDone()) {
+      delay(5);
+    }
+    Serial.printf("(%dms) Soil temp conversion done after %lu ms\n", millis(), millis() - conversionStart);
+    converting = false;
 
     JsonDocument myObject;
-    myObject["soil_temp"] = getF();
+    uint8_t valid = 0;
+    bool stable = true;
+    for (uint8_t probe = 0; probe < soilTempProbeCount; probe++) {
+      if (!readData(probe) && !readData(probe)) { // one retry on a bad CRC
+        Serial.printf("(%dms) SoilTemp: probe %u read failed\n", millis(), probe + 1);
+        stable = false;
+        continue;
+      }
+      valid++;
+
+      // a probe that lost power is back at its EEPROM resolution
+      if (!type_s && ((data[4] >> 5) & 0x03) + 9 != soilTempResolution) {
+        soilTempResolution = 0;
+      }
+      float tempF = getF();
+      if (fabsf(tempF - soilTempLastF[probe]) > SOIL_TEMP_STABLE_F) stable = false;
+      soilTempLastF[probe] = tempF;
+
+      // Report and queue data
+      reportF();
+      if (soilTempProbeCount == 1) {
+        myObject["soil_temp"] = getF();
+      } else {
+        myObject["soil_temp_" + String(probe + 1)] = getF();
+      }
+    }
+
+    if (stable) {
+      if (soilTempStableReads < SOIL_TEMP_STABLE_READS) soilTempStableReads++;
+    } else {
+      soilTempStableReads = 0;
+    }
+
+    if (valid == 0) {
+      Serial.printf("(%dms) SoilTemp: no probe answered, re-enumerating next wake\n", millis());
+      soilTempRomMagic = 0;
+      return;
+    }
     tx_queue->enqueue(topic.c_str(), myObject);
     
-    Serial.printf("(%dms) SoilTemp queued for MQTT\n", millis());
+    Serial.printf("(%dms) SoilTemp queued for MQTT (%u/%u probes)\n", millis(), valid, soilTempProbeCount);
   }
     
   /**
@@ -199,6 +437,10 @@ public:
     return 120000; // 2 minutes for soil temperature
   }
   
+  unsigned long getUpdateTolerance() override {
+    return 30000; // soil temperature changes slowly
+  }
+  
   bool needsUpdate() override {
     return false; // Scheduled updates only, no immediate needs
   }
@@ -216,10 +458,12 @@ private:
     OneWire ds;
     int saved_pin;
     byte data[9];
-    byte addr[8];
     byte type_s;
+    bool parasite;                  // sensor draws power from the data line
+    bool converting;                // conversion started, result not read yet
+    unsigned long conversionStart;  // millis() when the conversion was started
     PubSubClient* client;
-    MqttMessageQueue<QUEUE_SIZE>* tx_queue;
+    Queue* tx_queue;
     String topic;
     
 };
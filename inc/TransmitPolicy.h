@@ -0,0 +1,212 @@
+#ifndef TRANSMITPOLICY_H
+#define TRANSMITPOLICY_H
+
+#include "Arduino.h"
+#include <ArduinoJson.h>
+
+#ifndef TX_BACKOFF_AFTER_FAILURES
+#define TX_BACKOFF_AFTER_FAILURES 2            // consecutive failed transmit wakes before backing off
+#endif
+#ifndef TX_BACKOFF_BASE_MS
+#define TX_BACKOFF_BASE_MS (2UL * 60 * 1000)   // first radio pause, doubles per further failure
+#endif
+#ifndef TX_BACKOFF_MAX_MS
+#define TX_BACKOFF_MAX_MS (30UL * 60 * 1000)   // during long outages, probe at least this often
+#endif
+
+// RTC persistent transmit timing (SensorScheduler timebase)
+RTC_DATA_ATTR unsigned long transmitLastTime = 0;
+RTC_DATA_ATTR bool transmitDone = false;           // false until the first successful transmit
+RTC_DATA_ATTR unsigned long transmitSampleWakes = 0; // wakes that sampled with the radio off
+RTC_DATA_ATTR unsigned long transmitRadioSessions = 0; // transmit wakes since power-on, successful or not
+
+// RTC persistent outage history (SensorScheduler timebase)
+RTC_DATA_ATTR uint16_t transmitFailures = 0;           // consecutive failed transmit wakes
+RTC_DATA_ATTR unsigned long transmitFailedAt = 0;      // time of the last failed attempt
+RTC_DATA_ATTR unsigned long transmitOutageStart = 0;   // time of the first failed attempt
+RTC_DATA_ATTR unsigned long transmitSkippedWakes = 0;  // transmit wakes skipped by the backoff
+
+/**
+ * @brief Decides which wakes bring up WiFi/MQTT to upload buffered readings
+ *
+ * Sensor reads are cheap, radio bring-up is most of the energy of a wake.
+ * Sample wakes read sensors into the RTC queue with the radio off; a
+ * transmit wake happens only when:
+ * - the buffered reading count reaches the watermark
+ * - the max latency since the last successful transmit has passed
+ * - a sensor raised priority data (e.g. heavy rain)
+ * - nothing was ever transmitted (cold boot, clock not yet synced)
+ *
+ * Connection backoff: after TX_BACKOFF_AFTER_FAILURES consecutive failed
+ * transmit wakes (AP or broker down) the radio stays off for
+ * TX_BACKOFF_BASE_MS, doubling per further failure up to
+ * TX_BACKOFF_MAX_MS, while sample wakes keep buffering. The next
+ * successful transmit reports the outage with publishOutage().
+ *
+ * Times use the SensorScheduler timebase so they work across deep sleep.
+ */
+class TransmitPolicy {
+private:
+    size_t watermark;
+    unsigned long maxLatencyMs;
+
+public:
+    /**
+     * @brief Constructs a transmit policy
+     * @param wm Buffered reading count that triggers a transmit wake
+     * @param maxLatency Max milliseconds buffered readings may wait
+     */
+    TransmitPolicy(size_t wm, unsigned long maxLatency)
+        : watermark(wm), maxLatencyMs(maxLatency) {
+    }
+
+    /**
+     * @brief Get the radio pause after the current number of failures
+     * @return 0 below TX_BACKOFF_AFTER_FAILURES failures
+     */
+    unsigned long backoffMs() const {
+        if (transmitFailures < TX_BACKOFF_AFTER_FAILURES) return 0;
+        unsigned long backoff = TX_BACKOFF_BASE_MS;
+        for (uint16_t i = TX_BACKOFF_AFTER_FAILURES; i < transmitFailures && backoff < TX_BACKOFF_MAX_MS; i++) {
+            backoff *= 2;
+        }
+        return (backoff < TX_BACKOFF_MAX_MS) ? backoff : TX_BACKOFF_MAX_MS;
+    }
+
+    /**
+     * @brief Check if the radio must stay off after repeated failures
+     * @param now Current wake time in the scheduler timebase
+     */
+    bool inBackoff(unsigned long now) const {
+        return now - transmitFailedAt < backoffMs();
+    }
+
+    /**
+     * @brief Check if this wake should bring up the radio
+     * @param buffered Number of readings waiting for upload
+     * @param now Current wake time in the scheduler timebase
+     * @param priority true if a sensor raised priority data this wake
+     * @return true if the radio should be brought up
+     */
+    bool transmitDue(size_t buffered, unsigned long now, bool priority) {
+        const char* reason = nullptr;
+
+        if (!transmitDone) {
+            reason = "first transmit";
+        } else if (priority) {
+            reason = "priority data";
+        } else if (buffered > 0 && buffered >= watermark) {
+            reason = "watermark";
+        } else if (buffered > 0 && now - transmitLastTime >= maxLatencyMs) {
+            reason = "max latency";
+        }
+
+        if (reason != nullptr && inBackoff(now)) {
+            transmitSkippedWakes++;
+            Serial.printf("(%dms) Radio backoff: %s skipped, %u failures, next probe in %lu ms\n", millis(), reason,
+                         transmitFailures, backoffMs() - (now - transmitFailedAt));
+            reason = nullptr;
+        }
+
+        if (reason == nullptr) {
+            transmitSampleWakes++;
+            Serial.printf("(%dms) Radio off: %u readings buffered (%lu wakes without radio)\n",
+                         millis(), (unsigned)buffered, transmitSampleWakes);
+            return false;
+        }
+        Serial.printf("(%dms) Transmit wake: %s, %u readings buffered\n", millis(), reason, (unsigned)buffered);
+        return true;
+    }
+
+    /**
+     * @brief Record a successful upload
+     * @param now Current wake time in the scheduler timebase
+     */
+    void markTransmitted(unsigned long now) {
+        transmitRadioSessions++;
+        transmitLastTime = now;
+        transmitDone = true;
+        transmitFailures = 0;
+        transmitSkippedWakes = 0;
+    }
+
+    /**
+     * @brief Record a transmit wake that could not reach the broker
+     * @param now Current wake time in the scheduler timebase
+     */
+    void markFailed(unsigned long now) {
+        transmitRadioSessions++;
+        if (transmitFailures == 0) transmitOutageStart = now;
+        if (transmitFailures < 0xFFFF) transmitFailures++;
+        transmitFailedAt = now;
+        if (transmitFailures >= TX_BACKOFF_AFTER_FAILURES) {
+            Serial.printf("(%dms) Transmit failed %u times, radio off for %lu ms\n", millis(), transmitFailures, backoffMs());
+        }
+    }
+
+    /**
+     * @brief Get the number of wakes that brought up the radio since power-on
+     *
+     * Counted by markTransmitted() and markFailed(), one of which closes
+     * every transmit wake.
+     */
+    unsigned long radioSessions() const {
+        return transmitRadioSessions;
+    }
+
+    /**
+     * @brief Check if this wake reconnected after failed transmit wakes
+     */
+    bool outageReportDue() const {
+        return transmitFailures > 0;
+    }
+
+    /**
+     * @brief Queues statistics of the outage that just ended as one MQTT message
+     * @tparam Queue MQTT message queue type
+     * @param queue Queue receiving the report
+     * @param topic MQTT topic for the report
+     * @param now Current wake time in the scheduler timebase
+     * @return true if the report was queued
+     *
+     * Call when connected, before markTransmitted() resets the history.
+     * Format:
+     * {"outage": {"duration_s": s, "failed_wakes": n, "skipped_wakes": n}}
+     */
+    template<class Queue>
+    bool publishOutage(Queue* queue, const char* topic, unsigned long now) {
+        JsonDocument doc;
+        JsonObject outage = doc["outage"].to<JsonObject>();
+        outage["duration_s"] = (now - transmitOutageStart) / 1000;
+        outage["failed_wakes"] = transmitFailures;
+        outage["skipped_wakes"] = transmitSkippedWakes;
+
+        Serial.printf("(%dms) Outage over after %lu s: %u failed, %lu skipped transmit wakes\n", millis(),
+                     (now - transmitOutageStart) / 1000, transmitFailures, transmitSkippedWakes);
+        if (!queue->enqueue(topic, doc)) {
+            Serial.println("TransmitPolicy: outage report not queued (queue full)");
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Get milliseconds until buffered readings reach the max latency
+     * @param buffered Number of readings waiting for upload
+     * @param now Current wake time in the scheduler timebase
+     * @return Time until the latency deadline, or until the next probe
+     *         once the backoff holds back an overdue transmit; ULONG_MAX if
+     *         nothing is buffered or the deadline already passed (a failed
+     *         transmit is then retried on the next sensor wake instead of
+     *         spinning)
+     */
+    unsigned long timeUntilDeadline(size_t buffered, unsigned long now) const {
+        if (buffered == 0 || !transmitDone) return ULONG_MAX;
+        unsigned long elapsed = now - transmitLastTime;
+        if (elapsed < maxLatencyMs) return maxLatencyMs - elapsed;
+        if (inBackoff(now)) return backoffMs() - (now - transmitFailedAt);
+        return ULONG_MAX;
+    }
+};
+
+#endif
@@ -0,0 +1,280 @@
+#ifndef ULPRAINCOUNTER_H
+#define ULPRAINCOUNTER_H
+
+#include "Arduino.h"
+#include "esp_sleep.h"
+#include "esp32/ulp.h"
+#include "driver/rtc_io.h"
+#include "soc/rtc_io_reg.h"
+#include <sys/time.h>
+
+#ifndef ULP_RAIN_PERIOD_US
+#define ULP_RAIN_PERIOD_US 10000    // ULP sampling period of the rain pin
+#endif
+#ifndef ULP_RAIN_DEBOUNCE_SAMPLES
+#define ULP_RAIN_DEBOUNCE_SAMPLES 3 // samples a new level must hold (30 ms)
+#endif
+
+#define ULP_RAIN_RUNS_PER_S (1000000 / ULP_RAIN_PERIOD_US)
+
+// RTC_SLOW_MEM word layout shared with the ULP program (low 16 bits valid)
+#define ULP_RAIN_MAGIC_WORD     0   // written by the main CPU once the program runs
+#define ULP_RAIN_COUNT_WORD     1   // debounced falling edges, wraps at 16 bits
+#define ULP_RAIN_LEVEL_WORD     2   // last debounced pin level
+#define ULP_RAIN_DEBOUNCE_WORD  3   // samples left before a level change is accepted
+#define ULP_RAIN_MAX_WORD       4   // ULP_RAIN_DEBOUNCE_SAMPLES
+#define ULP_RAIN_ALERT_WORD     5   // count at which the ULP wakes the CPU
+#define ULP_RAIN_RUNS_WORD      6   // runs since the seconds word last advanced
+#define ULP_RAIN_SECONDS_WORD   7   // seconds since the program started, wraps at 16 bits
+#define ULP_RAIN_RING_WORD      8   // tip stamps, stamp of tip n at ring[n % length]
+#define ULP_RAIN_RING_LENGTH    32  // power of 2
+#define ULP_RAIN_PROG_ADDR      (ULP_RAIN_RING_WORD + ULP_RAIN_RING_LENGTH)
+
+#define ULP_RAIN_MAGIC 0x5241       // "RA"
+
+// Counter value already handed to Raingauge
+RTC_DATA_ATTR uint16_t ulpRainLastCount = 0;
+
+/**
+ * @brief Tipping bucket counter running on the ULP coprocessor
+ *
+ * Every ULP_RAIN_PERIOD_US the ULP samples the rain pin (an RTC GPIO) and
+ * accepts a level change only after it held for ULP_RAIN_DEBOUNCE_SAMPLES
+ * samples. Each debounced falling edge (bucket tip pulls the pin LOW)
+ * increments a counter in RTC slow memory. The main cores stay in deep
+ * sleep during storms instead of booting once per tip. When the counter
+ * reaches the armed alert count the ULP wakes the CPU (see armAlert()).
+ *
+ * The ULP keeps its own clock: every ULP_RAIN_RUNS_PER_S runs it advances
+ * a seconds counter in slow memory (wrapping after ~18 h). Each tip is
+ * stamped with that counter into a ring of the last ULP_RAIN_RING_LENGTH
+ * tips, and takeTips() converts a stamp to Unix time by its age against
+ * the counter's current value. This needs no RTC timer registers or slow
+ * clock calibration; the counter runs slow by the program's run time per
+ * period (well under 1%), which only scales the age of a tip.
+ *
+ * The main CPU never writes the counter. takeTips() returns the
+ * difference to the last value it saw, so reading and "resetting" cannot
+ * race an increment by the ULP.
+ *
+ * The program is loaded once on cold boot and keeps running across deep
+ * sleep and wake cycles. The pin's RTC IO configuration (input, pullup)
+ * is applied and latched with rtc_gpio_hold_en() on every begin(), so
+ * nothing done to the pad while awake can leave it floating in sleep.
+ *
+ * Sampling period: a bucket tip closes the reed switch for roughly
+ * 50-100 ms, so 10 ms samples with a 30 ms debounce still catch every tip
+ * and filter contact bounce. RTC_PERIPH stays powered for the pullup
+ * either way; what the period sets is the ULP duty cycle (each run is ~20
+ * instructions plus the FSM wake-up), which at 100 runs/s is 5x lower
+ * than at a 2 ms period. Gauges with shorter closures can lower
+ * ULP_RAIN_PERIOD_US.
+ */
+class UlpRainCounter {
+private:
+    gpio_num_t pin;
+
+    static uint16_t readWord(size_t word) {
+        return RTC_SLOW_MEM[word] & 0xFFFF;
+    }
+
+    /**
+     * @brief Routes the pin to the RTC IO mux as a pulled-up input and latches it
+     */
+    void configurePin() {
+        rtc_gpio_hold_dis(pin);
+        rtc_gpio_init(pin);
+        rtc_gpio_set_direction(pin, RTC_GPIO_MODE_INPUT_ONLY);
+        rtc_gpio_pullup_en(pin);
+        rtc_gpio_pulldown_dis(pin);
+        rtc_gpio_hold_en(pin);
+    }
+
+public:
+    /**
+     * @brief Constructs a counter for a rain pin
+     * @param reqPin GPIO connected to the bucket switch, must be an RTC GPIO
+     */
+    UlpRainCounter(uint8_t reqPin) : pin((gpio_num_t)reqPin) {
+    }
+
+    /**
+     * @brief Loads and starts the ULP program unless it is already running
+     * @return true if the counter is running
+     *
+     * Re-applies the pin configuration and the sleep config (both reset or
+     * possibly changed on every boot) also when the program kept running.
+     */
+    bool begin() {
+        int rtcIo = rtc_io_number_get(pin);
+        if (rtcIo < 0) {
+            Serial.printf("ULP rain counter: GPIO %d is not an RTC GPIO\n", pin);
+            return false;
+        }
+
+        // keep the RTC GPIO pullup powered in deep sleep and allow alert wakes
+        configurePin();
+        esp_sleep_pd_config(ESP_PD_DOMAIN_RTC_PERIPH, ESP_PD_OPTION_ON);
+        esp_sleep_enable_ulp_wakeup();
+
+        if (esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_UNDEFINED &&
+            readWord(ULP_RAIN_MAGIC_WORD) == ULP_RAIN_MAGIC) {
+            return true; // still counting since before deep sleep
+        }
+
+        RTC_SLOW_MEM[ULP_RAIN_MAGIC_WORD] = 0;
+        RTC_SLOW_MEM[ULP_RAIN_COUNT_WORD] = 0;
+        RTC_SLOW_MEM[ULP_RAIN_LEVEL_WORD] = 1; // idle HIGH through the pullup
+        RTC_SLOW_MEM[ULP_RAIN_DEBOUNCE_WORD] = ULP_RAIN_DEBOUNCE_SAMPLES;
+        RTC_SLOW_MEM[ULP_RAIN_MAX_WORD] = ULP_RAIN_DEBOUNCE_SAMPLES;
+        RTC_SLOW_MEM[ULP_RAIN_ALERT_WORD] = 0xFFFF; // disarmed until armAlert()
+        RTC_SLOW_MEM[ULP_RAIN_RUNS_WORD] = 0;
+        RTC_SLOW_MEM[ULP_RAIN_SECONDS_WORD] = 0;
+        ulpRainLastCount = 0;
+
+        enum { LBL_STABLE, LBL_ACCEPT, LBL_TIP, LBL_ALERT, LBL_SECOND, LBL_SAMPLE };
+        const ulp_insn_t program[] = {
+            I_MOVI(R3, 0),
+            // one more run: advance the seconds counter every ULP_RAIN_RUNS_PER_S
+            I_LD(R2, R3, ULP_RAIN_RUNS_WORD),
+            I_ADDI(R2, R2, 1),
+            I_SUBI(R1, R2, ULP_RAIN_RUNS_PER_S),
+            M_BXZ(LBL_SECOND),
+            I_ST(R2, R3, ULP_RAIN_RUNS_WORD),
+            M_BX(LBL_SAMPLE),
+            M_LABEL(LBL_SECOND),
+            I_ST(R1, R3, ULP_RAIN_RUNS_WORD),
+            I_LD(R2, R3, ULP_RAIN_SECONDS_WORD),
+            I_ADDI(R2, R2, 1),
+            I_ST(R2, R3, ULP_RAIN_SECONDS_WORD),
+
+            // R0 = current pin level
+            M_LABEL(LBL_SAMPLE),
+            I_RD_REG(RTC_GPIO_IN_REG, RTC_GPIO_IN_NEXT_S + rtcIo, RTC_GPIO_IN_NEXT_S + rtcIo),
+            I_LD(R1, R3, ULP_RAIN_LEVEL_WORD),
+            I_SUBR(R2, R0, R1),
+            M_BXZ(LBL_STABLE),
+
+            // level differs from the debounced one: count down
+            I_LD(R2, R3, ULP_RAIN_DEBOUNCE_WORD),
+            I_SUBI(R2, R2, 1),
+            M_BXZ(LBL_ACCEPT),
+            I_ST(R2, R3, ULP_RAIN_DEBOUNCE_WORD),
+            I_HALT(),
+
+            // level held long enough: it becomes the debounced level
+            M_LABEL(LBL_ACCEPT),
+            I_ST(R0, R3, ULP_RAIN_LEVEL_WORD),
+            I_LD(R2, R3, ULP_RAIN_MAX_WORD),
+            I_ST(R2, R3, ULP_RAIN_DEBOUNCE_WORD),
+            I_MOVR(R0, R0),
+            M_BXZ(LBL_TIP),
+            I_HALT(),
+
+            // falling edge: one bucket tip, stamp it with the seconds counter
+            M_LABEL(LBL_TIP),
+            I_LD(R0, R3, ULP_RAIN_SECONDS_WORD),
+            I_LD(R2, R3, ULP_RAIN_COUNT_WORD),
+            I_ANDI(R1, R2, ULP_RAIN_RING_LENGTH - 1),
+            I_ST(R0, R1, ULP_RAIN_RING_WORD),
+            // count after the stamp, so every counted tip has its stamp
+            I_ADDI(R2, R2, 1),
+            I_ST(R2, R3, ULP_RAIN_COUNT_WORD),
+            I_LD(R1, R3, ULP_RAIN_ALERT_WORD),
+            I_SUBR(R1, R2, R1),
+            M_BXZ(LBL_ALERT),
+            I_HALT(),
+
+            // alert count reached: wake the CPU (no-op while it is awake)
+            M_LABEL(LBL_ALERT),
+            I_WAKE(),
+            I_HALT(),
+
+            // level unchanged (or bounced back): restart the debounce window
+            M_LABEL(LBL_STABLE),
+            I_LD(R2, R3, ULP_RAIN_MAX_WORD),
+            I_ST(R2, R3, ULP_RAIN_DEBOUNCE_WORD),
+            I_HALT(),
+        };
+
+        size_t size = sizeof(program) / sizeof(ulp_insn_t);
+        esp_err_t err = ulp_process_macros_and_load(ULP_RAIN_PROG_ADDR, program, &size);
+        if (err != ESP_OK) {
+            Serial.printf("ULP rain counter: load failed (%d)\n", err);
+            return false;
+        }
+
+        ulp_set_wakeup_period(0, ULP_RAIN_PERIOD_US);
+        err = ulp_run(ULP_RAIN_PROG_ADDR);
+        if (err != ESP_OK) {
+            Serial.printf("ULP rain counter: start failed (%d)\n", err);
+            return false;
+        }
+
+        RTC_SLOW_MEM[ULP_RAIN_MAGIC_WORD] = ULP_RAIN_MAGIC;
+        Serial.printf("ULP rain counter started on GPIO %d (RTC IO %d)\n", pin, rtcIo);
+        return true;
+    }
+
+    /**
+     * @brief Get tips counted since the previous call
+     * @param tipTimes Receives Unix times of the newest tips, oldest first
+     *        (may be nullptr)
+     * @param maxTimes Capacity of tipTimes
+     * @param timed Receives the number of entries written to tipTimes
+     * @return Number of debounced bucket tips
+     *
+     * Only the newest ULP_RAIN_RING_LENGTH tips carry a stamp; older ones
+     * are counted but not timed. Stamps are converted by their age in ULP
+     * seconds, relative to the current time().
+     */
+    uint16_t takeTips(time_t* tipTimes, uint16_t maxTimes, uint16_t& timed) {
+        uint16_t count = readWord(ULP_RAIN_COUNT_WORD);
+        uint16_t tips = (uint16_t)(count - ulpRainLastCount);
+        ulpRainLastCount = count;
+
+        timed = (tips < ULP_RAIN_RING_LENGTH) ? tips : ULP_RAIN_RING_LENGTH;
+        if (tipTimes == nullptr) timed = 0;
+        else if (timed > maxTimes) timed = maxTimes;
+        if (timed == 0) return tips;
+
+        struct timeval tv;
+        gettimeofday(&tv, nullptr);
+        uint16_t nowSeconds = readWord(ULP_RAIN_SECONDS_WORD);
+
+        for (uint16_t i = 0; i < timed; i++) {
+            uint16_t n = (uint16_t)(count - timed + i);
+            uint16_t stamp = readWord(ULP_RAIN_RING_WORD + (n & (ULP_RAIN_RING_LENGTH - 1)));
+            tipTimes[i] = tv.tv_sec - (time_t)(uint16_t)(nowSeconds - stamp);
+        }
+        return tips;
+    }
+
+    /**
+     * @brief Get tips counted since the previous call, without times
+     */
+    uint16_t takeTips() {
+        uint16_t timed;
+        return takeTips(nullptr, 0, timed);
+    }
+
+    /**
+     * @brief Get tips counted since the last takeTips() without consuming them
+     */
+    uint16_t pendingTips() const {
+        return (uint16_t)(readWord(ULP_RAIN_COUNT_WORD) - ulpRainLastCount);
+    }
+
+    /**
+     * @brief Wake the CPU once this many tips are pending
+     * @param tips Pending tip count that triggers a ULP wake, 0 disarms
+     *
+     * The alert fires once per arm; call again after takeTips().
+     */
+    void armAlert(uint16_t tips) {
+        RTC_SLOW_MEM[ULP_RAIN_ALERT_WORD] = (tips == 0) ? (uint16_t)(ulpRainLastCount - 1)
+                                                        : (uint16_t)(ulpRainLastCount + tips);
+    }
+};
+
+#endif
@@ -5,38 +5,367 @@
 #include "esp_sleep.h"
 #include <PubSubClient.h>
 #include "MqttMessageQueue.h"
+#include "MqttPublish.h"
 
 // Forward declarations
 extern int latest_Raincount;
 
+#ifndef MQTT_PUBLISH_DELAY_MS
+#define MQTT_PUBLISH_DELAY_MS 0     // legacy fixed throttle, set to 100 to compare
+#endif
+
+/**
+ * @brief Throughput figures of one publish run
+ * 
+ * Filled by sendQueuedMessages()/sendBatchedMessages() and printed as
+ * messages/sec and ms/message so publish strategies can be compared.
+ */
+struct PublishStats {
+    size_t messages;        // queued messages delivered
+    size_t publishes;       // MQTT PUBLISH packets sent
+    bool confirmed;         // confirmDelivery() succeeded: publishes before the run arrived too
+    unsigned long startMs;
+    unsigned long elapsedMs;
+
+    PublishStats() : messages(0), publishes(0), confirmed(false), startMs(millis()), elapsedMs(0) {}
+
+    void finish() {
+        elapsedMs = millis() - startMs;
+    }
+
+    void print() const {
+        float seconds = elapsedMs / 1000.0;
+        Serial.printf("(%dms) Published %u msgs in %u packets, %lu ms (%.1f msg/s, %.1f ms/msg)\n",
+                     millis(), (unsigned)messages, (unsigned)publishes, elapsedMs,
+                     seconds > 0 ? messages / seconds : 0.0,
+                     messages > 0 ? (float)elapsedMs / messages : 0.0);
+    }
+};
+
+/**
+ * @brief Services the MQTT client between publishes
+ * @param mqttClient Client to service
+ * @return false if the connection dropped
+ * 
+ * Drives PubSubClient::loop() so keepalive and inbound packets are handled
+ * while streaming. Flow control comes from the socket itself: WiFiClient
+ * write() blocks until the TCP send buffer accepts the whole packet, so no
+ * fixed delay is needed between messages.
+ */
+bool servicePublish(PubSubClient& mqttClient) {
+    if (MQTT_PUBLISH_DELAY_MS > 0) {
+        delay(MQTT_PUBLISH_DELAY_MS);
+    }
+    return mqttClient.loop();
+}
+
 /**
  * @brief Sends all queued MQTT messages to the broker with optional timestamp info
- * @tparam QUEUE_SIZE The size of the MQTT message queue
+ * @tparam Queue MqttMessageQueue type holding the messages
  * @param mqttClient Reference to the PubSubClient for MQTT communication
  * @param mqtt_queue Reference to the MqttMessageQueue containing messages to send
+ * @return Throughput figures of this run
  * 
- * Dequeues all messages and publishes to broker with 100ms delays.
- * Debug output shows sending progress and timestamps when available.
+ * Publishes each message in place from the queue storage (no copies) as fast
+ * as the socket accepts them. A message is popped only once publish()
+ * reports the whole packet written; on failure or disconnect the remaining
+ * messages stay queued. Debug output shows sending progress and timestamps
+ * when available.
  */
-template<size_t QUEUE_SIZE>
-void sendQueuedMessages(PubSubClient& mqttClient, MqttMessageQueue<QUEUE_SIZE>& mqtt_queue) {
-    MqttMessage msg;
+template<class Queue>
+PublishStats sendQueuedMessages(PubSubClient& mqttClient, Queue& mqtt_queue) {
+    MqttRecord msg;
+    PublishStats stats;
     Serial.printf("(%dms) Sending queued messages...\n",millis());
-    while (!mqtt_queue.isEmpty()) {
-        if (mqtt_queue.dequeue(msg)) {
-            if (msg.timestamp > 0) {
-                struct tm* timeinfo = localtime(&msg.timestamp);
-                Serial.printf("Sending msg (timestamp: %04d-%02d-%02d %02d:%02d:%02d): %s\n",
-                             timeinfo->tm_year + 1900, timeinfo->tm_mon + 1, timeinfo->tm_mday,
-                             timeinfo->tm_hour, timeinfo->tm_min, timeinfo->tm_sec,
-                             msg.payload.c_str());
+    while (mqtt_queue.peek(msg)) {
+        if (msg.timestamp > 0) {
+            struct tm* timeinfo = localtime(&msg.timestamp);
+            Serial.printf("Sending msg (timestamp: %04d-%02d-%02d %02d:%02d:%02d): %s\n",
+                         timeinfo->tm_year + 1900, timeinfo->tm_mon + 1, timeinfo->tm_mday,
+                         timeinfo->tm_hour, timeinfo->tm_min, timeinfo->tm_sec,
+                         msg.payload);
+        } else {
+            Serial.printf("Sending msg: %s\n", msg.payload);
+        }
+        if (!mqttClient.publish(msg.topic, (const uint8_t*)msg.payload, msg.length)) {
+            Serial.printf("Publish failed, rc=%d, %u msgs left queued\n", mqttClient.state(), (unsigned)mqtt_queue.size());
+            break;
+        }
+        mqtt_queue.pop();
+        stats.messages++;
+        stats.publishes++;
+        if (!servicePublish(mqttClient)) break;
+    }
+    stats.finish();
+    stats.print();
+    return stats;
+}
+
+#ifndef MQTT_CONFIRM_TIMEOUT_MS
+#define MQTT_CONFIRM_TIMEOUT_MS 2000   // wait for the broker's PINGRESP before giving up
+#endif
+
+/**
+ * @brief Reads one byte from the socket, waiting until the confirm deadline
+ * @return The byte, or -1 on timeout or a dropped link
+ */
+int readConfirmByte(Client& link, unsigned long start, unsigned long timeoutMs) {
+    while (link.available() <= 0) {
+        if (!link.connected() || millis() - start >= timeoutMs) return -1;
+        delay(1);
+    }
+    return link.read();
+}
+
+/**
+ * @brief Waits until the broker has received everything published so far
+ * @param mqttClient Connected client whose publishes should be confirmed
+ * @param link Socket under mqttClient
+ * @param timeoutMs Give up after this long
+ * @return true once the broker answered
+ * 
+ * QoS 0 publishes are never acknowledged, and a successful write() only
+ * means the bytes reached the local TCP send buffer; disconnecting and
+ * sleeping right after can lose them. The broker handles a connection's
+ * packets in order, so its PINGRESP to a PINGREQ sent behind the publishes
+ * proves they arrived.
+ * 
+ * PubSubClient has no call that sends a PINGREQ on demand, so the ping
+ * goes straight to the socket. That is safe for this publish-only client:
+ * it subscribes to nothing, and it only pings by itself from loop() once
+ * MQTT_KEEPALIVE_S pass without traffic, which the sketch sets longer
+ * than a wake's radio time. loop() runs first so the client takes
+ * anything already inbound; after the ping, every packet up to the
+ * PINGRESP is read whole and skipped, so an unexpected packet neither
+ * fails the confirmation nor leaves the client reading mid-packet.
+ * Call it once after the last publish, not per packet.
+ */
+bool confirmDelivery(PubSubClient& mqttClient, Client& link, unsigned long timeoutMs = MQTT_CONFIRM_TIMEOUT_MS) {
+    static const uint8_t pingreq[2] = { 0xC0, 0x00 };
+    unsigned long start = millis();
+
+    if (!mqttClient.loop() || link.write(pingreq, sizeof(pingreq)) != sizeof(pingreq)) {
+        return false;
+    }
+    while (true) {
+        int type = readConfirmByte(link, start, timeoutMs);
+        uint32_t remaining = 0;
+        int b = 0x80;
+        for (int shift = 0; type >= 0 && (b & 0x80); shift += 7) {
+            b = shift < 28 ? readConfirmByte(link, start, timeoutMs) : -1;   // at most 4 length bytes
+            if (b < 0) type = -1;
+            else remaining |= (uint32_t)(b & 0x7F) << shift;
+        }
+        if (type < 0) {
+            Serial.printf("(%dms) No PINGRESP within %lu ms, delivery unconfirmed\n", millis(), timeoutMs);
+            return false;
+        }
+        if (type == 0xD0 && remaining == 0) break;
+
+        Serial.printf("Skipping packet 0x%02x (%lu bytes) while confirming delivery\n",
+                      type, (unsigned long)remaining);
+        for (; remaining > 0; remaining--) {
+            if (readConfirmByte(link, start, timeoutMs) < 0) {
+                Serial.printf("(%dms) No PINGRESP within %lu ms, delivery unconfirmed\n", millis(), timeoutMs);
+                return false;
+            }
+        }
+    }
+    Serial.printf("(%dms) Delivery confirmed in %lu ms\n", millis(), millis() - start);
+    return true;
+}
+
+#ifndef MQTT_BATCH_MAX_RECORDS
+#define MQTT_BATCH_MAX_RECORDS 20
+#endif
+
+/**
+ * @brief Payload layouts produced by sendBatchedMessages()
+ * 
+ * BATCH_ARRAY: one object per record, each with its own "ts" (default)
+ *   [{"rain": 0.02, "ts": 1700000000}, {"soil_temp": 72.5, "ts": 1700000060}]
+ * BATCH_OBJECT: one object keyed by field, for records sharing one "ts"
+ *   {"rain": 0.02, "soil_temp": 72.5, "battery": 3.7, "ts": 1700000000}
+ */
+enum BatchFormat {
+    BATCH_ARRAY,
+    BATCH_OBJECT
+};
+
+/**
+ * @brief Writes one record of a BATCH_ARRAY payload: its members plus "ts"
+ */
+template<class Encoder>
+void writeBatchItem(MqttBatchBuffer& out, const MqttRecordMembers& record, time_t timestamp) {
+    Encoder::beginObject(out, record.count + (timestamp > 0 ? 1 : 0));
+    out.put(record.begin, record.end - record.begin);
+    if (timestamp > 0) {
+        if (record.count > 0) Encoder::separator(out);
+        Encoder::timestamp(out, timestamp);
+    }
+    Encoder::endObject(out);
+}
+
+/**
+ * @brief Checks whether two stored records have a key in common
+ */
+template<class Encoder>
+bool sharesKey(const MqttRecordMembers& a, const MqttRecordMembers& b) {
+    const char* keyA;
+    const char* keyB;
+    size_t lengthA, lengthB;
+    for (const char* at = a.begin; at < a.end && Encoder::nextMember(at, a.end, keyA, lengthA); ) {
+        for (const char* bt = b.begin; bt < b.end && Encoder::nextMember(bt, b.end, keyB, lengthB); ) {
+            if (lengthA == lengthB && memcmp(keyA, keyB, lengthA) == 0) return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Publishes queued messages merged into one payload per topic
+ * @tparam Queue MqttMessageQueue type holding the messages
+ * @param mqttClient Reference to the PubSubClient for MQTT communication
+ * @param mqtt_queue Reference to the MqttMessageQueue containing messages to send
+ * @param link Socket under mqttClient, used to confirm delivery (nullptr: don't confirm)
+ * @param format Payload layout, see BatchFormat
+ * @param unconfirmed Earlier publishes on this connection still await
+ *        confirmation: confirm even if nothing is queued
+ * @return Throughput figures of this run
+ * 
+ * Consecutive messages with the same topic (up to MQTT_BATCH_MAX_RECORDS,
+ * as many as fit publishCapacity()) are merged into one payload in the
+ * queue's encoding (JSON or MessagePack) and sent in a single publish
+ * with no inter-message delay. BATCH_OBJECT falls back to BATCH_ARRAY for
+ * a batch whose records differ in timestamp or repeat a field (e.g. rain
+ * accumulated over several offline wakes), so no sample or sample time is
+ * lost.
+ * 
+ * Nothing is decoded or allocated: the stored records' encoded members
+ * are copied into mqttPublishBuffer between the encoder's framing bytes,
+ * and the buffer is sent with publishPacket() in a single write. Batches
+ * are sized to the client buffer set at connect, which is never resized.
+ * With a link, published messages stay queued until one confirmDelivery()
+ * after the last batch saw the broker receive them, then are popped
+ * together. Look-ahead ends at the first spilled message, so reaching it
+ * confirms and pops what was sent so far first (each spilled message
+ * costs a round-trip). On failure, disconnect or a missing reply the
+ * unconfirmed messages stay queued and may be sent again on the next
+ * transmit wake.
+ */
+template<class Queue>
+PublishStats sendBatchedMessages(PubSubClient& mqttClient, Queue& mqtt_queue, Client* link = nullptr,
+                                 BatchFormat format = BATCH_ARRAY, bool unconfirmed = false) {
+    typedef typename Queue::RecordEncoder Encoder;
+    MqttRecord msg;
+    PublishStats stats;
+    size_t outstanding = 0;     // published, popped once confirmed
+    bool connected = true;
+    Serial.printf("(%dms) Sending batched messages...\n",millis());
+
+    while (connected) {
+        if (!mqtt_queue.peekAt(outstanding, msg)) {
+            if (outstanding == 0 || outstanding >= mqtt_queue.size()) break;
+            // at the look-ahead limit: confirm so the spilled message can be reached
+            if (!confirmDelivery(mqttClient, *link)) break;
+            stats.messages += outstanding;
+            for (; outstanding > 0; outstanding--) mqtt_queue.pop();
+            stats.confirmed = true;
+            unconfirmed = false;
+            continue;
+        }
+        const char* batchTopic = msg.topic;
+        size_t capacity = publishCapacity(mqttClient, batchTopic);
+        MqttRecordMembers records[MQTT_BATCH_MAX_RECORDS];
+        time_t timestamps[MQTT_BATCH_MAX_RECORDS];
+        size_t n = 0;
+        size_t itemBytes = 0;    // array items and separators
+        bool mergeable = true;   // same timestamp, no field twice
+
+        // collect consecutive object records for the same topic while the array layout fits
+        while (n < MQTT_BATCH_MAX_RECORDS && mqtt_queue.peekAt(outstanding + n, msg) &&
+               strcmp(msg.topic, batchTopic) == 0 &&
+               Encoder::members(msg.payload, msg.length, records[n])) {
+            MqttBatchBuffer item(nullptr, SIZE_MAX);
+            if (n > 0) Encoder::separator(item);
+            writeBatchItem<Encoder>(item, records[n], msg.timestamp);
+            MqttBatchBuffer frame(nullptr, SIZE_MAX);
+            Encoder::beginArray(frame, n + 1);
+            Encoder::endArray(frame);
+            if (frame.length + itemBytes + item.length > capacity) break;
+
+            if (n > 0 && msg.timestamp != timestamps[0]) mergeable = false;
+            for (size_t i = 0; i < n && mergeable; i++) {
+                if (sharesKey<Encoder>(records[i], records[n])) mergeable = false;
+            }
+            itemBytes += item.length;
+            timestamps[n] = msg.timestamp;
+            n++;
+        }
+
+        // unparseable payload: send it unchanged on its own
+        if (n == 0) {
+            mqtt_queue.peekAt(outstanding, msg);
+            if (!mqttClient.publish(msg.topic, (const uint8_t*)msg.payload, msg.length)) break;
+            n = 1;
+        } else {
+            MqttBatchBuffer batch(mqttPublishBuffer, capacity);
+            if (format == BATCH_OBJECT && mergeable) {
+                size_t fields = 0;
+                for (size_t i = 0; i < n; i++) fields += records[i].count;
+                Encoder::beginObject(batch, fields + (timestamps[0] > 0 ? 1 : 0));
+                bool first = true;
+                for (size_t i = 0; i < n; i++) {
+                    if (records[i].count == 0) continue;
+                    if (!first) Encoder::separator(batch);
+                    batch.put(records[i].begin, records[i].end - records[i].begin);
+                    first = false;
+                }
+                if (timestamps[0] > 0) {
+                    if (!first) Encoder::separator(batch);
+                    Encoder::timestamp(batch, timestamps[0]);
+                }
+                Encoder::endObject(batch);
             } else {
-                Serial.printf("Sending msg: %s\n", msg.payload.c_str());
+                Encoder::beginArray(batch, n);
+                for (size_t i = 0; i < n; i++) {
+                    if (i > 0) Encoder::separator(batch);
+                    writeBatchItem<Encoder>(batch, records[i], timestamps[i]);
+                }
+                Encoder::endArray(batch);
+            }
+
+            Serial.printf("Sending batch of %u msgs (%u bytes)\n", (unsigned)n, (unsigned)batch.length);
+            if (batch.overflow || !publishPacket(mqttClient, batchTopic, mqttPublishBuffer, batch.length)) {
+                Serial.printf("Batch publish failed, rc=%d, %u msgs left queued\n", mqttClient.state(), (unsigned)mqtt_queue.size());
+                break;
             }
-            mqttClient.publish(msg.topic.c_str(), msg.payload.c_str());
-            delay(100);
         }
+
+        stats.publishes++;
+        if (link == nullptr) {
+            for (size_t i = 0; i < n; i++) mqtt_queue.pop();
+            stats.messages += n;
+        } else {
+            outstanding += n;
+        }
+        connected = servicePublish(mqttClient);
+    }
+
+    if (link != nullptr && (outstanding > 0 || unconfirmed) && connected) {
+        if (confirmDelivery(mqttClient, *link)) {
+            for (size_t i = 0; i < outstanding; i++) mqtt_queue.pop();
+            stats.messages += outstanding;
+            stats.confirmed = true;
+            outstanding = 0;
+        }
+    }
+    if (outstanding > 0) {
+        Serial.printf("%u msgs unconfirmed, %u left queued\n", (unsigned)outstanding, (unsigned)mqtt_queue.size());
     }
+    stats.finish();
+    stats.print();
+    return stats;
 }
 
 /**
@@ -2,18 +2,169 @@
 #define WIFIMANAGER_H
 
 #include <WiFi.h>
+#include <ArduinoJson.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "esp_rtc_time.h"
+
+#ifndef WIFI_FAST_TIMEOUT_MS
+#define WIFI_FAST_TIMEOUT_MS 1500   // cached BSSID/channel/IP association budget
+#endif
+#ifndef WIFI_SCAN_TIMEOUT_MS
+#define WIFI_SCAN_TIMEOUT_MS 3000   // scan + DHCP share of the default connect() budget
+#endif
+#ifndef WIFI_LEASE_RENEW_S
+#define WIFI_LEASE_RENEW_S 3600     // cached IP reused this long after DHCP; keep <= half the router's lease
+#endif
+
+enum WiFiStrategy : uint8_t {
+    WIFI_STRATEGY_FAST = 0,   // cached BSSID, channel and IP, no scan, no DHCP
+    WIFI_STRATEGY_SCAN,       // SSID scan on all channels, DHCP unless static IP
+    WIFI_STRATEGY_COUNT
+};
+
+#define WIFI_EVENT_GOT_IP       (1 << 0)
+#define WIFI_EVENT_DISCONNECTED (1 << 1)
+
+// Set from the WiFi event task, waited on by WiFiManager::connect()
+EventGroupHandle_t wifiEvents = nullptr;
+volatile uint8_t wifiDisconnectReason = 0;
+
+/**
+ * @brief WiFi event callback, signals got-IP and disconnect to connect()
+ */
+void wifiEventHandler(arduino_event_id_t event, arduino_event_info_t info) {
+    if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP) {
+        xEventGroupSetBits(wifiEvents, WIFI_EVENT_GOT_IP);
+    } else if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
+        wifiDisconnectReason = info.wifi_sta_disconnected.reason;
+        xEventGroupSetBits(wifiEvents, WIFI_EVENT_DISCONNECTED);
+    }
+}
+
+// RTC persistent association state of the last successful connect
+RTC_DATA_ATTR bool wifiCacheValid = false;
+RTC_DATA_ATTR uint8_t wifiCacheBssid[6];
+RTC_DATA_ATTR int32_t wifiCacheChannel = 0;
+RTC_DATA_ATTR uint32_t wifiCacheIp = 0;
+RTC_DATA_ATTR uint32_t wifiCacheGateway = 0;
+RTC_DATA_ATTR uint32_t wifiCacheSubnet = 0;
+RTC_DATA_ATTR uint32_t wifiCacheDns = 0;
+RTC_DATA_ATTR uint64_t wifiLeaseStartUs = 0;   // RTC clock when DHCP last assigned the cached IP
+
+// RTC persistent time-to-connect statistics per strategy, reset when published
+RTC_DATA_ATTR uint16_t wifiConnects[WIFI_STRATEGY_COUNT];
+RTC_DATA_ATTR uint16_t wifiConnectFailures[WIFI_STRATEGY_COUNT];
+RTC_DATA_ATTR uint32_t wifiConnectTotalMs[WIFI_STRATEGY_COUNT];
+RTC_DATA_ATTR uint32_t wifiConnectMaxMs[WIFI_STRATEGY_COUNT];
 
 /**
  * @brief WiFi connection manager with fast reconnect and static IP support
  * 
  * This class manages WiFi connections for ESP32 with optimizations for low-power
  * applications. It supports:
- * - Fast reconnection using stored credentials to minimize connection time
  * - Static IP configuration to avoid DHCP delays
- * - BSSID/channel caching for fastest possible reconnection
- * - Connection timeout handling with detailed logging
+ * - BSSID/channel/IP of the last association cached in RTC memory, reused
+ *   on the next wake to skip the scan and DHCP
+ * - Fallback to a full scan only after the cached association failed
+ * - Time-to-connect statistics per strategy, see publishStats()
+ *
+ * connect() is driven by WiFi events instead of polling WiFi.status(): it
+ * blocks on got-IP/disconnected events until one budget in milliseconds
+ * runs out. A disconnect on the fast path falls through to the scan at
+ * once; a disconnect on the scan path for a reason retrying cannot fix
+ * (AP not found, wrong password) gives up early.
  */
 class WiFiManager {
+private:
+  static const char* strategyName(uint8_t strategy) {
+    return (strategy == WIFI_STRATEGY_FAST) ? "fast" : "scan";
+  }
+
+  static bool validBssid(const uint8_t* mac) {
+    if (mac == nullptr) return false;
+    for (uint8_t i = 0; i < 6; i++) {
+      if (mac[i] != 0) return true;
+    }
+    return false;
+  }
+
+  static bool retryable(uint8_t reason) {
+    return reason != WIFI_REASON_NO_AP_FOUND &&
+           reason != WIFI_REASON_AUTH_FAIL &&
+           reason != WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT &&
+           reason != WIFI_REASON_HANDSHAKE_TIMEOUT;
+  }
+
+  /**
+   * @brief Starts association with the event bits cleared
+   */
+  void beginAssociation(int32_t ch, const uint8_t* ap) {
+    xEventGroupClearBits(wifiEvents, WIFI_EVENT_GOT_IP | WIFI_EVENT_DISCONNECTED);
+    if (ap != nullptr) {
+      WiFi.begin(ssid, password, ch, ap);
+    } else {
+      WiFi.begin(ssid, password);
+    }
+  }
+
+  /**
+   * @brief Waits for the got-IP event and records the time-to-connect
+   * @return true if connected within timeoutMs
+   *
+   * The fast strategy fails on the first disconnect event. The scan
+   * strategy lets the driver retry transient disconnects until timeoutMs.
+   */
+  bool waitConnected(uint8_t strategy, unsigned long start, unsigned long timeoutMs) {
+    bool connected = false;
+    while (!connected) {
+      unsigned long elapsed = millis() - start;
+      if (elapsed >= timeoutMs) break;
+      EventBits_t bits = xEventGroupWaitBits(wifiEvents, WIFI_EVENT_GOT_IP | WIFI_EVENT_DISCONNECTED,
+                                             pdTRUE, pdFALSE, pdMS_TO_TICKS(timeoutMs - elapsed));
+      if (bits & WIFI_EVENT_GOT_IP) {
+        connected = true;
+      } else if (bits & WIFI_EVENT_DISCONNECTED) {
+        Serial.printf("WiFi %s: disconnected, reason %u\n", strategyName(strategy), wifiDisconnectReason);
+        if (strategy == WIFI_STRATEGY_FAST || !retryable(wifiDisconnectReason)) break;
+      }
+    }
+
+    uint32_t elapsed = millis() - start;
+    if (!connected) {
+      wifiConnectFailures[strategy]++;
+      Serial.printf("WiFi %s connect failed after %lu ms\n", strategyName(strategy), (unsigned long)elapsed);
+      return false;
+    }
+
+    wifiConnects[strategy]++;
+    wifiConnectTotalMs[strategy] += elapsed;
+    if (elapsed > wifiConnectMaxMs[strategy]) wifiConnectMaxMs[strategy] = elapsed;
+    Serial.printf("Connected in %lu ms (%s)\n", (unsigned long)elapsed, strategyName(strategy));
+    Serial.print("IP Address: ");
+    Serial.println(WiFi.localIP());
+    return true;
+  }
+
+  /**
+   * @brief Caches the current association for the next wake
+   * 
+   * Only called after DHCP (or the static IP) configured the interface.
+   */
+  void saveAssociation() {
+    const uint8_t* mac = WiFi.BSSID();
+    if (!validBssid(mac)) return;
+
+    memcpy(wifiCacheBssid, mac, sizeof(wifiCacheBssid));
+    wifiCacheChannel = WiFi.channel();
+    wifiCacheIp = (uint32_t)WiFi.localIP();
+    wifiCacheGateway = (uint32_t)WiFi.gatewayIP();
+    wifiCacheSubnet = (uint32_t)WiFi.subnetMask();
+    wifiCacheDns = (uint32_t)WiFi.dnsIP();
+    wifiLeaseStartUs = esp_rtc_get_time_us();
+    wifiCacheValid = true;
+  }
+
 public:
   const char* ssid;
   const char* password;
@@ -76,7 +227,8 @@ public:
    * @param ap_channel The WiFi channel number (1-13) of the access point
    * 
    * Provides specific BSSID and channel to eliminate scanning, significantly
-   * reducing connection time for battery-powered devices.
+   * reducing connection time for battery-powered devices. Used for the
+   * fast strategy until an association has been cached in RTC memory.
    */
   void setFastConnect(uint8_t* ap_bssid, int ap_channel) {
     bssid = ap_bssid;
@@ -84,54 +236,119 @@ public:
   }
 
   /**
-   * @brief Connects to WiFi with boot-specific optimization strategy
-   * @param bootNum Boot counter to determine connection strategy (2 = first-time setup)
+   * @brief Connects to WiFi, reusing the last association when possible
+   * @param budgetMs Max milliseconds to spend, shared by both strategies
+   * @return true if connected
    * 
-   * bootNum == 2: First-time setup, saves credentials to flash
-   * Other values: Fast reconnect using stored credentials
-   * 
-   * Process: Station mode, disable sleep, apply static IP, 3s timeout,
-   * report time/IP on success. Optimized for battery applications.
+   * Fast strategy: joins the cached BSSID on the cached channel and reuses
+   * the cached IP configuration, so neither a scan nor DHCP is needed.
+   * Falls back to the scan strategy (SSID scan, DHCP unless static IP) with
+   * the rest of the budget only after the fast attempt failed, and
+   * invalidates the cache. DHCP runs again once WIFI_LEASE_RENEW_S has
+   * passed on the RTC clock since the lease was obtained, like a DHCP
+   * client renewing at T1, so the cached IP is never used past its lease. Never writes credentials to flash.
+   * On failure the radio is switched off so the caller can keep buffering.
    */
-  void connect(int bootNum) {
+  bool connect(unsigned long budgetMs = WIFI_FAST_TIMEOUT_MS + WIFI_SCAN_TIMEOUT_MS) {
+    if (WiFi.isConnected()) return true;
+
+    unsigned long start = millis();
+    if (wifiEvents == nullptr) {
+      wifiEvents = xEventGroupCreate();
+      WiFi.onEvent(wifiEventHandler, ARDUINO_EVENT_WIFI_STA_GOT_IP);
+      WiFi.onEvent(wifiEventHandler, ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+    }
+
     WiFi.mode(WIFI_STA);
     WiFi.setSleep(false);
+    WiFi.persistent(false); //don't write to flash all the time
 
-    if (use_static_ip) {
-      WiFi.config(local_ip, gateway, subnet, dns);
+    const uint8_t* fastBssid = wifiCacheValid ? wifiCacheBssid : (validBssid(bssid) ? bssid : nullptr);
+    int32_t fastChannel = wifiCacheValid ? wifiCacheChannel : channel;
+    bool reuseIp = wifiCacheValid &&
+                   esp_rtc_get_time_us() - wifiLeaseStartUs < (uint64_t)WIFI_LEASE_RENEW_S * 1000000ULL;
+
+    if (fastBssid != nullptr && fastChannel > 0) {
+      if (use_static_ip) {
+        WiFi.config(local_ip, gateway, subnet, dns);
+      } else if (reuseIp) {
+        WiFi.config(IPAddress(wifiCacheIp), IPAddress(wifiCacheGateway),
+                    IPAddress(wifiCacheSubnet), IPAddress(wifiCacheDns));
+      }
+      Serial.printf("Fast reconnect: channel %ld, %s BSSID, %s IP...\n", (long)fastChannel,
+                    wifiCacheValid ? "cached" : "configured", reuseIp ? "cached" : "configured/DHCP");
+      unsigned long fastStart = millis();
+      beginAssociation(fastChannel, fastBssid);
+      unsigned long fastBudget = (budgetMs < WIFI_FAST_TIMEOUT_MS) ? budgetMs : WIFI_FAST_TIMEOUT_MS;
+      if (waitConnected(WIFI_STRATEGY_FAST, fastStart, fastBudget)) {
+        if (!reuseIp) saveAssociation();
+        return true;
+      }
+      wifiCacheValid = false;
+      WiFi.disconnect();
     }
 
-    if (bootNum == 2) {
-      Serial.println("First-time setup: Saving WiFI credentials to flash...");
-      WiFi.persistent(true);
-      WiFi.begin(ssid, password, channel, bssid); // Save credentials permanently
-    } else {
-      WiFi.persistent(false); //don't write to flash all the time
-      Serial.println("Fast reconnect: using stored credentials...");        
-      WiFi.begin(); //fast (uses saved credentials. does not write to flash)
-      //if (bssid && channel > 0) {        
-      //  Serial.println("Fast reconnect: using provided credentials...");
-      //  WiFi.begin(ssid, password, channel, bssid); //fastest (Provides all info to avoid scanning) avoids flash write of credentials)
-      //} else {
-      //  Serial.println("Fast reconnect: using stored credentials...");        
-      //  WiFi.begin(); //fast (uses saved credentials. does not write to flash)
-      //}
+    unsigned long spent = millis() - start;
+    if (spent < budgetMs) {
+      if (use_static_ip) {
+        WiFi.config(local_ip, gateway, subnet, dns);
+      } else {
+        WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0), IPAddress((uint32_t)0)); // DHCP
+      }
+      Serial.println("Scanning for WiFi network...");
+      unsigned long scanStart = millis();
+      beginAssociation(0, nullptr);
+      if (waitConnected(WIFI_STRATEGY_SCAN, scanStart, budgetMs - spent)) {
+        saveAssociation();
+        return true;
+      }
     }
 
-    unsigned long start = millis();
-    while (WiFi.status() != WL_CONNECTED && millis() - start < 3000) {
-      delay(10);
+    Serial.printf("WiFi connection failed within %lu ms budget.\n", budgetMs);
+    WiFi.disconnect(true); // radio off, readings stay buffered
+    return false;
+  }
+
+  /**
+   * @brief Queues time-to-connect statistics per strategy as one MQTT message
+   * @tparam Queue MQTT message queue type
+   * @param queue Queue receiving the statistics
+   * @param topic MQTT topic for the statistics
+   * @return true if the statistics were queued (or there were none)
+   *
+   * Strategies without attempts are omitted. Format:
+   * {"wifi_connect": {"fast": {"n": n, "avg_ms": ms, "max_ms": ms, "failed": n}, "scan": {...}}}
+   *
+   * Resets the statistics on success.
+   */
+  template<class Queue>
+  bool publishStats(Queue* queue, const char* topic) {
+    JsonDocument doc;
+    JsonObject stats = doc["wifi_connect"].to<JsonObject>();
+    bool any = false;
+
+    for (uint8_t strategy = 0; strategy < WIFI_STRATEGY_COUNT; strategy++) {
+      if (wifiConnects[strategy] == 0 && wifiConnectFailures[strategy] == 0) continue;
+      JsonObject entry = stats[strategyName(strategy)].to<JsonObject>();
+      entry["n"] = wifiConnects[strategy];
+      entry["avg_ms"] = (wifiConnects[strategy] > 0) ? wifiConnectTotalMs[strategy] / wifiConnects[strategy] : 0;
+      entry["max_ms"] = wifiConnectMaxMs[strategy];
+      entry["failed"] = wifiConnectFailures[strategy];
+      any = true;
     }
+    if (!any) return true;
 
-    if (WiFi.status() == WL_CONNECTED) {
-      Serial.print("Connected in ");
-      Serial.print(millis() - start);
-      Serial.println(" ms");
-      Serial.print("IP Address: ");
-      Serial.println(WiFi.localIP());
-    } else {
-      Serial.println("WiFi connection failed.");
+    if (!queue->enqueue(topic, doc)) {
+      Serial.println("WiFi: connect stats not queued (queue full)");
+      return false;
+    }
+    for (uint8_t strategy = 0; strategy < WIFI_STRATEGY_COUNT; strategy++) {
+      wifiConnects[strategy] = 0;
+      wifiConnectFailures[strategy] = 0;
+      wifiConnectTotalMs[strategy] = 0;
+      wifiConnectMaxMs[strategy] = 0;
     }
+    return true;
   }
 };
 
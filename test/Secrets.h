@@ -0,0 +1,25 @@
+#ifndef SECRETS_H
+#define SECRETS_H
+
+// Settings the firmware simulator (test_firmware) builds RainGauge.ino with
+
+//WIFI
+const char* WIFI_SSID = "sim-ssid";
+const char* WIFI_PASSWORD = "sim-password";
+const char* LOCAL_IP = "192.168.1.60";
+const char* GATEWAY_IP = "192.168.1.1";
+const char* SUBNET_MASK = "255.255.255.0";
+const char* DNS_SERVER = "192.168.1.1";
+const int   WIFI_CHANNEL = 6;
+uint8_t     WIFI_BSSID[] = { 0x60, 0x38, 0xE0, 0xAA, 0xBB, 0xCC };
+
+//OTA
+const int   OTA_PORT = 3232;
+const char* OTA_HOSTNAME = "raingauge-sim";
+const char* OTA_PASSWORD = "sim";
+
+// MQTT Broker
+const char* mqtt_broker = "192.168.1.2";
+const int mqtt_port = 1883;
+
+#endif
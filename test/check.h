@@ -0,0 +1,42 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+// Minimal assertion helpers for the host tests: every failed CHECK is
+// reported with its location, and main() returns the failure count.
+
+#include <stdio.h>
+#include <string.h>
+
+static int checkFailures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+        checkFailures++; \
+    } \
+} while (0)
+
+#define CHECK_EQ(a, b) do { \
+    long long _a = (long long)(a), _b = (long long)(b); \
+    if (_a != _b) { \
+        printf("%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #a, #b, _a, _b); \
+        checkFailures++; \
+    } \
+} while (0)
+
+#define CHECK_STR(a, b) do { \
+    const char* _a = (a); const char* _b = (b); \
+    if (_a == nullptr || _b == nullptr || strcmp(_a, _b) != 0) { \
+        printf("%s:%d: CHECK_STR(%s, %s) failed: \"%s\" != \"%s\"\n", __FILE__, __LINE__, #a, #b, \
+               _a ? _a : "(null)", _b ? _b : "(null)"); \
+        checkFailures++; \
+    } \
+} while (0)
+
+#define RUN(test) do { \
+    int _before = checkFailures; \
+    test(); \
+    printf("%s %s\n", checkFailures == _before ? "PASS" : "FAIL", #test); \
+} while (0)
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef FAKE_ADAFRUIT_BMP280_H
+#define FAKE_ADAFRUIT_BMP280_H
+
+// Host stand-in for the Adafruit BMP280 driver. A forced measurement keeps
+// the status register's measuring bit (0x08) set for fakeBmp280.measureMs,
+// then the readings are fakeBmp280.tempC and fakeBmp280.pressurePa.
+
+#include "Arduino.h"
+
+#define BMP280_ADDRESS 0x77
+#define BMP280_CHIPID 0x58
+
+struct FakeBmp280 {
+    bool present = true;
+    float tempC = 18.5f;
+    float pressurePa = 101325.0f;
+    unsigned long measureMs = 39;   // 2x temperature, 16x pressure oversampling
+    int forced = 0;                 // forced measurements started
+};
+inline FakeBmp280 fakeBmp280;
+
+class Adafruit_BMP280 {
+public:
+    enum sensor_sampling { SAMPLING_NONE, SAMPLING_X1, SAMPLING_X2, SAMPLING_X4, SAMPLING_X8, SAMPLING_X16 };
+    enum sensor_mode { MODE_SLEEP = 0x00, MODE_FORCED = 0x01, MODE_NORMAL = 0x03, MODE_SOFT_RESET_CODE = 0xB6 };
+    enum sensor_filter { FILTER_OFF, FILTER_X2, FILTER_X4, FILTER_X8, FILTER_X16 };
+    enum standby_duration {
+        STANDBY_MS_1, STANDBY_MS_63, STANDBY_MS_125, STANDBY_MS_250,
+        STANDBY_MS_500, STANDBY_MS_1000, STANDBY_MS_2000, STANDBY_MS_4000
+    };
+
+    bool begin(uint8_t = BMP280_ADDRESS, uint8_t = BMP280_CHIPID) { return fakeBmp280.present; }
+    void setSampling(sensor_mode mode = MODE_NORMAL, sensor_sampling = SAMPLING_X16,
+                     sensor_sampling = SAMPLING_X16, sensor_filter = FILTER_OFF,
+                     standby_duration = STANDBY_MS_1) {
+        if (mode != MODE_FORCED) return;
+        fakeBmp280.forced++;
+        measuringUntil = millis() + fakeBmp280.measureMs;
+    }
+    uint8_t getStatus() { return (long)(measuringUntil - millis()) > 0 ? 0x08 : 0x00; }
+    float readTemperature() { return fakeBmp280.tempC; }
+    float readPressure() { return fakeBmp280.pressurePa; }
+
+private:
+    unsigned long measuringUntil = 0;
+};
+
+#endif
@@ -0,0 +1,146 @@
+#ifndef FAKE_ARDUINO_H
+#define FAKE_ARDUINO_H
+
+// Host stand-in for the ESP32 Arduino core, just enough for the headers
+// under test. Time is virtual: millis()/micros() only move when a test
+// calls fakeAdvanceMs() or delay(). RTC_DATA_ATTR variables are collected
+// in the "rtc_data" section, so the firmware simulator can carry them
+// (and the fake hardware state kept there) across simulated deep sleep.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <time.h>
+#include <string>
+#include <functional>
+
+#define RTC_DATA_ATTR __attribute__((section("rtc_data")))
+#define RTC_SLOW_ATTR RTC_DATA_ATTR
+#define ARDUINO_ISR_ATTR
+#define IRAM_ATTR
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define LOW 0
+#define HIGH 1
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+#define A1 37
+#define F(s) (s)
+
+typedef uint8_t byte;
+
+class IPAddress;
+
+class String {
+public:
+    String() {}
+    String(const char* s) : s(s ? s : "") {}
+    String(const std::string& s) : s(s) {}
+    String(int v) : s(std::to_string(v)) {}
+    String(unsigned v) : s(std::to_string(v)) {}
+    String(long v) : s(std::to_string(v)) {}
+    String(unsigned long v) : s(std::to_string(v)) {}
+
+    const char* c_str() const { return s.c_str(); }
+    size_t length() const { return s.size(); }
+    bool operator==(const String& o) const { return s == o.s; }
+    bool operator!=(const String& o) const { return s != o.s; }
+    String operator+(const String& o) const { return String(s + o.s); }
+    String& operator+=(const String& o) { s += o.s; return *this; }
+    String& operator+=(char c) { s += c; return *this; }
+    bool startsWith(const String& o) const { return s.rfind(o.s, 0) == 0; }
+    int indexOf(const char* o) const { size_t p = s.find(o); return p == std::string::npos ? -1 : (int)p; }
+    void reserve(size_t n) { s.reserve(n); }
+
+    std::string s;
+};
+
+inline String operator+(const char* a, const String& b) { return String(std::string(a) + b.s); }
+
+class Print {
+public:
+    virtual size_t write(uint8_t c) { return write(&c, 1); }
+    virtual size_t write(const uint8_t* buffer, size_t size) = 0;
+    virtual ~Print() {}
+
+    size_t print(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+    size_t print(const String& s) { return print(s.c_str()); }
+    size_t println(const char* s = "") { return print(s) + print("\n"); }
+    size_t println(const String& s) { return println(s.c_str()); }
+    size_t println(const IPAddress& ip);
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+    void flush() {}
+};
+
+/**
+ * Serial keeps everything written to it in output so tests can assert on
+ * log lines; set FAKE_SERIAL=1 in the environment to echo it to stdout.
+ */
+class HardwareSerial : public Print {
+public:
+    using Print::write;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    void begin(unsigned long) {}
+    bool contains(const char* text) const { return output.find(text) != std::string::npos; }
+
+    std::string output;
+};
+extern HardwareSerial Serial;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+uint16_t analogRead(uint8_t pin);
+void analogReadResolution(uint8_t bits);
+void attachInterrupt(uint8_t pin, std::function<void()> handler, int mode);
+void detachInterrupt(uint8_t pin);
+
+class IPAddress {
+public:
+    IPAddress() : addr(0) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+        : addr(a | (b << 8) | (c << 16) | ((uint32_t)d << 24)) {}
+    IPAddress(uint32_t a) : addr(a) {}
+    operator uint32_t() const { return addr; }
+    bool fromString(const char* text) {
+        unsigned a, b, c, d;
+        char tail;
+        if (sscanf(text, "%u.%u.%u.%u%c", &a, &b, &c, &d, &tail) != 4 || (a | b | c | d) > 255) return false;
+        *this = IPAddress(a, b, c, d);
+        return true;
+    }
+    String toString() const {
+        char text[16];
+        snprintf(text, sizeof(text), "%u.%u.%u.%u", addr & 0xFF, (addr >> 8) & 0xFF,
+                 (addr >> 16) & 0xFF, addr >> 24);
+        return String(text);
+    }
+
+    uint32_t addr;
+};
+
+inline size_t Print::println(const IPAddress& ip) { return println(ip.toString()); }
+
+// Test controls (fakes.cpp)
+void fakeAdvanceMs(unsigned long ms);   // moves millis(), micros() and time()
+void fakeReboot();                      // millis()/micros() restart at 0, as after deep sleep
+void fakeSetEpoch(time_t epoch);        // time() = epoch + seconds since the call, 0 = not synced
+uint64_t fakeWallUs();                  // virtual time since process start, runs across reboots
+extern int fakePinModeCalls[40];       // pinMode() calls per pin
+extern bool fakePinLow[40];            // digitalRead() level per pin, HIGH unless set
+extern uint16_t fakeAnalogLevel[40];   // analogRead() result per pin
+
+#endif
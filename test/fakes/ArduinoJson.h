@@ -0,0 +1,572 @@
+#ifndef FAKE_ARDUINOJSON_H
+#define FAKE_ARDUINOJSON_H
+
+// Host stand-in for the subset of ArduinoJson 7 the firmware uses: a
+// dynamic document tree, JSON serialization (written one character at a
+// time to a Print, like the real library) and a JSON parser, and the same
+// for MessagePack with the real library's encodings (smallest integer
+// form, floats as float32).
+
+#include "Arduino.h"
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace fakejson {
+
+struct Node {
+    enum Type { Null, Bool, Int, UInt, Float, Str, Object, Array };
+
+    Type type = Null;
+    bool boolean = false;
+    int64_t integer = 0;
+    uint64_t uinteger = 0;
+    double real = 0;
+    bool single = false;     // stored from a float, printed with float precision
+    std::string text;
+    std::vector<std::pair<std::string, std::unique_ptr<Node>>> members;
+    std::vector<std::unique_ptr<Node>> items;
+
+    void reset() {
+        type = Null;
+        text.clear();
+        members.clear();
+        items.clear();
+    }
+
+    Node* find(const std::string& key) const {
+        if (type != Object) return nullptr;
+        for (auto& member : members) {
+            if (member.first == key) return member.second.get();
+        }
+        return nullptr;
+    }
+
+    Node* member(const std::string& key) {
+        if (type == Null) type = Object;
+        if (type != Object) return nullptr;
+        Node* node = find(key);
+        if (node != nullptr) return node;
+        members.emplace_back(key, std::unique_ptr<Node>(new Node()));
+        return members.back().second.get();
+    }
+
+    Node* element(size_t index) const {
+        return (type == Array && index < items.size()) ? items[index].get() : nullptr;
+    }
+
+    Node* append() {
+        if (type == Null) type = Array;
+        if (type != Array) return nullptr;
+        items.emplace_back(new Node());
+        return items.back().get();
+    }
+
+    void copyFrom(const Node& other) {
+        if (&other == this) return;
+        reset();
+        type = other.type;
+        boolean = other.boolean;
+        integer = other.integer;
+        uinteger = other.uinteger;
+        real = other.real;
+        single = other.single;
+        text = other.text;
+        for (auto& m : other.members) {
+            members.emplace_back(m.first, std::unique_ptr<Node>(new Node()));
+            members.back().second->copyFrom(*m.second);
+        }
+        for (auto& item : other.items) {
+            items.emplace_back(new Node());
+            items.back()->copyFrom(*item);
+        }
+    }
+
+    double number() const {
+        switch (type) {
+            case Int: return (double)integer;
+            case UInt: return (double)uinteger;
+            case Float: return real;
+            case Bool: return boolean ? 1 : 0;
+            default: return 0;
+        }
+    }
+};
+
+void write(const Node* node, std::string& out);
+const char* parse(Node& node, const char* p, const char* end);
+void writeMsgPack(const Node* node, std::string& out);
+const char* parseMsgPack(Node& node, const char* p, const char* end);
+
+}  // namespace fakejson
+
+class JsonVariant;
+class JsonObject;
+class JsonArray;
+class JsonDocument;
+
+class JsonString {
+public:
+    JsonString(const char* s = nullptr) : s(s) {}
+    const char* c_str() const { return s; }
+    bool operator==(const char* o) const { return s && o && strcmp(s, o) == 0; }
+private:
+    const char* s;
+};
+
+/**
+ * Reference to a value inside a document. A variant for a missing member
+ * stays unbound until something is written through it, so reads never
+ * create members.
+ */
+class JsonVariant {
+public:
+    JsonVariant() : node(nullptr), index(0) {}
+    explicit JsonVariant(fakejson::Node* node) : node(node), index(0) {}
+    JsonVariant(const JsonVariant&) = default;
+
+    JsonVariant& operator=(const JsonVariant& other) { assign(other); return *this; }
+    template<class T> JsonVariant& operator=(const T& value) { assign(value); return *this; }
+    template<class T> bool set(const T& value) { return assign(value); }
+
+    JsonVariant operator[](const char* key) const { return child(key); }
+    JsonVariant operator[](const String& key) const { return child(key.s); }
+    JsonVariant operator[](JsonString key) const { return child(key.c_str()); }
+    JsonVariant operator[](int i) const { return element((size_t)i); }
+    JsonVariant operator[](size_t i) const { return element(i); }
+
+    bool isNull() const { const fakejson::Node* n = resolve(); return n == nullptr || n->type == fakejson::Node::Null; }
+    size_t size() const;
+
+    template<class T> T as() const;
+    template<class T> bool is() const;
+    template<class T> T to();
+    template<class T> T add();
+    template<class T> bool add(const T& value);
+
+    fakejson::Node* resolve() const;
+    fakejson::Node* materialize();
+
+private:
+    JsonVariant child(const std::string& k) const {
+        JsonVariant v;
+        v.parent = std::make_shared<JsonVariant>(*this);
+        v.key = k;
+        v.keyed = true;
+        return v;
+    }
+
+    JsonVariant element(size_t i) const {
+        JsonVariant v;
+        v.parent = std::make_shared<JsonVariant>(*this);
+        v.index = i;
+        return v;
+    }
+
+    template<class T> bool assign(const T& value);
+
+    fakejson::Node* node;
+    std::shared_ptr<JsonVariant> parent;
+    std::string key;
+    bool keyed = false;
+    size_t index;
+};
+
+typedef JsonVariant JsonVariantConst;
+
+class JsonPair {
+public:
+    JsonPair(const std::string* k, fakejson::Node* v) : k(k), v(v) {}
+    JsonString key() const { return JsonString(k->c_str()); }
+    JsonVariant value() const { return JsonVariant(v); }
+private:
+    const std::string* k;
+    fakejson::Node* v;
+};
+
+typedef JsonPair JsonPairConst;
+
+class JsonObject {
+public:
+    class iterator {
+    public:
+        typedef std::vector<std::pair<std::string, std::unique_ptr<fakejson::Node>>>::iterator It;
+        explicit iterator(It it) : it(it) {}
+        JsonPair operator*() const { return JsonPair(&it->first, it->second.get()); }
+        iterator& operator++() { ++it; return *this; }
+        bool operator!=(const iterator& o) const { return it != o.it; }
+    private:
+        It it;
+    };
+
+    JsonObject(fakejson::Node* node = nullptr) : node(node) {}
+
+    JsonVariant operator[](const char* key) const { return JsonVariant(node)[key]; }
+    JsonVariant operator[](const String& key) const { return JsonVariant(node)[key]; }
+    JsonVariant operator[](JsonString key) const { return JsonVariant(node)[key]; }
+
+    iterator begin() const { return iterator(members().begin()); }
+    iterator end() const { return iterator(members().end()); }
+    size_t size() const { return node ? node->members.size() : 0; }
+    bool isNull() const { return node == nullptr; }
+
+    fakejson::Node* node;
+
+private:
+    decltype(fakejson::Node::members)& members() const {
+        static decltype(fakejson::Node::members) none;
+        return node ? node->members : none;
+    }
+};
+
+typedef JsonObject JsonObjectConst;
+
+class JsonArray {
+public:
+    JsonArray(fakejson::Node* node = nullptr) : node(node) {}
+
+    template<class T> bool add(const T& value) { return JsonVariant(node).add(value); }
+    template<class T> T add() { return JsonVariant(node).add<T>(); }
+    JsonVariant operator[](size_t i) const { return JsonVariant(node)[i]; }
+    size_t size() const { return node ? node->items.size() : 0; }
+    bool isNull() const { return node == nullptr; }
+
+    fakejson::Node* node;
+};
+
+typedef JsonArray JsonArrayConst;
+
+class JsonDocument {
+public:
+    JsonDocument() : root(new fakejson::Node()) {}
+    JsonDocument(const JsonDocument& other) : root(new fakejson::Node()) { root->copyFrom(*other.root); }
+    JsonDocument& operator=(const JsonDocument& other) { root->copyFrom(*other.root); return *this; }
+    template<class T> JsonDocument& operator=(const T& value) { variant() = value; return *this; }
+
+    JsonVariant operator[](const char* key) const { return variant()[key]; }
+    JsonVariant operator[](const String& key) const { return variant()[key]; }
+    JsonVariant operator[](JsonString key) const { return variant()[key]; }
+    JsonVariant operator[](int i) const { return variant()[i]; }
+    JsonVariant operator[](size_t i) const { return variant()[i]; }
+
+    template<class T> T as() const { return variant().as<T>(); }
+    template<class T> bool is() const { return variant().is<T>(); }
+    template<class T> T to() { return variant().to<T>(); }
+    template<class T> T add() { return variant().add<T>(); }
+    template<class T> bool add(const T& value) { return variant().add(value); }
+    template<class T> bool set(const T& value) { return variant().set(value); }
+
+    void clear() { root->reset(); }
+    bool isNull() const { return root->type == fakejson::Node::Null; }
+    size_t size() const { return variant().size(); }
+    bool overflowed() const { return false; }
+
+    JsonVariant variant() const { return JsonVariant(root.get()); }
+    operator JsonVariant() const { return variant(); }
+
+private:
+    std::unique_ptr<fakejson::Node> root;
+};
+
+// JsonVariant
+
+inline fakejson::Node* JsonVariant::resolve() const {
+    if (node != nullptr) return node;
+    if (!parent) return nullptr;
+    fakejson::Node* up = parent->resolve();
+    if (up == nullptr) return nullptr;
+    return keyed ? up->find(key) : up->element(index);
+}
+
+inline fakejson::Node* JsonVariant::materialize() {
+    if (node != nullptr) return node;
+    if (!parent) return nullptr;
+    fakejson::Node* up = parent->materialize();
+    if (up == nullptr) return nullptr;
+    if (keyed) {
+        node = up->member(key);
+    } else {
+        while (up->type == fakejson::Node::Null || (up->type == fakejson::Node::Array && up->items.size() <= index)) {
+            if (up->append() == nullptr) break;
+        }
+        node = up->element(index);
+    }
+    return node;
+}
+
+inline size_t JsonVariant::size() const {
+    const fakejson::Node* n = resolve();
+    if (n == nullptr) return 0;
+    if (n->type == fakejson::Node::Object) return n->members.size();
+    if (n->type == fakejson::Node::Array) return n->items.size();
+    return 0;
+}
+
+namespace fakejson {
+
+template<class T, class Enable = void>
+struct Converter;
+
+template<class T>
+struct Converter<T, typename std::enable_if<std::is_same<T, bool>::value>::type> {
+    static void store(Node& n, T v) { n.reset(); n.type = Node::Bool; n.boolean = v; }
+    static T load(const Node* n) { return n && n->type == Node::Bool ? n->boolean : false; }
+    static bool check(const Node* n) { return n && n->type == Node::Bool; }
+};
+
+template<class T>
+struct Converter<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type> {
+    static void store(Node& n, T v) {
+        n.reset();
+        if (std::is_signed<T>::value && (int64_t)v < 0) { n.type = Node::Int; n.integer = (int64_t)v; }
+        else { n.type = Node::UInt; n.uinteger = (uint64_t)v; }
+    }
+    static T load(const Node* n) {
+        if (n == nullptr) return 0;
+        if (n->type == Node::Int) return (T)n->integer;
+        if (n->type == Node::UInt) return (T)n->uinteger;
+        if (n->type == Node::Float) return (T)n->real;
+        if (n->type == Node::Bool) return (T)n->boolean;
+        return 0;
+    }
+    static bool check(const Node* n) { return n && (n->type == Node::Int || n->type == Node::UInt); }
+};
+
+template<class T>
+struct Converter<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+    static void store(Node& n, T v) {
+        n.reset(); n.type = Node::Float; n.real = v; n.single = std::is_same<T, float>::value;
+    }
+    static T load(const Node* n) { return n ? (T)n->number() : 0; }
+    static bool check(const Node* n) {
+        return n && (n->type == Node::Int || n->type == Node::UInt || n->type == Node::Float);
+    }
+};
+
+inline void storeText(Node& n, const char* v) {
+    n.reset();
+    if (v == nullptr) return;
+    n.type = Node::Str;
+    n.text = v;
+}
+
+template<> struct Converter<const char*> {
+    static void store(Node& n, const char* v) { storeText(n, v); }
+    static const char* load(const Node* n) { return n && n->type == Node::Str ? n->text.c_str() : nullptr; }
+    static bool check(const Node* n) { return n && n->type == Node::Str; }
+};
+
+template<> struct Converter<char*> {
+    static void store(Node& n, const char* v) { storeText(n, v); }
+};
+
+template<> struct Converter<String> {
+    static void store(Node& n, const String& v) { storeText(n, v.c_str()); }
+    static String load(const Node* n) { return String(n && n->type == Node::Str ? n->text.c_str() : ""); }
+    static bool check(const Node* n) { return n && n->type == Node::Str; }
+};
+
+template<> struct Converter<JsonString> {
+    static void store(Node& n, JsonString v) { storeText(n, v.c_str()); }
+    static JsonString load(const Node* n) { return JsonString(n && n->type == Node::Str ? n->text.c_str() : nullptr); }
+    static bool check(const Node* n) { return n && n->type == Node::Str; }
+};
+
+template<> struct Converter<std::nullptr_t> {
+    static void store(Node& n, std::nullptr_t) { n.reset(); }
+};
+
+template<> struct Converter<JsonVariant> {
+    static void store(Node& n, const JsonVariant& v) {
+        const Node* src = v.resolve();
+        if (src == nullptr) n.reset(); else n.copyFrom(*src);
+    }
+    static JsonVariant load(Node* n) { return JsonVariant(n); }
+    static bool check(const Node*) { return true; }
+};
+
+template<> struct Converter<JsonObject> {
+    static void store(Node& n, const JsonObject& v) { if (v.node) n.copyFrom(*v.node); else n.reset(); }
+    static JsonObject load(Node* n) { return JsonObject(n && n->type == Node::Object ? n : nullptr); }
+    static bool check(const Node* n) { return n && n->type == Node::Object; }
+};
+
+template<> struct Converter<JsonArray> {
+    static void store(Node& n, const JsonArray& v) { if (v.node) n.copyFrom(*v.node); else n.reset(); }
+    static JsonArray load(Node* n) { return JsonArray(n && n->type == Node::Array ? n : nullptr); }
+    static bool check(const Node* n) { return n && n->type == Node::Array; }
+};
+
+template<> struct Converter<JsonDocument> {
+    static void store(Node& n, const JsonDocument& v) { Converter<JsonVariant>::store(n, v.variant()); }
+};
+
+}  // namespace fakejson
+
+template<class T> bool JsonVariant::assign(const T& value) {
+    fakejson::Node* n = materialize();
+    if (n == nullptr) return false;
+    fakejson::Converter<typename std::decay<T>::type>::store(*n, value);
+    return true;
+}
+
+template<class T> T JsonVariant::as() const {
+    return fakejson::Converter<T>::load(resolve());
+}
+
+template<class T> bool JsonVariant::is() const {
+    return fakejson::Converter<T>::check(resolve());
+}
+
+template<class T> T JsonVariant::to() {
+    fakejson::Node* n = materialize();
+    if (n == nullptr) return T();
+    n->reset();
+    n->type = std::is_same<T, JsonArray>::value ? fakejson::Node::Array : fakejson::Node::Object;
+    return T(n);
+}
+
+template<class T> T JsonVariant::add() {
+    fakejson::Node* n = materialize();
+    fakejson::Node* item = n ? n->append() : nullptr;
+    if (item == nullptr) return T();
+    item->type = std::is_same<T, JsonArray>::value ? fakejson::Node::Array : fakejson::Node::Object;
+    return T(item);
+}
+
+template<class T> bool JsonVariant::add(const T& value) {
+    fakejson::Node* n = materialize();
+    fakejson::Node* item = n ? n->append() : nullptr;
+    if (item == nullptr) return false;
+    fakejson::Converter<typename std::decay<T>::type>::store(*item, value);
+    return true;
+}
+
+// Serialization
+
+class DeserializationError {
+public:
+    enum Code { Ok, EmptyInput, IncompleteInput, InvalidInput, NoMemory, TooDeep, NotSupported };
+
+    DeserializationError(Code code = Ok) : code_(code) {}
+    explicit operator bool() const { return code_ != Ok; }
+    bool operator==(Code code) const { return code_ == code; }
+    bool operator!=(Code code) const { return code_ != code; }
+    Code code() const { return code_; }
+    const char* c_str() const {
+        static const char* names[] = {"Ok", "EmptyInput", "IncompleteInput", "InvalidInput",
+                                      "NoMemory", "TooDeep", "NotSupported"};
+        return names[code_];
+    }
+
+private:
+    Code code_;
+};
+
+namespace fakejson {
+inline std::string text(const JsonVariant& v) {
+    std::string out;
+    write(v.resolve(), out);
+    return out;
+}
+inline std::string text(const JsonDocument& doc) { return text(doc.variant()); }
+inline std::string text(const JsonObject& obj) { return text(JsonVariant(obj.node)); }
+inline std::string text(const JsonArray& arr) { return text(JsonVariant(arr.node)); }
+
+inline std::string msgpack(const JsonVariant& v) {
+    std::string out;
+    writeMsgPack(v.resolve(), out);
+    return out;
+}
+inline std::string msgpack(const JsonDocument& doc) { return msgpack(doc.variant()); }
+inline std::string msgpack(const JsonObject& obj) { return msgpack(JsonVariant(obj.node)); }
+inline std::string msgpack(const JsonArray& arr) { return msgpack(JsonVariant(arr.node)); }
+}  // namespace fakejson
+
+template<class T> size_t measureJson(const T& src) { return fakejson::text(src).size(); }
+
+template<class T> size_t serializeJson(const T& src, char* buffer, size_t size) {
+    std::string out = fakejson::text(src);
+    if (size == 0) return 0;
+    size_t n = out.size() < size - 1 ? out.size() : size - 1;
+    memcpy(buffer, out.data(), n);
+    buffer[n] = '\0';
+    return n;
+}
+
+template<class T> size_t serializeJson(const T& src, void* buffer, size_t size) {
+    return serializeJson(src, (char*)buffer, size);
+}
+
+template<class T> size_t serializeJson(const T& src, Print& out) {
+    std::string text = fakejson::text(src);
+    size_t n = 0;
+    for (char c : text) n += out.write((uint8_t)c);
+    return n;
+}
+
+template<class T> size_t serializeJson(const T& src, String& out) {
+    out = String(fakejson::text(src));
+    return out.length();
+}
+
+inline DeserializationError deserializeJson(JsonDocument& doc, const char* input, size_t length) {
+    doc.clear();
+    if (input == nullptr || length == 0) return DeserializationError::EmptyInput;
+    const char* end = input + length;
+    const char* p = fakejson::parse(*doc.variant().resolve(), input, end);
+    if (p == nullptr) {
+        doc.clear();
+        return DeserializationError::InvalidInput;
+    }
+    return DeserializationError::Ok;
+}
+
+inline DeserializationError deserializeJson(JsonDocument& doc, const uint8_t* input, size_t length) {
+    return deserializeJson(doc, (const char*)input, length);
+}
+
+inline DeserializationError deserializeJson(JsonDocument& doc, const char* input) {
+    return deserializeJson(doc, input, input ? strlen(input) : 0);
+}
+
+inline DeserializationError deserializeJson(JsonDocument& doc, const String& input) {
+    return deserializeJson(doc, input.c_str(), input.length());
+}
+
+template<class T> size_t measureMsgPack(const T& src) { return fakejson::msgpack(src).size(); }
+
+template<class T> size_t serializeMsgPack(const T& src, char* buffer, size_t size) {
+    std::string out = fakejson::msgpack(src);
+    size_t n = out.size() < size ? out.size() : size;
+    memcpy(buffer, out.data(), n);
+    return n;
+}
+
+template<class T> size_t serializeMsgPack(const T& src, void* buffer, size_t size) {
+    return serializeMsgPack(src, (char*)buffer, size);
+}
+
+template<class T> size_t serializeMsgPack(const T& src, Print& out) {
+    std::string bytes = fakejson::msgpack(src);
+    size_t n = 0;
+    for (char c : bytes) n += out.write((uint8_t)c);
+    return n;
+}
+
+inline DeserializationError deserializeMsgPack(JsonDocument& doc, const char* input, size_t length) {
+    doc.clear();
+    if (input == nullptr || length == 0) return DeserializationError::EmptyInput;
+    if (fakejson::parseMsgPack(*doc.variant().resolve(), input, input + length) == nullptr) {
+        doc.clear();
+        return DeserializationError::InvalidInput;
+    }
+    return DeserializationError::Ok;
+}
+
+inline DeserializationError deserializeMsgPack(JsonDocument& doc, const uint8_t* input, size_t length) {
+    return deserializeMsgPack(doc, (const char*)input, length);
+}
+
+#endif
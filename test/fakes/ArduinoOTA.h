@@ -0,0 +1,25 @@
+#ifndef FAKE_ARDUINOOTA_H
+#define FAKE_ARDUINOOTA_H
+
+#include "Arduino.h"
+
+#define U_FLASH 0
+
+typedef enum { OTA_AUTH_ERROR, OTA_BEGIN_ERROR, OTA_CONNECT_ERROR, OTA_RECEIVE_ERROR, OTA_END_ERROR } ota_error_t;
+
+class ArduinoOTAClass {
+public:
+    void setPort(uint16_t) {}
+    void setHostname(const char*) {}
+    void setPassword(const char*) {}
+    ArduinoOTAClass& onStart(std::function<void()>) { return *this; }
+    ArduinoOTAClass& onEnd(std::function<void()>) { return *this; }
+    ArduinoOTAClass& onProgress(std::function<void(unsigned int, unsigned int)>) { return *this; }
+    ArduinoOTAClass& onError(std::function<void(ota_error_t)>) { return *this; }
+    int getCommand() { return U_FLASH; }
+    void begin() {}
+    void handle() {}
+};
+extern ArduinoOTAClass ArduinoOTA;
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef FAKE_FUNCTIONALINTERRUPT_H
+#define FAKE_FUNCTIONALINTERRUPT_H
+
+#include "Arduino.h"
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef FAKE_LITTLEFS_H
+#define FAKE_LITTLEFS_H
+
+// Host stand-in for LittleFS: files live in memory (fakeFs.files) so
+// tests can inspect, tear or corrupt them, and mounting can be made to
+// fail with fakeFs.mountFails.
+//
+// Like LittleFS, writes through a handle are only committed to the file
+// by flush() or close(); other handles and fakeFs.files see the file as
+// of the last commit. Flash wear follows LittleFS's copy-on-write files:
+// the first write of a handle to a file whose last block is partly used
+// copies that block into a newly erased one, every further block costs an
+// erase, and each commit, remove and rename is a metadata commit.
+
+#include "Arduino.h"
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+struct FakeFs {
+    std::map<std::string, std::vector<uint8_t>> files;
+    std::set<std::string> dirs;
+    bool mountFails = false;
+    int mounts = 0;
+    long blockErases = 0;
+    long commits = 0;
+};
+
+#define FAKE_FS_BLOCK_BYTES 4096
+extern FakeFs fakeFs;
+
+class File {
+public:
+    File() {}
+    File(const std::string& path, bool dir) : path(path), ok(true), dir(dir) {
+        if (dir) listing = fakeFs.files.lower_bound(path + "/");
+    }
+
+    explicit operator bool() const { return ok; }
+    size_t size() const { return ok && !dir ? data().size() : 0; }
+    bool seek(size_t to) {
+        if (!ok || to > size()) return false;
+        pos = to;
+        return true;
+    }
+    size_t read(uint8_t* buffer, size_t n) {
+        size_t k = 0;
+        if (!ok || dir) return 0;
+        const std::vector<uint8_t>& v = data();
+        while (k < n && pos < v.size()) buffer[k++] = v[pos++];
+        return k;
+    }
+    size_t write(const uint8_t* buffer, size_t n) {
+        if (!ok || dir) return 0;
+        if (!pending) {
+            pending = std::make_shared<std::vector<uint8_t>>();
+            end = data().size();
+            if (end % FAKE_FS_BLOCK_BYTES != 0) fakeFs.blockErases++;
+        }
+        for (size_t i = 0; i < n; i++, end++) {
+            if (end % FAKE_FS_BLOCK_BYTES == 0) fakeFs.blockErases++;
+        }
+        pending->insert(pending->end(), buffer, buffer + n);
+        return n;
+    }
+    void flush() {
+        if (!pending) return;
+        auto it = fakeFs.files.find(path);
+        if (it != fakeFs.files.end()) it->second.insert(it->second.end(), pending->begin(), pending->end());
+        fakeFs.commits++;
+        pending.reset();
+    }
+    void close() {
+        flush();
+        ok = false;
+    }
+    const char* name() const { return path.c_str(); }
+    bool isDirectory() const { return dir; }
+
+    File openNextFile() {
+        std::string prefix = path + "/";
+        if (!dir || listing == fakeFs.files.end() || listing->first.compare(0, prefix.size(), prefix) != 0) {
+            return File();
+        }
+        File f(listing->first, false);
+        ++listing;
+        return f;
+    }
+
+private:
+    const std::vector<uint8_t>& data() const { return fakeFs.files[path]; }
+
+    std::string path;
+    bool ok = false;
+    bool dir = false;
+    size_t pos = 0;
+    std::shared_ptr<std::vector<uint8_t>> pending;   // uncommitted writes, shared by copies
+    size_t end = 0;                                  // file size including pending writes
+    std::map<std::string, std::vector<uint8_t>>::iterator listing;
+};
+
+class LittleFSFS {
+public:
+    bool begin(bool = false) {
+        fakeFs.mounts++;
+        return !fakeFs.mountFails;
+    }
+    bool exists(const char* path) { return fakeFs.files.count(path) || fakeFs.dirs.count(path); }
+    bool mkdir(const char* path) { fakeFs.dirs.insert(path); return true; }
+    bool remove(const char* path) {
+        fakeFs.commits++;
+        return fakeFs.files.erase(path) > 0;
+    }
+    bool rename(const char* from, const char* to) {
+        auto it = fakeFs.files.find(from);
+        if (it == fakeFs.files.end()) return false;
+        fakeFs.files[to] = it->second;
+        fakeFs.files.erase(from);
+        fakeFs.commits++;
+        return true;
+    }
+    File open(const char* path, const char* mode = "r") {
+        std::string m(mode);
+        if (m == "r") {
+            if (fakeFs.dirs.count(path)) return File(path, true);
+            if (!fakeFs.files.count(path)) return File();
+        } else if (m == "w") {
+            fakeFs.files[path].clear();
+        } else {
+            fakeFs.files[path];
+        }
+        return File(path, false);
+    }
+};
+extern LittleFSFS LittleFS;
+
+#endif
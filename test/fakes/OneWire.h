@@ -0,0 +1,73 @@
+#ifndef FAKE_ONEWIRE_H
+#define FAKE_ONEWIRE_H
+
+// Host model of a OneWire bus with DS18B20 probes on it. The probes keep
+// their scratchpad, EEPROM and running conversion in RTC_DATA_ATTR
+// (fakeOneWire), because they stay powered while the ESP32 deep sleeps.
+// Modelled commands: Search ROM, Skip ROM (0xCC), Match ROM (0x55),
+// Convert T (0x44), Read Scratchpad (0xBE), Write Scratchpad (0x4E),
+// Copy Scratchpad (0x48) and Read Power Supply (0xB4). A conversion takes
+// 94/188/375/750 ms for the 9-12 bit config and only then updates the
+// temperature bytes; a probe still converting reads 0 on read slots.
+
+#include "Arduino.h"
+
+#define FAKE_ONEWIRE_MAX_PROBES 4
+
+struct FakeDs18b20 {
+    uint8_t rom[8];
+    uint8_t scratchpad[9];      // temp LSB/MSB, TH, TL, config, FF, 0C, 10, CRC
+    uint8_t eeprom[3];          // TH, TL, config
+    float tempC;                // what the next conversion measures
+    bool converting;
+    uint64_t convertDoneUs;     // fakeWallUs() when the running conversion ends
+};
+
+struct FakeOneWireBus {
+    FakeDs18b20 probes[FAKE_ONEWIRE_MAX_PROBES];
+    uint8_t count;
+    bool parasite;              // probes draw power from the data line
+    int conversions;            // Convert T commands
+    int eepromWrites;           // Copy Scratchpad commands
+};
+extern FakeOneWireBus fakeOneWire;
+
+/**
+ * Puts a probe on the bus in its power-on state (12 bit, TH 0x4B, TL 0x46)
+ * @param serial Distinguishes the ROM codes of several probes
+ * @return Index of the probe
+ */
+int fakeOneWireAddProbe(uint8_t serial, float tempC);
+
+/**
+ * Cuts and restores the probes' supply: scratchpads reload from EEPROM
+ */
+void fakeOneWirePowerCycle();
+
+class OneWire {
+public:
+    OneWire(uint8_t) {}
+
+    uint8_t reset();
+    void select(const uint8_t rom[8]);
+    void skip();
+    void write(uint8_t v, uint8_t power = 0);
+    uint8_t read();
+    uint8_t read_bit();
+    void depower() {}
+    void reset_search() { searchNext = 0; }
+    uint8_t search(uint8_t* newAddr, bool searchMode = true);
+    static uint8_t crc8(const uint8_t* addr, uint8_t len);
+
+private:
+    enum State { IDLE, ROM_MATCH, FUNCTION, WRITE_SCRATCH, READ_SCRATCH, READ_POWER };
+    void command(uint8_t v);
+
+    State state = IDLE;
+    int selected = -1;          // probe index, -1 = all (Skip ROM)
+    uint8_t matchRom[8];
+    uint8_t index = 0;
+    uint8_t searchNext = 0;
+};
+
+#endif
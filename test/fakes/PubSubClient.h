@@ -0,0 +1,108 @@
+#ifndef FAKE_PUBSUBCLIENT_H
+#define FAKE_PUBSUBCLIENT_H
+
+// Host stand-in for PubSubClient that records every PUBLISH instead of
+// sending it. failAfter limits how many publishes succeed, to test what
+// stays queued when the connection drops partway. publish() rejects
+// packets larger than the buffer, like the real client. connect() takes
+// connectMs of virtual time and fails while reachable() says no.
+
+#include "Arduino.h"
+#include "WiFi.h"
+#include <vector>
+
+#ifndef MQTT_SOCKET_TIMEOUT
+#define MQTT_SOCKET_TIMEOUT 15
+#endif
+
+#define MQTT_MAX_HEADER_SIZE 5
+
+#define MQTT_CONNECTION_LOST -3
+#define MQTT_CONNECTED 0
+
+class PubSubClient : public Print {
+public:
+    struct Publish {
+        std::string topic;
+        std::string payload;
+        size_t writes;          // write() calls that carried the payload
+    };
+
+    PubSubClient() {}
+    PubSubClient(Client&) {}
+
+    PubSubClient& setServer(const char*, uint16_t) { return *this; }
+    PubSubClient& setKeepAlive(uint16_t) { return *this; }
+    PubSubClient& setSocketTimeout(uint16_t) { return *this; }
+    bool setBufferSize(uint16_t size) { bufferSize = size; return true; }
+    uint16_t getBufferSize() { return bufferSize; }
+
+    bool connect(const char*) { return connectOk(); }
+    bool connect(const char*, const char*, const char*) { return connectOk(); }
+    bool connect(const char*, const char*, const char*, const char*, uint8_t, bool, const char*, bool) { return connectOk(); }
+    bool connected() { return isConnected; }
+    int state() { return isConnected ? MQTT_CONNECTED : MQTT_CONNECTION_LOST; }
+    void disconnect() { isConnected = false; }
+
+    bool publish(const char* topic, const char* payload) {
+        return publish(topic, (const uint8_t*)payload, strlen(payload));
+    }
+    bool publish(const char* topic, const uint8_t* payload, unsigned int length) {
+        if (bufferSize < MQTT_MAX_HEADER_SIZE + 2 + strlen(topic) + length) return false;   // as upstream
+        if (!admit()) return false;
+        published.push_back({topic, std::string((const char*)payload, length), 1});
+        return true;
+    }
+
+    bool beginPublish(const char* topic, unsigned int length, bool) {
+        if (!admit()) return false;
+        open = Publish{topic, std::string(), 0};
+        openLength = length;
+        streaming = true;
+        return true;
+    }
+    using Print::write;
+    size_t write(const uint8_t* buffer, size_t size) override {
+        if (!streaming) return 0;
+        open.payload.append((const char*)buffer, size);
+        open.writes++;
+        return size;
+    }
+    int endPublish() {
+        if (!streaming) return 0;
+        streaming = false;
+        if (open.payload.size() != openLength) return 0;
+        published.push_back(open);
+        return 1;
+    }
+
+    bool loop() { loops++; return isConnected; }
+
+    bool isConnected = true;
+    std::function<bool()> reachable;    // broker answers CONNECT, unset = always
+    unsigned long connectMs = 0;
+    int connects = 0;                   // CONNECT attempts
+    int failAfter = -1;                 // publishes that succeed before the link drops, -1 = all
+    uint16_t bufferSize = 256;
+    size_t loops = 0;
+    std::vector<Publish> published;
+
+private:
+    bool connectOk() {
+        connects++;
+        delay(connectMs);
+        return isConnected = !reachable || reachable();
+    }
+    bool admit() {
+        if (!isConnected) return false;
+        if (failAfter == 0) { isConnected = false; return false; }
+        if (failAfter > 0) failAfter--;
+        return true;
+    }
+
+    Publish open;
+    size_t openLength = 0;
+    bool streaming = false;
+};
+
+#endif
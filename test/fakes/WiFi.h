@@ -0,0 +1,169 @@
+#ifndef FAKE_WIFI_H
+#define FAKE_WIFI_H
+
+#include "Arduino.h"
+
+/**
+ * Socket stand-in: keeps everything written in sent and answers an MQTT
+ * PINGREQ with a PINGRESP after rttMs, like a broker on the other end.
+ */
+class Client : public Print {
+public:
+    using Print::write;
+    size_t write(const uint8_t* buffer, size_t size) override {
+        if (!linkUp) return 0;
+        sent.append((const char*)buffer, size);
+        if (size == 2 && buffer[0] == 0xC0 && buffer[1] == 0x00 && answerPings) {
+            pingAnswerAtMs = millis() + rttMs;
+            pingPending = true;
+        }
+        return size;
+    }
+    int available() {
+        if (pingPending && millis() >= pingAnswerAtMs) {
+            inbound += std::string("\xD0\x00", 2);
+            pingPending = false;
+        }
+        return (int)inbound.size();
+    }
+    int read() {
+        uint8_t b;
+        return available() > 0 && read(&b, 1) == 1 ? b : -1;
+    }
+    int read(uint8_t* buffer, size_t size) {
+        size_t n = size < inbound.size() ? size : inbound.size();
+        memcpy(buffer, inbound.data(), n);
+        inbound.erase(0, n);
+        return (int)n;
+    }
+    uint8_t connected() { return linkUp; }
+
+    std::string sent;
+    std::string inbound;
+    bool linkUp = true;
+    bool answerPings = true;
+    unsigned long rttMs = 20;
+
+private:
+    bool pingPending = false;
+    unsigned long pingAnswerAtMs = 0;
+};
+
+class WiFiClient : public Client {
+public:
+    int setNoDelay(bool) { return 0; }
+};
+
+typedef enum { WL_IDLE_STATUS = 0, WL_CONNECTED = 3, WL_DISCONNECTED = 6 } wl_status_t;
+typedef enum { WIFI_OFF, WIFI_STA } wifi_mode_t;
+
+typedef enum {
+    ARDUINO_EVENT_WIFI_STA_DISCONNECTED = 5,
+    ARDUINO_EVENT_WIFI_STA_GOT_IP = 7,
+} arduino_event_id_t;
+typedef struct { uint8_t reason; } wifi_event_sta_disconnected_t;
+typedef union { wifi_event_sta_disconnected_t wifi_sta_disconnected; } arduino_event_info_t;
+typedef void (*WiFiEventSysCb)(arduino_event_id_t event, arduino_event_info_t info);
+
+enum {
+    WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT = 15,
+    WIFI_REASON_NO_AP_FOUND = 201,
+    WIFI_REASON_AUTH_FAIL = 202,
+    WIFI_REASON_HANDSHAKE_TIMEOUT = 204,
+};
+
+/**
+ * Station interface stand-in with one access point on the other end.
+ * begin() schedules GOT_IP (or NO_AP_FOUND while apUp is false) after
+ * the association time of the path taken: fastMs with BSSID and channel,
+ * scanMs without, plus dhcpMs unless config() set an address. Events are
+ * delivered from the event group wait (freertos/event_groups.h), which
+ * moves the virtual clock up to them.
+ */
+class WiFiClass {
+public:
+    int onEvent(WiFiEventSysCb cb, arduino_event_id_t event) {
+        if (handlerCount < 4) handlers[handlerCount++] = {cb, event};
+        return handlerCount;
+    }
+    bool mode(wifi_mode_t m) { if (m == WIFI_OFF) connected = false; return true; }
+    bool setSleep(bool) { return true; }
+    bool persistent(bool) { return true; }
+    bool config(IPAddress ip, IPAddress gw, IPAddress sn, IPAddress dns = IPAddress()) {
+        staticIp = ip;
+        gateway = gw;
+        subnet = sn;
+        dnsServer = dns;
+        return true;
+    }
+    wl_status_t begin(const char*, const char* = nullptr, int32_t ch = 0, const uint8_t* ap = nullptr, bool = true) {
+        begins++;
+        connected = false;
+        unsigned long ms = (ap != nullptr && ch > 0) ? fastMs : scanMs;
+        if (!apUp) {
+            pending = ARDUINO_EVENT_WIFI_STA_DISCONNECTED;
+        } else {
+            pending = ARDUINO_EVENT_WIFI_STA_GOT_IP;
+            if ((uint32_t)staticIp == 0) ms += dhcpMs;
+        }
+        pendingAtMs = millis() + ms;
+        eventPending = true;
+        return WL_DISCONNECTED;
+    }
+    bool isConnected() { return connected; }
+    wl_status_t status() { return connected ? WL_CONNECTED : WL_DISCONNECTED; }
+    bool disconnect(bool = false, bool = false) {
+        connected = false;
+        eventPending = false;
+        return true;
+    }
+    IPAddress localIP() { return connected ? ((uint32_t)staticIp ? staticIp : IPAddress(192, 168, 1, 50)) : IPAddress(); }
+    IPAddress gatewayIP() { return IPAddress(192, 168, 1, 1); }
+    IPAddress subnetMask() { return IPAddress(255, 255, 255, 0); }
+    IPAddress dnsIP(uint8_t = 0) { return IPAddress(192, 168, 1, 1); }
+    uint8_t* BSSID() { return connected ? bssid : nullptr; }
+    int32_t channel() { return 6; }
+    int8_t RSSI() { return -60; }
+    uint8_t* macAddress(uint8_t* mac) {
+        static const uint8_t own[6] = {0x24, 0x0A, 0xC4, 0x12, 0x34, 0x56};
+        memcpy(mac, own, 6);
+        return mac;
+    }
+
+    /**
+     * Delivers the pending event if it is due by untilMs, moving the clock to it
+     * @return true if an event handler ran
+     */
+    bool fakeDeliver(unsigned long untilMs) {
+        if (!eventPending || (long)(pendingAtMs - untilMs) > 0) return false;
+        if ((long)(pendingAtMs - millis()) > 0) fakeAdvanceMs(pendingAtMs - millis());
+        eventPending = false;
+        arduino_event_info_t info = {};
+        if (pending == ARDUINO_EVENT_WIFI_STA_GOT_IP) connected = true;
+        else info.wifi_sta_disconnected.reason = WIFI_REASON_NO_AP_FOUND;
+        for (int i = 0; i < handlerCount; i++) {
+            if (handlers[i].event == pending) handlers[i].cb(pending, info);
+        }
+        return true;
+    }
+
+    bool apUp = true;               // access point reachable
+    unsigned long fastMs = 150;     // association on a known BSSID and channel
+    unsigned long scanMs = 1200;    // association after an all-channel scan
+    unsigned long dhcpMs = 600;
+    int begins = 0;
+
+private:
+    struct Handler { WiFiEventSysCb cb; arduino_event_id_t event; };
+    Handler handlers[4];
+    int handlerCount = 0;
+    bool connected = false;
+    bool eventPending = false;
+    arduino_event_id_t pending = ARDUINO_EVENT_WIFI_STA_GOT_IP;
+    unsigned long pendingAtMs = 0;
+    IPAddress staticIp, gateway, subnet, dnsServer;
+    uint8_t bssid[6] = {0x60, 0x38, 0xE0, 0xAA, 0xBB, 0xCC};
+};
+extern WiFiClass WiFi;
+
+#endif
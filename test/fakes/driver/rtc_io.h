@@ -0,0 +1,25 @@
+#ifndef FAKE_RTC_IO_H
+#define FAKE_RTC_IO_H
+
+#include "esp_sleep.h"
+
+typedef enum { RTC_GPIO_MODE_INPUT_ONLY } rtc_gpio_mode_t;
+
+int rtc_io_number_get(gpio_num_t gpio_num);
+esp_err_t rtc_gpio_init(gpio_num_t gpio_num);
+esp_err_t rtc_gpio_set_direction(gpio_num_t gpio_num, rtc_gpio_mode_t mode);
+esp_err_t rtc_gpio_pullup_en(gpio_num_t gpio_num);
+esp_err_t rtc_gpio_pulldown_dis(gpio_num_t gpio_num);
+esp_err_t rtc_gpio_hold_en(gpio_num_t gpio_num);
+esp_err_t rtc_gpio_hold_dis(gpio_num_t gpio_num);
+
+// Test control (ulp.cpp)
+struct FakeRtcGpio {
+    int inits = 0;          // rtc_gpio_init() calls
+    bool pullup = false;
+    bool held = false;
+    bool configuredWhileHeld = false;
+};
+extern FakeRtcGpio fakeRtcGpio;
+
+#endif
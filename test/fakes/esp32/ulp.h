@@ -0,0 +1,76 @@
+#ifndef FAKE_ULP_H
+#define FAKE_ULP_H
+
+// Host model of the ULP FSM coprocessor: the instruction macros build a
+// small program that is interpreted once per wakeup period of the virtual
+// clock (whenever fakeAdvanceMs() or delay() move it), against
+// RTC_SLOW_MEM and the rain pin level.
+// Only the instructions used by UlpRainCounter are modelled. As on the
+// chip, ALU instructions set the zero flag that M_BXZ tests; loads,
+// stores and register reads leave it alone.
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_sleep.h"
+#include "soc/rtc_io_reg.h"
+
+enum { R0, R1, R2, R3 };
+
+enum FakeUlpOp {
+    ULP_OP_MOVI, ULP_OP_MOVR, ULP_OP_ADDI, ULP_OP_SUBI, ULP_OP_ANDI, ULP_OP_SUBR,
+    ULP_OP_LD, ULP_OP_ST, ULP_OP_RD_REG,
+    ULP_OP_LABEL, ULP_OP_BX, ULP_OP_BXZ, ULP_OP_WAKE, ULP_OP_HALT
+};
+
+typedef struct {
+    FakeUlpOp op;
+    uint32_t a, b, c, d;
+} ulp_insn_t;
+
+#define I_MOVI(rd, imm)             { ULP_OP_MOVI, (rd), 0, (uint32_t)(imm), 0 }
+#define I_MOVR(rd, rs)              { ULP_OP_MOVR, (rd), (rs), 0, 0 }
+#define I_ADDI(rd, rs, imm)         { ULP_OP_ADDI, (rd), (rs), (uint32_t)(imm), 0 }
+#define I_SUBI(rd, rs, imm)         { ULP_OP_SUBI, (rd), (rs), (uint32_t)(imm), 0 }
+#define I_ANDI(rd, rs, imm)         { ULP_OP_ANDI, (rd), (rs), (uint32_t)(imm), 0 }
+#define I_SUBR(rd, rs1, rs2)        { ULP_OP_SUBR, (rd), (rs1), (rs2), 0 }
+#define I_LD(rd, rs, offset)        { ULP_OP_LD, (rd), (rs), (uint32_t)(offset), 0 }
+#define I_ST(rs, rbase, offset)     { ULP_OP_ST, (rs), (rbase), (uint32_t)(offset), 0 }
+#define I_RD_REG(reg, low, high)    { ULP_OP_RD_REG, (uint32_t)(reg), (uint32_t)(low), (uint32_t)(high), 0 }
+#define M_LABEL(label)              { ULP_OP_LABEL, (uint32_t)(label), 0, 0, 0 }
+#define M_BX(label)                 { ULP_OP_BX, (uint32_t)(label), 0, 0, 0 }
+#define M_BXZ(label)                { ULP_OP_BXZ, (uint32_t)(label), 0, 0, 0 }
+#define I_WAKE()                    { ULP_OP_WAKE, 0, 0, 0, 0 }
+#define I_HALT()                    { ULP_OP_HALT, 0, 0, 0, 0 }
+
+esp_err_t ulp_process_macros_and_load(uint32_t load_addr, const ulp_insn_t* program, size_t* psize);
+esp_err_t ulp_run(uint32_t entry_point);
+esp_err_t ulp_set_wakeup_period(size_t period_index, uint32_t period_us);
+
+extern uint32_t fakeRtcSlowMem[2048];
+#define RTC_SLOW_MEM fakeRtcSlowMem
+
+// Test control (ulp.cpp)
+struct FakeUlp {
+    int loads = 0;              // ulp_process_macros_and_load() calls
+    bool running = false;
+    uint32_t periodUs = 0;
+    int pinLevel = 1;           // rain pin as read through RTC_GPIO_IN_REG
+    int wakes = 0;              // I_WAKE executed
+    unsigned long runs = 0;     // program runs
+};
+extern FakeUlp fakeUlp;
+
+extern int (*fakeUlpPin)(uint64_t wallUs);   // rain pin level at a given fakeWallUs(), overrides pinLevel
+
+/**
+ * Runs the loaded program once per wakeup period for the given time,
+ * advancing the virtual clock with it
+ */
+void fakeUlpRunFor(unsigned long ms);
+
+/**
+ * Runs every period that elapsed up to fakeWallUs(), called by the clock
+ */
+void fakeUlpCatchUp();
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef FAKE_ESP_BT_H
+#define FAKE_ESP_BT_H
+
+void btStop();
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef FAKE_ESP_RTC_TIME_H
+#define FAKE_ESP_RTC_TIME_H
+
+#include <stdint.h>
+
+uint64_t esp_rtc_get_time_us();   // keeps running across fake reboots (deep sleep)
+
+#endif
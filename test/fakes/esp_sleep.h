@@ -0,0 +1,38 @@
+#ifndef FAKE_ESP_SLEEP_H
+#define FAKE_ESP_SLEEP_H
+
+#include <stdint.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_ERR_INVALID_ARG 0x102
+
+typedef enum {
+    ESP_SLEEP_WAKEUP_UNDEFINED,
+    ESP_SLEEP_WAKEUP_ALL,
+    ESP_SLEEP_WAKEUP_EXT0,
+    ESP_SLEEP_WAKEUP_EXT1,
+    ESP_SLEEP_WAKEUP_TIMER,
+    ESP_SLEEP_WAKEUP_TOUCHPAD,
+    ESP_SLEEP_WAKEUP_ULP,
+} esp_sleep_wakeup_cause_t;
+
+typedef enum { GPIO_NUM_27 = 27 } gpio_num_t;
+
+typedef enum { ESP_PD_DOMAIN_RTC_PERIPH } esp_sleep_pd_domain_t;
+typedef enum { ESP_PD_OPTION_OFF, ESP_PD_OPTION_ON, ESP_PD_OPTION_AUTO } esp_sleep_pd_option_t;
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause();
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us);
+esp_err_t esp_sleep_enable_ext0_wakeup(gpio_num_t gpio_num, int level);
+esp_err_t esp_sleep_enable_ulp_wakeup();
+esp_err_t esp_sleep_pd_config(esp_sleep_pd_domain_t domain, esp_sleep_pd_option_t option);
+void esp_deep_sleep_start();
+
+// Test control (fakes.cpp)
+extern esp_sleep_wakeup_cause_t fakeWakeupCause;
+extern uint64_t fakeTimerWakeupUs;      // last esp_sleep_enable_timer_wakeup()
+extern bool fakeUlpWakeupEnabled;
+extern void (*fakeDeepSleepHook)();     // called by esp_deep_sleep_start(), which returns without it
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef FAKE_ESP_SNTP_H
+#define FAKE_ESP_SNTP_H
+
+// SNTP stand-in: esp_sntp_init() with WiFi up sets the system time to
+// fakeNtpEpoch + fakeWallUs() seconds once fakeNtpMs have passed.
+
+#include <time.h>
+
+#define SNTP_OPMODE_POLL 0
+
+typedef enum { SNTP_SYNC_STATUS_RESET, SNTP_SYNC_STATUS_COMPLETED } sntp_sync_status_t;
+
+void esp_sntp_setoperatingmode(int mode);
+void esp_sntp_setservername(int idx, const char* server);
+void esp_sntp_init();
+void esp_sntp_stop();
+sntp_sync_status_t sntp_get_sync_status();
+
+// Test controls (fakes.cpp)
+extern time_t fakeNtpEpoch;         // Unix time at fakeWallUs() == 0
+extern unsigned long fakeNtpMs;     // server round trip
+
+#endif
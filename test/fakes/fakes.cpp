@@ -0,0 +1,516 @@
+// Definitions behind the host fakes: virtual clock, Serial capture, pins,
+// sleep hooks, the in-memory filesystem and the JSON and MessagePack
+// writers/parsers of the ArduinoJson stand-in. State that survives deep
+// sleep on the chip (RTC timer, system time, wakeup configuration) is
+// kept in RTC_DATA_ATTR.
+
+#include "Arduino.h"
+#include "ArduinoJson.h"
+#include "esp_sleep.h"
+#include "esp_rtc_time.h"
+#include "esp32/ulp.h"
+#include "esp_sntp.h"
+#include "freertos/event_groups.h"
+#include "ArduinoOTA.h"
+#include "LittleFS.h"
+#include "WiFi.h"
+#include <ctype.h>
+#include <float.h>
+#include <stdarg.h>
+#include <sys/time.h>
+
+// constructed before the sketch's globals, whose constructors may log
+#define FAKE_CORE_INIT __attribute__((init_priority(101)))
+HardwareSerial Serial FAKE_CORE_INIT;
+FakeFs fakeFs FAKE_CORE_INIT;
+LittleFSFS LittleFS;
+WiFiClass WiFi FAKE_CORE_INIT;
+ArduinoOTAClass ArduinoOTA;
+
+static uint64_t uptimeUs = 0;                     // since the last (fake) boot
+static RTC_DATA_ATTR uint64_t wallUs = 0;         // keeps running across reboots
+static RTC_DATA_ATTR time_t epochBase = 0;
+static RTC_DATA_ATTR uint64_t epochSetAtUs = 0;
+
+int fakePinModeCalls[40];
+bool fakePinLow[40];
+uint16_t fakeAnalogLevel[40];
+RTC_DATA_ATTR esp_sleep_wakeup_cause_t fakeWakeupCause = ESP_SLEEP_WAKEUP_UNDEFINED;
+RTC_DATA_ATTR uint64_t fakeTimerWakeupUs = 0;
+RTC_DATA_ATTR bool fakeUlpWakeupEnabled = false;
+void (*fakeDeepSleepHook)() = nullptr;
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+    static bool echo = getenv("FAKE_SERIAL") != nullptr;
+    output.append((const char*)buffer, size);
+    if (echo) fwrite(buffer, 1, size, stdout);
+    return size;
+}
+
+size_t Print::printf(const char* format, ...) {
+    char text[512];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if (n < 0) return 0;
+    return write((const uint8_t*)text, strlen(text));
+}
+
+unsigned long millis() { return (unsigned long)(uptimeUs / 1000); }
+unsigned long micros() { return (unsigned long)uptimeUs; }
+void delay(unsigned long ms) { fakeAdvanceMs(ms); }
+void yield() {}
+
+// the ULP keeps its own schedule against the RTC timer: run it up to now
+void delayMicroseconds(unsigned int us) {
+    uptimeUs += us;
+    wallUs += us;
+    fakeUlpCatchUp();
+}
+
+void fakeAdvanceMs(unsigned long ms) {
+    uptimeUs += (uint64_t)ms * 1000;
+    wallUs += (uint64_t)ms * 1000;
+    fakeUlpCatchUp();
+}
+
+void fakeReboot() { uptimeUs = 0; }
+
+uint64_t fakeWallUs() { return wallUs; }
+
+uint64_t esp_rtc_get_time_us() { return wallUs; }
+
+void fakeSetEpoch(time_t epoch) {
+    epochBase = epoch;
+    epochSetAtUs = wallUs;
+}
+
+// Replace the C library clocks so queued timestamps follow the virtual clock
+time_t time(time_t* out) noexcept {
+    time_t now = epochBase == 0 ? 0 : epochBase + (time_t)((wallUs - epochSetAtUs) / 1000000);
+    if (out != nullptr) *out = now;
+    return now;
+}
+
+int gettimeofday(struct timeval* tv, void*) noexcept {
+    tv->tv_sec = time(nullptr);
+    tv->tv_usec = epochBase == 0 ? 0 : (suseconds_t)((wallUs - epochSetAtUs) % 1000000);
+    return 0;
+}
+
+void pinMode(uint8_t pin, uint8_t) { if (pin < 40) fakePinModeCalls[pin]++; }
+int digitalRead(uint8_t pin) { return pin < 40 && fakePinLow[pin] ? LOW : HIGH; }
+void digitalWrite(uint8_t, uint8_t) {}
+uint16_t analogRead(uint8_t pin) { return pin < 40 ? fakeAnalogLevel[pin] : 0; }
+void analogReadResolution(uint8_t) {}
+void attachInterrupt(uint8_t, std::function<void()>, int) {}
+void detachInterrupt(uint8_t) {}
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause() { return fakeWakeupCause; }
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t us) { fakeTimerWakeupUs = us; return ESP_OK; }
+esp_err_t esp_sleep_enable_ext0_wakeup(gpio_num_t, int) { return ESP_OK; }
+esp_err_t esp_sleep_enable_ulp_wakeup() { fakeUlpWakeupEnabled = true; return ESP_OK; }
+esp_err_t esp_sleep_pd_config(esp_sleep_pd_domain_t, esp_sleep_pd_option_t) { return ESP_OK; }
+void esp_deep_sleep_start() { if (fakeDeepSleepHook) fakeDeepSleepHook(); }
+void btStop() {}
+
+struct FakeEventGroup {
+    EventBits_t bits;
+};
+
+EventGroupHandle_t xEventGroupCreate() { return new FakeEventGroup{0}; }
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+    EventBits_t before = group->bits;
+    group->bits &= ~bits;
+    return before;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+    return group->bits |= bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clearOnExit,
+                                BaseType_t waitForAll, TickType_t ticks) {
+    unsigned long deadline = millis() + ticks;
+    for (;;) {
+        EventBits_t match = group->bits & bits;
+        if (waitForAll ? match == bits : match != 0) {
+            EventBits_t before = group->bits;
+            if (clearOnExit) group->bits &= ~bits;
+            return before;
+        }
+        if (!WiFi.fakeDeliver(deadline)) break;
+    }
+    if ((long)(deadline - millis()) > 0) fakeAdvanceMs(deadline - millis());
+    return group->bits;
+}
+
+time_t fakeNtpEpoch = 1760000000;
+unsigned long fakeNtpMs = 40;
+static bool sntpRunning = false;
+static unsigned long sntpSyncAtMs = 0;
+
+void esp_sntp_setoperatingmode(int) {}
+void esp_sntp_setservername(int, const char*) {}
+void esp_sntp_stop() { sntpRunning = false; }
+
+void esp_sntp_init() {
+    sntpRunning = WiFi.isConnected();
+    sntpSyncAtMs = millis() + fakeNtpMs;
+}
+
+// COMPLETED is reported once per sync, as by the IDF
+sntp_sync_status_t sntp_get_sync_status() {
+    if (!sntpRunning || (long)(millis() - sntpSyncAtMs) < 0) return SNTP_SYNC_STATUS_RESET;
+    sntpRunning = false;
+    epochBase = fakeNtpEpoch;   // time() = fakeNtpEpoch + fakeWallUs() from now on
+    epochSetAtUs = 0;
+    return SNTP_SYNC_STATUS_COMPLETED;
+}
+
+namespace fakejson {
+
+static void writeString(const std::string& s, std::string& out) {
+    out += '"';
+    for (unsigned char c : s) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            default:
+                if (c < 0x20) {
+                    char esc[8];
+                    snprintf(esc, sizeof(esc), "\\u%04x", c);
+                    out += esc;
+                } else {
+                    out += (char)c;
+                }
+        }
+    }
+    out += '"';
+}
+
+void write(const Node* node, std::string& out) {
+    char number[40];
+    if (node == nullptr) { out += "null"; return; }
+    switch (node->type) {
+        case Node::Null: out += "null"; break;
+        case Node::Bool: out += node->boolean ? "true" : "false"; break;
+        case Node::Int: snprintf(number, sizeof(number), "%lld", (long long)node->integer); out += number; break;
+        case Node::UInt: snprintf(number, sizeof(number), "%llu", (unsigned long long)node->uinteger); out += number; break;
+        case Node::Float:
+            if (!isfinite(node->real)) { out += "null"; break; }
+            snprintf(number, sizeof(number), node->single ? "%.7g" : "%.15g", node->real);
+            out += number;
+            break;
+        case Node::Str: writeString(node->text, out); break;
+        case Node::Object: {
+            out += '{';
+            bool first = true;
+            for (auto& m : node->members) {
+                if (!first) out += ',';
+                first = false;
+                writeString(m.first, out);
+                out += ':';
+                write(m.second.get(), out);
+            }
+            out += '}';
+            break;
+        }
+        case Node::Array: {
+            out += '[';
+            for (size_t i = 0; i < node->items.size(); i++) {
+                if (i > 0) out += ',';
+                write(node->items[i].get(), out);
+            }
+            out += ']';
+            break;
+        }
+    }
+}
+
+static const char* skipSpace(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
+    return p;
+}
+
+static const char* parseString(std::string& s, const char* p, const char* end) {
+    if (p >= end || *p != '"') return nullptr;
+    p++;
+    while (p < end && *p != '"') {
+        char c = *p++;
+        if (c != '\\') { s += c; continue; }
+        if (p >= end) return nullptr;
+        switch (*p++) {
+            case '"': s += '"'; break;
+            case '\\': s += '\\'; break;
+            case '/': s += '/'; break;
+            case 'n': s += '\n'; break;
+            case 'r': s += '\r'; break;
+            case 't': s += '\t'; break;
+            case 'b': s += '\b'; break;
+            case 'f': s += '\f'; break;
+            case 'u': {
+                if (end - p < 4) return nullptr;
+                s += (char)strtol(std::string(p, 4).c_str(), nullptr, 16);
+                p += 4;
+                break;
+            }
+            default: return nullptr;
+        }
+    }
+    return p < end ? p + 1 : nullptr;
+}
+
+static const char* parseValue(Node& node, const char* p, const char* end, int depth) {
+    if (depth > 10) return nullptr;
+    p = skipSpace(p, end);
+    if (p >= end) return nullptr;
+
+    if (*p == '{') {
+        node.type = Node::Object;
+        p = skipSpace(p + 1, end);
+        if (p < end && *p == '}') return p + 1;
+        while (true) {
+            std::string key;
+            p = parseString(key, skipSpace(p, end), end);
+            if (p == nullptr) return nullptr;
+            p = skipSpace(p, end);
+            if (p >= end || *p != ':') return nullptr;
+            Node* child = node.member(key);
+            child->reset();
+            p = parseValue(*child, p + 1, end, depth + 1);
+            if (p == nullptr) return nullptr;
+            p = skipSpace(p, end);
+            if (p < end && *p == ',') { p++; continue; }
+            if (p < end && *p == '}') return p + 1;
+            return nullptr;
+        }
+    }
+    if (*p == '[') {
+        node.type = Node::Array;
+        p = skipSpace(p + 1, end);
+        if (p < end && *p == ']') return p + 1;
+        while (true) {
+            p = parseValue(*node.append(), p, end, depth + 1);
+            if (p == nullptr) return nullptr;
+            p = skipSpace(p, end);
+            if (p < end && *p == ',') { p++; continue; }
+            if (p < end && *p == ']') return p + 1;
+            return nullptr;
+        }
+    }
+    if (*p == '"') {
+        node.type = Node::Str;
+        return parseString(node.text, p, end);
+    }
+    if (end - p >= 4 && strncmp(p, "true", 4) == 0) { node.type = Node::Bool; node.boolean = true; return p + 4; }
+    if (end - p >= 5 && strncmp(p, "false", 5) == 0) { node.type = Node::Bool; node.boolean = false; return p + 5; }
+    if (end - p >= 4 && strncmp(p, "null", 4) == 0) { node.type = Node::Null; return p + 4; }
+
+    const char* start = p;
+    bool real = false;
+    if (p < end && *p == '-') p++;
+    if (p >= end || !isdigit((unsigned char)*p)) return nullptr;
+    while (p < end && (isdigit((unsigned char)*p) || *p == '.' || *p == 'e' || *p == 'E' ||
+                       ((*p == '-' || *p == '+') && (p[-1] == 'e' || p[-1] == 'E')))) {
+        if (*p == '.' || *p == 'e' || *p == 'E') real = true;
+        p++;
+    }
+    std::string number(start, p);
+    if (real) {
+        node.type = Node::Float;
+        node.real = strtod(number.c_str(), nullptr);
+    } else if (number[0] == '-') {
+        node.type = Node::Int;
+        node.integer = strtoll(number.c_str(), nullptr, 10);
+    } else {
+        node.type = Node::UInt;
+        node.uinteger = strtoull(number.c_str(), nullptr, 10);
+    }
+    return p;
+}
+
+const char* parse(Node& node, const char* p, const char* end) {
+    node.reset();
+    p = parseValue(node, p, end, 0);
+    if (p == nullptr) return nullptr;
+    p = skipSpace(p, end);
+    return p == end ? p : nullptr;
+}
+
+static void putBig(std::string& out, uint64_t v, int bytes) {
+    while (bytes--) out += (char)(v >> (8 * bytes));
+}
+
+// array (fix 0x90, 16-bit 0xDC) or map (0x80, 0xDE) header, the 32-bit form follows the 16-bit one
+static void writeHeader(std::string& out, uint8_t fix, uint8_t wide, size_t n) {
+    if (n < 16) out += (char)(fix | n);
+    else if (n <= 0xFFFF) { out += (char)wide; putBig(out, n, 2); }
+    else { out += (char)(wide + 1); putBig(out, n, 4); }
+}
+
+static void writeMsgPackString(const std::string& s, std::string& out) {
+    if (s.size() < 32) out += (char)(0xA0 | s.size());
+    else if (s.size() <= 0xFF) { out += (char)0xD9; putBig(out, s.size(), 1); }
+    else if (s.size() <= 0xFFFF) { out += (char)0xDA; putBig(out, s.size(), 2); }
+    else { out += (char)0xDB; putBig(out, s.size(), 4); }
+    out += s;
+}
+
+static void writeUnsigned(uint64_t v, std::string& out) {
+    if (v < 0x80) out += (char)v;
+    else if (v <= 0xFF) { out += (char)0xCC; putBig(out, v, 1); }
+    else if (v <= 0xFFFF) { out += (char)0xCD; putBig(out, v, 2); }
+    else if (v <= 0xFFFFFFFF) { out += (char)0xCE; putBig(out, v, 4); }
+    else { out += (char)0xCF; putBig(out, v, 8); }
+}
+
+// smallest encodings, and floats as float32 when in range, like ArduinoJson's MsgPackSerializer
+void writeMsgPack(const Node* node, std::string& out) {
+    if (node == nullptr) { out += (char)0xC0; return; }
+    switch (node->type) {
+        case Node::Null: out += (char)0xC0; break;
+        case Node::Bool: out += (char)(node->boolean ? 0xC3 : 0xC2); break;
+        case Node::UInt: writeUnsigned(node->uinteger, out); break;
+        case Node::Int: {
+            int64_t v = node->integer;
+            if (v >= 0) writeUnsigned((uint64_t)v, out);
+            else if (v >= -32) out += (char)v;
+            else if (v >= INT8_MIN) { out += (char)0xD0; putBig(out, (uint64_t)v, 1); }
+            else if (v >= INT16_MIN) { out += (char)0xD1; putBig(out, (uint64_t)v, 2); }
+            else if (v >= INT32_MIN) { out += (char)0xD2; putBig(out, (uint64_t)v, 4); }
+            else { out += (char)0xD3; putBig(out, (uint64_t)v, 8); }
+            break;
+        }
+        case Node::Float: {
+            if (fabs(node->real) <= FLT_MAX || !isfinite(node->real)) {
+                float f = (float)node->real;
+                uint32_t bits;
+                memcpy(&bits, &f, sizeof(bits));
+                out += (char)0xCA;
+                putBig(out, bits, 4);
+            } else {
+                uint64_t bits;
+                memcpy(&bits, &node->real, sizeof(bits));
+                out += (char)0xCB;
+                putBig(out, bits, 8);
+            }
+            break;
+        }
+        case Node::Str: writeMsgPackString(node->text, out); break;
+        case Node::Object:
+            writeHeader(out, 0x80, 0xDE, node->members.size());
+            for (auto& m : node->members) {
+                writeMsgPackString(m.first, out);
+                writeMsgPack(m.second.get(), out);
+            }
+            break;
+        case Node::Array:
+            writeHeader(out, 0x90, 0xDC, node->items.size());
+            for (auto& item : node->items) writeMsgPack(item.get(), out);
+            break;
+    }
+}
+
+static bool takeBig(const uint8_t*& p, const uint8_t* end, int bytes, uint64_t& v) {
+    if (end - p < bytes) return false;
+    v = 0;
+    while (bytes--) v = v << 8 | *p++;
+    return true;
+}
+
+static const uint8_t* parseMsgPackValue(Node& node, const uint8_t* p, const uint8_t* end, int depth) {
+    if (depth > 10 || p >= end) return nullptr;
+    uint8_t b = *p++;
+    uint64_t v = 0;
+    size_t length = 0;
+    int lengthBytes = 0;
+
+    if (b <= 0x7F) { node.type = Node::UInt; node.uinteger = b; return p; }
+    if (b >= 0xE0) { node.type = Node::Int; node.integer = (int8_t)b; return p; }
+    if ((b & 0xE0) == 0xA0) { length = b & 0x1F; b = 0xD9; }
+    else if ((b & 0xF0) == 0x80) { length = b & 0x0F; b = 0xDE; }
+    else if ((b & 0xF0) == 0x90) { length = b & 0x0F; b = 0xDC; }
+    else if (b == 0xD9 || b == 0xC4) lengthBytes = 1;
+    else if (b == 0xDA || b == 0xC5 || b == 0xDC || b == 0xDE) lengthBytes = 2;
+    else if (b == 0xDB || b == 0xC6 || b == 0xDD || b == 0xDF) lengthBytes = 4;
+    if (lengthBytes > 0) {
+        if (!takeBig(p, end, lengthBytes, v)) return nullptr;
+        length = (size_t)v;
+        if (b == 0xDB || b == 0xDA) b = 0xD9;
+        if (b == 0xDD) b = 0xDC;
+        if (b == 0xDF) b = 0xDE;
+    }
+
+    switch (b) {
+        case 0xC0: node.type = Node::Null; return p;
+        case 0xC2: node.type = Node::Bool; node.boolean = false; return p;
+        case 0xC3: node.type = Node::Bool; node.boolean = true; return p;
+        case 0xCC: case 0xCD: case 0xCE: case 0xCF:
+            if (!takeBig(p, end, 1 << (b - 0xCC), v)) return nullptr;
+            node.type = Node::UInt;
+            node.uinteger = v;
+            return p;
+        case 0xD0: case 0xD1: case 0xD2: case 0xD3: {
+            int bytes = 1 << (b - 0xD0);
+            if (!takeBig(p, end, bytes, v)) return nullptr;
+            if (bytes < 8 && (v >> (8 * bytes - 1)) & 1) v |= ~0ULL << (8 * bytes);   // sign extend
+            node.type = Node::Int;
+            node.integer = (int64_t)v;
+            return p;
+        }
+        case 0xCA: {
+            if (!takeBig(p, end, 4, v)) return nullptr;
+            uint32_t bits = (uint32_t)v;
+            float f;
+            memcpy(&f, &bits, sizeof(f));
+            node.type = Node::Float;
+            node.real = f;
+            node.single = true;
+            return p;
+        }
+        case 0xCB: {
+            if (!takeBig(p, end, 8, v)) return nullptr;
+            node.type = Node::Float;
+            memcpy(&node.real, &v, sizeof(v));
+            return p;
+        }
+        case 0xD9: case 0xC4: case 0xC5: case 0xC6:   // strings; binary is read as a string
+            if ((size_t)(end - p) < length) return nullptr;
+            node.type = Node::Str;
+            node.text.assign((const char*)p, length);
+            return p + length;
+        case 0xDC:
+            node.type = Node::Array;
+            for (size_t i = 0; i < length && p != nullptr; i++) p = parseMsgPackValue(*node.append(), p, end, depth + 1);
+            return p;
+        case 0xDE:
+            node.type = Node::Object;
+            for (size_t i = 0; i < length && p != nullptr; i++) {
+                Node key;
+                p = parseMsgPackValue(key, p, end, depth + 1);
+                if (p == nullptr || key.type != Node::Str) return nullptr;
+                Node* child = node.member(key.text);
+                child->reset();
+                p = parseMsgPackValue(*child, p, end, depth + 1);
+            }
+            return p;
+        default:
+            return nullptr;     // extension types
+    }
+}
+
+const char* parseMsgPack(Node& node, const char* p, const char* end) {
+    node.reset();
+    const uint8_t* q = parseMsgPackValue(node, (const uint8_t*)p, (const uint8_t*)end, 0);
+    return q == (const uint8_t*)end ? (const char*)q : nullptr;
+}
+
+}  // namespace fakejson
@@ -0,0 +1,19 @@
+#ifndef FAKE_EVENT_GROUPS_H
+#define FAKE_EVENT_GROUPS_H
+
+// Event groups on the virtual clock: a wait that finds none of its bits
+// set lets the fake WiFi deliver events due within the timeout, and
+// otherwise returns after moving the clock by the whole timeout.
+
+#include "freertos/FreeRTOS.h"
+
+typedef uint32_t EventBits_t;
+typedef struct FakeEventGroup* EventGroupHandle_t;
+
+EventGroupHandle_t xEventGroupCreate();
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clearOnExit,
+                                BaseType_t waitForAll, TickType_t ticks);
+
+#endif
@@ -0,0 +1,156 @@
+// DS18B20 bus model behind OneWire.h
+
+#include "OneWire.h"
+
+RTC_DATA_ATTR FakeOneWireBus fakeOneWire;
+
+static const unsigned long CONVERSION_US[4] = {93750, 187500, 375000, 750000};
+
+static void updateCrc(FakeDs18b20& p) {
+    p.scratchpad[8] = OneWire::crc8(p.scratchpad, 8);
+}
+
+/**
+ * Latches the result of every conversion that has finished by now
+ */
+static void settle() {
+    for (uint8_t i = 0; i < fakeOneWire.count; i++) {
+        FakeDs18b20& p = fakeOneWire.probes[i];
+        if (!p.converting || fakeWallUs() < p.convertDoneUs) continue;
+        uint8_t bits = ((p.scratchpad[4] >> 5) & 0x03) + 9;
+        int16_t raw = (int16_t)lroundf(p.tempC * 16.0f);
+        raw &= (int16_t)~((1 << (12 - bits)) - 1);
+        p.scratchpad[0] = raw & 0xFF;
+        p.scratchpad[1] = (raw >> 8) & 0xFF;
+        p.converting = false;
+        updateCrc(p);
+    }
+}
+
+static void powerOn(FakeDs18b20& p) {
+    const uint8_t defaults[9] = {0x50, 0x05, p.eeprom[0], p.eeprom[1], p.eeprom[2], 0xFF, 0x0C, 0x10, 0};
+    memcpy(p.scratchpad, defaults, sizeof(defaults));
+    p.converting = false;
+    updateCrc(p);
+}
+
+int fakeOneWireAddProbe(uint8_t serial, float tempC) {
+    if (fakeOneWire.count == FAKE_ONEWIRE_MAX_PROBES) return -1;
+    FakeDs18b20& p = fakeOneWire.probes[fakeOneWire.count];
+    const uint8_t rom[8] = {0x28, serial, 0x4C, 0x07, 0xD6, 0x01, 0x3C, 0};
+    memcpy(p.rom, rom, sizeof(rom));
+    p.rom[7] = OneWire::crc8(p.rom, 7);
+    p.eeprom[0] = 0x4B;
+    p.eeprom[1] = 0x46;
+    p.eeprom[2] = 0x7F;
+    p.tempC = tempC;
+    powerOn(p);
+    return fakeOneWire.count++;
+}
+
+void fakeOneWirePowerCycle() {
+    for (uint8_t i = 0; i < fakeOneWire.count; i++) powerOn(fakeOneWire.probes[i]);
+}
+
+uint8_t OneWire::reset() {
+    settle();
+    state = IDLE;
+    selected = -1;
+    return fakeOneWire.count > 0;
+}
+
+void OneWire::skip() {
+    selected = -1;
+    state = FUNCTION;
+}
+
+void OneWire::select(const uint8_t rom[8]) {
+    selected = -2;   // nobody answers
+    for (uint8_t i = 0; i < fakeOneWire.count; i++) {
+        if (memcmp(fakeOneWire.probes[i].rom, rom, 8) == 0) selected = i;
+    }
+    state = FUNCTION;
+}
+
+void OneWire::command(uint8_t v) {
+    index = 0;
+    state = IDLE;
+    switch (v) {
+        case 0x44:
+            fakeOneWire.conversions++;
+            for (uint8_t i = 0; i < fakeOneWire.count; i++) {
+                if (selected != -1 && selected != i) continue;
+                FakeDs18b20& p = fakeOneWire.probes[i];
+                p.converting = true;
+                p.convertDoneUs = fakeWallUs() + CONVERSION_US[(p.scratchpad[4] >> 5) & 0x03];
+            }
+            break;
+        case 0xBE: state = READ_SCRATCH; break;
+        case 0x4E: state = WRITE_SCRATCH; break;
+        case 0xB4: state = READ_POWER; break;
+        case 0x48:
+            fakeOneWire.eepromWrites++;
+            for (uint8_t i = 0; i < fakeOneWire.count; i++) {
+                if (selected != -1 && selected != i) continue;
+                memcpy(fakeOneWire.probes[i].eeprom, &fakeOneWire.probes[i].scratchpad[2], 3);
+            }
+            break;
+    }
+}
+
+void OneWire::write(uint8_t v, uint8_t) {
+    if (state == FUNCTION) {
+        command(v);
+    } else if (state == WRITE_SCRATCH) {
+        for (uint8_t i = 0; i < fakeOneWire.count; i++) {
+            if (selected != -1 && selected != i) continue;
+            FakeDs18b20& p = fakeOneWire.probes[i];
+            p.scratchpad[2 + index] = (index == 2) ? ((v & 0x60) | 0x1F) : v;
+            updateCrc(p);
+        }
+        if (++index == 3) state = IDLE;
+    }
+}
+
+uint8_t OneWire::read() {
+    if (state != READ_SCRATCH || index >= 9) return 0xFF;
+    settle();
+    uint8_t v = 0xFF;   // open drain: several probes answering AND their bits
+    for (uint8_t i = 0; i < fakeOneWire.count; i++) {
+        if (selected == -1 || selected == i) v &= fakeOneWire.probes[i].scratchpad[index];
+    }
+    index++;
+    return v;
+}
+
+uint8_t OneWire::read_bit() {
+    if (state == READ_POWER) return fakeOneWire.parasite ? 0 : 1;
+    if (fakeOneWire.parasite) return 1;   // no way to signal busy on a parasite bus
+    settle();
+    for (uint8_t i = 0; i < fakeOneWire.count; i++) {
+        if (fakeOneWire.probes[i].converting) return 0;
+    }
+    return 1;
+}
+
+// Finds the probes in the order they were added
+uint8_t OneWire::search(uint8_t* newAddr, bool) {
+    if (searchNext >= fakeOneWire.count) return 0;
+    memcpy(newAddr, fakeOneWire.probes[searchNext++].rom, 8);
+    return 1;
+}
+
+// Dallas/Maxim CRC-8, polynomial x^8 + x^5 + x^4 + 1
+uint8_t OneWire::crc8(const uint8_t* addr, uint8_t len) {
+    uint8_t crc = 0;
+    while (len--) {
+        uint8_t inbyte = *addr++;
+        for (uint8_t i = 8; i; i--) {
+            uint8_t mix = (crc ^ inbyte) & 0x01;
+            crc >>= 1;
+            if (mix) crc ^= 0x8C;
+            inbyte >>= 1;
+        }
+    }
+    return crc;
+}
@@ -0,0 +1,120 @@
+// ULP coprocessor and RTC IO model behind esp32/ulp.h and driver/rtc_io.h.
+// The program, its schedule and RTC slow memory live in RTC_DATA_ATTR, so
+// the ULP keeps counting across a simulated deep sleep like on the chip.
+
+#include "Arduino.h"
+#include "esp32/ulp.h"
+#include "driver/rtc_io.h"
+
+#define FAKE_ULP_MAX_INSNS 128
+#define FAKE_ULP_MAX_LABELS 16
+
+RTC_DATA_ATTR uint32_t fakeRtcSlowMem[2048];
+RTC_DATA_ATTR FakeUlp fakeUlp;
+RTC_DATA_ATTR FakeRtcGpio fakeRtcGpio;
+int (*fakeUlpPin)(uint64_t wallUs) = nullptr;
+
+static RTC_DATA_ATTR ulp_insn_t ulpProgram[FAKE_ULP_MAX_INSNS];
+static RTC_DATA_ATTR size_t ulpProgramSize = 0;
+static RTC_DATA_ATTR size_t ulpLabels[FAKE_ULP_MAX_LABELS];
+static RTC_DATA_ATTR uint64_t ulpNextRunUs = 0;
+
+esp_err_t ulp_process_macros_and_load(uint32_t, const ulp_insn_t* program, size_t* psize) {
+    ulpProgramSize = 0;
+    for (size_t i = 0; i < *psize; i++) {
+        if (program[i].op == ULP_OP_LABEL) {
+            if (program[i].a >= FAKE_ULP_MAX_LABELS) return ESP_ERR_INVALID_ARG;
+            ulpLabels[program[i].a] = ulpProgramSize;
+        } else {
+            if (ulpProgramSize == FAKE_ULP_MAX_INSNS) return ESP_ERR_INVALID_ARG;
+            ulpProgram[ulpProgramSize++] = program[i];
+        }
+    }
+    *psize = ulpProgramSize;
+    fakeUlp.loads++;
+    return ESP_OK;
+}
+
+esp_err_t ulp_run(uint32_t) {
+    fakeUlp.running = true;
+    ulpNextRunUs = fakeWallUs() + (fakeUlp.periodUs > 0 ? fakeUlp.periodUs : 1000);
+    return ESP_OK;
+}
+
+esp_err_t ulp_set_wakeup_period(size_t, uint32_t period_us) {
+    fakeUlp.periodUs = period_us;
+    return ESP_OK;
+}
+
+static uint32_t readReg(uint32_t reg) {
+    switch (reg) {
+        case RTC_GPIO_IN_REG: return fakeUlp.pinLevel ? 0xFFFFFFFF : 0;
+        default: return 0;
+    }
+}
+
+/**
+ * Runs the program from its entry until I_HALT
+ */
+static void runProgram() {
+    uint16_t r[4] = {};
+    bool zero = false;
+    size_t pc = 0;
+    fakeUlp.runs++;
+    for (int steps = 0; steps < 1000 && pc < ulpProgramSize; steps++) {
+        const ulp_insn_t& in = ulpProgram[pc++];
+        uint32_t alu;
+        switch (in.op) {
+            case ULP_OP_MOVI: alu = in.c; break;
+            case ULP_OP_MOVR: alu = r[in.b]; break;
+            case ULP_OP_ADDI: alu = r[in.b] + in.c; break;
+            case ULP_OP_SUBI: alu = r[in.b] - in.c; break;
+            case ULP_OP_ANDI: alu = r[in.b] & in.c; break;
+            case ULP_OP_SUBR: alu = r[in.b] - r[in.c]; break;
+            case ULP_OP_LD: r[in.a] = fakeRtcSlowMem[r[in.b] + in.c] & 0xFFFF; continue;
+            case ULP_OP_ST: fakeRtcSlowMem[r[in.b] + in.c] = r[in.a]; continue;
+            case ULP_OP_RD_REG: {
+                uint32_t bits = in.c - in.b + 1;
+                uint32_t mask = bits >= 32 ? 0xFFFFFFFF : (1UL << bits) - 1;
+                r[R0] = (uint16_t)((readReg(in.a) >> in.b) & mask);
+                continue;
+            }
+            case ULP_OP_BX: pc = ulpLabels[in.a]; continue;
+            case ULP_OP_BXZ: if (zero) pc = ulpLabels[in.a]; continue;
+            case ULP_OP_WAKE: fakeUlp.wakes++; continue;
+            case ULP_OP_HALT: return;
+            default: continue;
+        }
+        r[in.a] = (uint16_t)alu;
+        zero = r[in.a] == 0;
+    }
+}
+
+void fakeUlpCatchUp() {
+    uint64_t now = fakeWallUs();
+    if (!fakeUlp.running) return;
+    uint32_t period = fakeUlp.periodUs > 0 ? fakeUlp.periodUs : 1000;
+    while (ulpNextRunUs <= now) {
+        if (fakeUlpPin != nullptr) fakeUlp.pinLevel = fakeUlpPin(ulpNextRunUs);
+        runProgram();
+        ulpNextRunUs += period;
+    }
+}
+
+void fakeUlpRunFor(unsigned long ms) { fakeAdvanceMs(ms); }
+
+int rtc_io_number_get(gpio_num_t gpio_num) {
+    return gpio_num == GPIO_NUM_27 ? 17 : -1;
+}
+
+static esp_err_t configure() {
+    if (fakeRtcGpio.held) fakeRtcGpio.configuredWhileHeld = true;
+    return ESP_OK;
+}
+
+esp_err_t rtc_gpio_init(gpio_num_t) { fakeRtcGpio.inits++; return configure(); }
+esp_err_t rtc_gpio_set_direction(gpio_num_t, rtc_gpio_mode_t) { return configure(); }
+esp_err_t rtc_gpio_pullup_en(gpio_num_t) { fakeRtcGpio.pullup = true; return configure(); }
+esp_err_t rtc_gpio_pulldown_dis(gpio_num_t) { return configure(); }
+esp_err_t rtc_gpio_hold_en(gpio_num_t) { fakeRtcGpio.held = true; return ESP_OK; }
+esp_err_t rtc_gpio_hold_dis(gpio_num_t) { fakeRtcGpio.held = false; return ESP_OK; }
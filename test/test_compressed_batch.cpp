@@ -0,0 +1,225 @@
+// CompressedBatch: encode/decode round trip within the fixed-point scale
+// of each field, compression ratio against the queued JSON, the limits
+// (unknown fields, full batch, RTC state across wakes), and compact()
+// moving readings out of a queue that also holds other records.
+
+#include "check.h"
+#include "inc/CompressedBatch.h"
+#include "inc/MqttRtcStorage.h"
+
+static const time_t T0 = 1700000000;
+
+struct Sample {
+    time_t ts;
+    float soil;
+    float pressure;
+    float battery;
+};
+
+static Sample sample(int i) {
+    // one reading a minute with a little jitter, slowly drifting values
+    return { T0 + i * 60 + (i % 3), 72.5f + 0.03f * i, 101325.0f - 2.0f * i, 3.9f - 0.001f * i };
+}
+
+static void fill(JsonDocument& doc, const Sample& s) {
+    doc["soil_temp"] = s.soil;
+    doc["bmp_pressure"] = s.pressure;
+    doc["battery"] = s.battery;
+}
+
+static bool near(float a, float b, float scale) {
+    return fabsf(a - b) <= 0.5f / scale + 1e-4f;
+}
+
+static void testRoundTrip() {
+    CompressedBatch batch;
+    batch.clear();
+    const int n = 40;
+    for (int i = 0; i < n; i++) {
+        JsonDocument doc;
+        fill(doc, sample(i));
+        CHECK(batch.append(sample(i).ts, doc.as<JsonObjectConst>()));
+    }
+    CHECK_EQ(batch.count(), n);
+
+    JsonDocument out;
+    CHECK(CompressedBatch::decode(compressedBatchData, batch.bytes(), out));
+    CHECK_EQ(out.size(), n);
+    for (int i = 0; i < n; i++) {
+        Sample s = sample(i);
+        JsonObject item = out[i].as<JsonObject>();
+        CHECK_EQ(item["ts"].as<long>(), s.ts);
+        CHECK(near(item["soil_temp"].as<float>(), s.soil, 100));
+        CHECK(near(item["bmp_pressure"].as<float>(), s.pressure, 1));
+        CHECK(near(item["battery"].as<float>(), s.battery, 1000));
+        CHECK(item["rain"].isNull());
+    }
+}
+
+static void testCompressionRatio() {
+    CompressedBatch batch;
+    batch.clear();
+    size_t jsonBytes = 0;
+    const int n = 60;
+    for (int i = 0; i < n; i++) {
+        JsonDocument doc;
+        fill(doc, sample(i));
+        jsonBytes += measureJson(doc) + sizeof(uint32_t);   // payload plus its timestamp
+        CHECK(batch.append(sample(i).ts, doc.as<JsonObjectConst>()));
+    }
+    printf("compressed %d records: %u bytes vs %u bytes of JSON (%.1fx)\n", n,
+           (unsigned)batch.bytes(), (unsigned)jsonBytes, (double)jsonBytes / batch.bytes());
+    CHECK(batch.bytes() * 8 < jsonBytes);
+}
+
+static void testRejectsUnknownField() {
+    CompressedBatch batch;
+    batch.clear();
+    JsonDocument doc;
+    doc["soil_temp"] = 70.0f;
+    doc["status"] = "ok";
+    CHECK(!batch.append(T0, doc.as<JsonObjectConst>()));
+    CHECK_EQ(batch.count(), 0);
+    CHECK_EQ(batch.bytes(), COMPRESSED_BATCH_HEADER_BYTES);
+}
+
+static void testFullBatch() {
+    CompressedBatch batch;
+    batch.clear();
+    size_t appended = 0;
+    for (int i = 0; i < 5000; i++) {
+        JsonDocument doc;
+        // large jumps force the widest buckets
+        doc["bmp_pressure"] = (i % 2) ? 90000.0f : 110000.0f;
+        doc["soil_temp"] = (i % 2) ? -40.0f : 140.0f;
+        if (!batch.append(T0 + i * 977 * (i % 5), doc.as<JsonObjectConst>())) break;
+        appended++;
+    }
+    CHECK(appended > 0 && appended < 5000);
+    CHECK(batch.bytes() <= COMPRESSED_BATCH_BYTES);
+
+    JsonDocument out;
+    CHECK(CompressedBatch::decode(compressedBatchData, batch.bytes(), out));
+    CHECK_EQ(out.size(), appended);
+    CHECK_EQ(out[appended - 1]["bmp_pressure"].as<long>(), ((appended - 1) % 2) ? 90000 : 110000);
+}
+
+static void testSurvivesDeepSleep() {
+    {
+        CompressedBatch batch;
+        batch.clear();
+        JsonDocument doc;
+        fill(doc, sample(0));
+        CHECK(batch.append(sample(0).ts, doc.as<JsonObjectConst>()));
+    }
+    CompressedBatch batch;
+    CHECK_EQ(batch.count(), 1);
+    JsonDocument doc;
+    fill(doc, sample(1));
+    CHECK(batch.append(sample(1).ts, doc.as<JsonObjectConst>()));
+
+    JsonDocument out;
+    CHECK(CompressedBatch::decode(compressedBatchData, batch.bytes(), out));
+    CHECK_EQ(out[1]["ts"].as<long>(), sample(1).ts);
+}
+
+static void testDecodeRejectsTruncated() {
+    CompressedBatch batch;
+    batch.clear();
+    for (int i = 0; i < 10; i++) {
+        JsonDocument doc;
+        fill(doc, sample(i));
+        batch.append(sample(i).ts, doc.as<JsonObjectConst>());
+    }
+    JsonDocument out;
+    CHECK(!CompressedBatch::decode(compressedBatchData, batch.bytes() / 2, out));
+    uint8_t wrongVersion[COMPRESSED_BATCH_HEADER_BYTES] = { COMPRESSED_BATCH_VERSION + 1, 0, 0, 0 };
+    CHECK(!CompressedBatch::decode(wrongVersion, sizeof(wrongVersion), out));
+}
+
+typedef MqttMessageQueue<40, MqttRtcStorage> RtcQueue;
+
+static void testCompactSkipsOtherRecords() {
+    mqttRtcMagic = 0;
+    RtcQueue queue;
+    CompressedBatch batch;
+    batch.clear();
+    size_t jsonBytes = 0;
+    const int n = 20;   // plus 4 other records: as many as the RTC queue bytes hold
+    for (int i = 0; i < n; i++) {
+        fakeSetEpoch(sample(i).ts);
+        JsonDocument doc;
+        fill(doc, sample(i));
+        jsonBytes += measureJson(doc) + sizeof(uint32_t);
+        CHECK(queue.enqueue("backyard/", doc));
+        if (i % 10 == 3) {
+            JsonDocument health;
+            health["sensor_health"]["soil"]["ok"] = false;   // not a reading
+            CHECK(queue.enqueue("backyard/", health));
+        }
+        if (i % 10 == 7) {
+            JsonDocument other;
+            other["battery"] = 3.7f;                          // reading, but another topic
+            CHECK(queue.enqueue("backyard/extra/", other));
+        }
+    }
+    CHECK_EQ(batch.compact(queue, "backyard"), 0);            // prefix only: no match
+    CHECK_EQ(queue.size(), n + 4);
+
+    CHECK_EQ(batch.compact(queue, "backyard/"), n);
+    CHECK_EQ(queue.size(), 4);
+    printf("compacted %d records: %u bytes vs %u bytes of JSON (%.1fx)\n", n,
+           (unsigned)batch.bytes(), (unsigned)jsonBytes, (double)jsonBytes / batch.bytes());
+    CHECK(batch.bytes() * 8 < jsonBytes);
+
+    // skipped records keep their order and original timestamps
+    const char* topics[4] = { "backyard/", "backyard/extra/", "backyard/", "backyard/extra/" };
+    const int at[4] = { 3, 7, 13, 17 };
+    for (int i = 0; i < 4; i++) {
+        MqttRecord record;
+        CHECK(queue.peekAt(i, record));
+        CHECK_STR(record.topic, topics[i]);
+        CHECK_EQ(record.timestamp, sample(at[i]).ts);
+    }
+
+    JsonDocument out;
+    CHECK(CompressedBatch::decode(compressedBatchData, batch.bytes(), out));
+    CHECK_EQ(out.size(), n);
+    for (int i = 0; i < n; i++) {
+        Sample s = sample(i);
+        CHECK_EQ(out[i]["ts"].as<long>(), s.ts);
+        CHECK(near(out[i]["soil_temp"].as<float>(), s.soil, 100));
+        CHECK(near(out[i]["bmp_pressure"].as<float>(), s.pressure, 1));
+    }
+}
+
+static void testCompactStopsWhenFull() {
+    mqttRtcMagic = 0;
+    RtcQueue queue;
+    CompressedBatch batch;
+    batch.clear();
+    while (!batch.full()) {
+        JsonDocument doc;
+        doc["bmp_pressure"] = (batch.count() % 2) ? 90000.0f : 110000.0f;
+        batch.append(T0 + batch.count() * 977, doc.as<JsonObjectConst>());
+    }
+    for (int i = 0; i < 3; i++) {
+        JsonDocument doc;
+        fill(doc, sample(i));
+        CHECK(queue.enqueue("backyard/", doc));
+    }
+    CHECK_EQ(batch.compact(queue, "backyard/"), 0);
+    CHECK_EQ(queue.size(), 3);
+}
+
+int main() {
+    RUN(testRoundTrip);
+    RUN(testCompressionRatio);
+    RUN(testRejectsUnknownField);
+    RUN(testFullBatch);
+    RUN(testSurvivesDeepSleep);
+    RUN(testDecodeRejectsTruncated);
+    RUN(testCompactSkipsOtherRecords);
+    RUN(testCompactStopsWhenFull);
+    return checkFailures;
+}
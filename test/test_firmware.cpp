@@ -0,0 +1,496 @@
+// Whole-firmware simulation: RainGauge.ino's setup()/loop() run against the
+// fakes for many deep sleep cycles on the virtual clock, and the checks
+// look at what reached the broker.
+//
+// Every wake runs in a fresh process (this binary, re-executed with
+// SIM_FD set), so the sketch's ordinary globals are constructed anew like
+// after a real reset. What survives deep sleep on the chip is carried from
+// one wake to the next in shared memory: the "rtc_data" section (every
+// RTC_DATA_ATTR variable, plus the fake ULP, DS18B20 probes and RTC timer
+// kept there), restored before any static constructor runs, and the
+// LittleFS image. esp_deep_sleep_start() saves both, lets the ULP count
+// the scenario's bucket tips through the sleep time and picks the wake
+// cause (timer, or ULP if it raised a wake).
+//
+// Run with FAKE_SERIAL=1 to see the firmware's serial log.
+
+#include "check.h"
+#include "RainGauge.ino"
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+extern uint8_t __start_rtc_data[];
+extern uint8_t __stop_rtc_data[];
+
+#define SIM_FLASH_BYTES (256 * 1024)
+#define SIM_LOG_BYTES (8 * 1024 * 1024)
+#define SIM_MAX_WAKES 8192
+#define SIM_TIP_PULSE_US 80000          // reed switch closure per bucket tip
+#define SIM_SLEEP_STEP_MS 50            // granularity of ULP wake detection
+#define SIM_BATTERY_LEVEL 2450          // ~3.85 V through the divider
+#define SIM_BOOT_MS 60                  // reset to app start, before any constructor
+
+/**
+ * Rain falling at one tip every intervalS from startS to endS (seconds of
+ * simulated time), broker unreachable from downS to upS
+ */
+struct Scenario {
+    const char* name;
+    uint32_t durationS;
+    struct Shower { uint32_t startS, endS, intervalS; } showers[3];
+    uint32_t brokerDownS, brokerUpS;
+};
+
+struct WakeRecord {
+    esp_sleep_wakeup_cause_t cause;
+    bool radio;             // WiFi was brought up
+};
+
+// Shared with the wake processes
+struct SimShared {
+    int scenario;           // index into scenarios
+    size_t rtcSize;
+    bool rtcValid;
+    size_t flashSize;
+    size_t logSize;
+    size_t wakeCount;
+    uint64_t wallUs;        // simulated time reached
+    WakeRecord wakes[SIM_MAX_WAKES];
+    uint8_t flash[SIM_FLASH_BYTES];
+    uint8_t log[SIM_LOG_BYTES];
+    uint8_t rtc[];
+};
+
+static const Scenario scenarios[] = {
+    // a day with the broker up: a steady shower and a cloudburst
+    {"day", 24 * 3600, {{6 * 3600, 8 * 3600, 45}, {14 * 3600, 14 * 3600 + 900, 8}, {0, 0, 0}}, 0, 0},
+    // broker down for six hours, rain during the outage
+    {"outage", 12 * 3600, {{3 * 3600, 4 * 3600, 60}, {0, 0, 0}, {0, 0, 0}}, 2 * 3600, 8 * 3600},
+};
+enum { SCENARIO_DAY, SCENARIO_OUTAGE };
+
+static int simFd = -1;
+static SimShared* sim = nullptr;
+static const Scenario* scenario = nullptr;
+
+static size_t rtcSize() { return (size_t)(__stop_rtc_data - __start_rtc_data); }
+static size_t simBytes() { return sizeof(SimShared) + rtcSize(); }
+
+// --- scenario inputs, evaluated on the virtual clock -------------------------
+
+static int rainPin(uint64_t wallUs) {
+    for (const Scenario::Shower& s : scenario->showers) {
+        if (s.intervalS == 0) continue;
+        uint64_t startUs = (uint64_t)s.startS * 1000000ULL;
+        if (wallUs < startUs || wallUs >= (uint64_t)s.endS * 1000000ULL + SIM_TIP_PULSE_US) continue;
+        uint64_t phase = (wallUs - startUs) % ((uint64_t)s.intervalS * 1000000ULL);
+        if (phase < SIM_TIP_PULSE_US && wallUs - phase < (uint64_t)s.endS * 1000000ULL) return 0;
+    }
+    return 1;
+}
+
+// Tip times in seconds of simulated time, up to untilS
+static std::vector<uint32_t> tipTimes(uint32_t untilS) {
+    std::vector<uint32_t> tips;
+    for (const Scenario::Shower& s : scenario->showers) {
+        if (s.intervalS == 0) continue;
+        for (uint32_t t = s.startS; t < s.endS && t < untilS; t += s.intervalS) tips.push_back(t);
+    }
+    return tips;
+}
+
+static bool brokerUp() {
+    uint32_t s = (uint32_t)(fakeWallUs() / 1000000ULL);
+    return !(s >= scenario->brokerDownS && s < scenario->brokerUpS);
+}
+
+/**
+ * In a wake process: map the shared state and put the RTC memory back
+ * before the sketch's globals are constructed, as on the chip
+ */
+__attribute__((constructor(101))) static void restoreRtc() {
+    const char* fd = getenv("SIM_FD");
+    if (fd == nullptr) return;
+    simFd = atoi(fd);
+    sim = (SimShared*)mmap(nullptr, simBytes(), PROT_READ | PROT_WRITE, MAP_SHARED, simFd, 0);
+    if (sim == MAP_FAILED || sim->rtcSize != rtcSize()) _exit(2);
+    scenario = &scenarios[sim->scenario];
+    if (sim->rtcValid) memcpy(__start_rtc_data, sim->rtc, sim->rtcSize);
+    fakeUlpPin = rainPin;
+    fakeAdvanceMs(SIM_BOOT_MS);
+}
+
+// --- flash image ---------------------------------------------------------------
+
+static void put(std::string& out, const void* data, uint32_t length) {
+    out.append((const char*)&length, sizeof(length));
+    out.append((const char*)data, length);
+}
+
+static void saveFlash() {
+    std::string image;
+    for (const std::string& dir : fakeFs.dirs) put(image, dir.data(), dir.size());
+    put(image, "", 0);   // end of directories
+    for (auto& file : fakeFs.files) {
+        put(image, file.first.data(), file.first.size());
+        put(image, file.second.data(), file.second.size());
+    }
+    if (image.size() > SIM_FLASH_BYTES) {
+        fprintf(stderr, "flash image of %zu bytes does not fit\n", image.size());
+        _exit(2);
+    }
+    memcpy(sim->flash, image.data(), image.size());
+    sim->flashSize = image.size();
+}
+
+static std::string take(size_t& pos) {
+    uint32_t length;
+    memcpy(&length, sim->flash + pos, sizeof(length));
+    pos += sizeof(length);
+    std::string item((const char*)sim->flash + pos, length);
+    pos += length;
+    return item;
+}
+
+static void loadFlash() {
+    size_t pos = 0;
+    if (sim->flashSize == 0) return;
+    for (std::string dir = take(pos); !dir.empty(); dir = take(pos)) fakeFs.dirs.insert(dir);
+    while (pos < sim->flashSize) {
+        std::string path = take(pos);
+        std::string data = take(pos);
+        fakeFs.files[path].assign(data.begin(), data.end());
+    }
+}
+
+// --- one wake --------------------------------------------------------------------
+
+static void logPublish(const PubSubClient::Publish& p) {
+    uint32_t topicLength = p.topic.size(), length = p.payload.size();
+    uint64_t at = fakeWallUs();
+    size_t need = sizeof(at) + 2 * sizeof(uint32_t) + topicLength + length;
+    if (sim->logSize + need > SIM_LOG_BYTES) {
+        fprintf(stderr, "broker log full\n");
+        _exit(2);
+    }
+    uint8_t* out = sim->log + sim->logSize;
+    memcpy(out, &at, sizeof(at)); out += sizeof(at);
+    memcpy(out, &topicLength, sizeof(topicLength)); out += sizeof(topicLength);
+    memcpy(out, p.topic.data(), topicLength); out += topicLength;
+    memcpy(out, &length, sizeof(length)); out += sizeof(length);
+    memcpy(out, p.payload.data(), length);
+    sim->logSize += need;
+}
+
+/**
+ * esp_deep_sleep_start(): report the wake, sleep until the timer or a ULP
+ * wake, and hand the RTC memory to the next wake
+ */
+static void deepSleep() {
+    WakeRecord& wake = sim->wakes[sim->wakeCount];
+    wake.radio = WiFi.begins > 0;
+    for (const PubSubClient::Publish& p : pub.published) logPublish(p);
+    sim->wakeCount++;
+    saveFlash();
+
+    if (fakeTimerWakeupUs == 0) {
+        fprintf(stderr, "deep sleep without a timer wakeup\n");
+        _exit(2);
+    }
+    int ulpWakes = fakeUlp.wakes;
+    uint64_t wakeAt = fakeWallUs() + fakeTimerWakeupUs;
+    fakeWakeupCause = ESP_SLEEP_WAKEUP_TIMER;
+    while (fakeWallUs() < wakeAt) {
+        uint64_t left = (wakeAt - fakeWallUs() + 999) / 1000;
+        fakeAdvanceMs(left < SIM_SLEEP_STEP_MS ? (unsigned long)left : SIM_SLEEP_STEP_MS);
+        if (fakeUlpWakeupEnabled && fakeUlp.wakes != ulpWakes) {
+            fakeWakeupCause = ESP_SLEEP_WAKEUP_ULP;
+            break;
+        }
+    }
+    fakeTimerWakeupUs = 0;
+
+    sim->wallUs = fakeWallUs();
+    memcpy(sim->rtc, __start_rtc_data, sim->rtcSize);
+    sim->rtcValid = true;
+    fflush(stdout);
+    _exit(0);
+}
+
+static void boot() {
+    if (!sim->rtcValid) {
+        // power-on: the hardware the firmware finds
+        fakeOneWireAddProbe(1, 14.0f);
+    }
+    loadFlash();
+
+    fakePinLow[DEBUG_MODE_PIN] = true;   // jumper to GND: normal operation
+    fakeAnalogLevel[BATTERY_PIN] = SIM_BATTERY_LEVEL;
+    fakeDeepSleepHook = deepSleep;
+    pub.isConnected = false;
+    pub.connectMs = 30;
+    pub.reachable = [] { return WiFi.isConnected() && brokerUp(); };
+
+    sim->wakes[sim->wakeCount].cause = fakeWakeupCause;
+    setup();
+    loop();
+    fprintf(stderr, "loop() returned without deep sleep\n");
+    _exit(2);
+}
+
+/**
+ * Runs the sketch from power-on through the scenario
+ * @return false if a wake crashed or never slept
+ */
+static bool simulate(int index) {
+    const Scenario& s = scenarios[index];
+    scenario = &s;
+    sim->scenario = index;
+    sim->rtcValid = false;
+    sim->flashSize = 0;
+    sim->logSize = 0;
+    sim->wakeCount = 0;
+    sim->wallUs = 0;
+
+    char fd[16];
+    snprintf(fd, sizeof(fd), "%d", simFd);
+    while (sim->wallUs < (uint64_t)s.durationS * 1000000ULL) {
+        if (sim->wakeCount == SIM_MAX_WAKES) {
+            fprintf(stderr, "%s: more than %d wakes\n", s.name, SIM_MAX_WAKES);
+            return false;
+        }
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid == 0) {
+            setenv("SIM_FD", fd, 1);
+            execl("/proc/self/exe", "test_firmware", (char*)nullptr);
+            _exit(2);
+        }
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            fprintf(stderr, "%s: wake %zu failed (status %d)\n", s.name, sim->wakeCount, status);
+            return false;
+        }
+    }
+    // the device after its last wake, for checks on RTC state
+    memcpy(__start_rtc_data, sim->rtc, sim->rtcSize);
+    return true;
+}
+
+// --- what the broker saw ---------------------------------------------------------
+
+struct Received {
+    uint64_t atUs;
+    std::string topic;
+    std::string payload;
+};
+
+static std::vector<Received> brokerLog() {
+    std::vector<Received> log;
+    size_t pos = 0;
+    while (pos < sim->logSize) {
+        Received r;
+        uint32_t length;
+        memcpy(&r.atUs, sim->log + pos, sizeof(r.atUs)); pos += sizeof(r.atUs);
+        memcpy(&length, sim->log + pos, sizeof(length)); pos += sizeof(length);
+        r.topic.assign((const char*)sim->log + pos, length); pos += length;
+        memcpy(&length, sim->log + pos, sizeof(length)); pos += sizeof(length);
+        r.payload.assign((const char*)sim->log + pos, length); pos += length;
+        log.push_back(r);
+    }
+    return log;
+}
+
+struct Reading {
+    uint64_t receivedUs;
+    time_t ts;
+    double rain;            // < 0 if the record has none
+    bool soil, bmp, battery;
+};
+
+/**
+ * Flattens the sensor records of "backyard/test/" and "backyard/test/batch"
+ */
+static std::vector<Reading> readings(const std::vector<Received>& log) {
+    std::vector<Reading> out;
+    for (const Received& r : log) {
+        JsonDocument doc;
+        if (r.topic == topic) {
+            if (deserializeJson(doc, r.payload.data(), r.payload.size())) continue;
+        } else if (r.topic == std::string(topic) + "batch") {
+            if (!CompressedBatch::decode((const uint8_t*)r.payload.data(), r.payload.size(), doc)) continue;
+        } else {
+            continue;
+        }
+        JsonArray records = doc.as<JsonArray>();
+        for (size_t i = 0; i < records.size(); i++) {
+            JsonVariant record = records[i];
+            Reading reading;
+            reading.receivedUs = r.atUs;
+            reading.ts = record["ts"].as<long>();
+            reading.rain = record["rain"].isNull() ? -1 : record["rain"].as<double>();
+            reading.soil = !record["soil_temp"].isNull();
+            reading.bmp = !record["bmp_temperature"].isNull();
+            reading.battery = !record["battery"].isNull();
+            out.push_back(reading);
+        }
+    }
+    return out;
+}
+
+static time_t epochAt(uint64_t wallUs) { return fakeNtpEpoch + (time_t)(wallUs / 1000000ULL); }
+
+// --- scenarios -------------------------------------------------------------------
+
+/**
+ * A day with the broker up: a steady shower and a cloudburst. Every tip
+ * reaches the broker, in the totals and in the tip log with its time, and
+ * every sensor keeps its cadence with readings no older than the max latency.
+ */
+static void testDayWithShowers() {
+    const Scenario& day = scenarios[SCENARIO_DAY];
+    CHECK(simulate(SCENARIO_DAY));
+
+    std::vector<Received> log = brokerLog();
+    std::vector<Reading> all = readings(log);
+    std::vector<uint32_t> fired = tipTimes(day.durationS);
+
+    // rain totals add up to every tip
+    double inches = 0;
+    size_t soil = 0, bmp = 0, battery = 0;
+    bool stampsValid = true, inOrder = true;
+    time_t lastTs = 0;
+    unsigned long worstLatencyS = 0;
+    for (const Reading& r : all) {
+        if (r.rain > 0) inches += r.rain;
+        soil += r.soil;
+        bmp += r.bmp;
+        battery += r.battery;
+        if (r.ts < epochAt(0) || r.ts > epochAt(r.receivedUs)) stampsValid = false;
+        if (r.ts < lastTs) inOrder = false;
+        lastTs = r.ts;
+        unsigned long latency = (unsigned long)(epochAt(r.receivedUs) - r.ts);
+        if (latency > worstLatencyS) worstLatencyS = latency;
+    }
+    CHECK_EQ(lround(inches / unit_of_rain), fired.size());
+    CHECK(stampsValid);
+    CHECK(inOrder);
+    CHECK(worstLatencyS <= TX_MAX_LATENCY_MS / 1000 + 60);
+
+    // every sensor on its cadence, runs pulled forward by at most the
+    // tolerance: soil 120/30 s, BMP280 180/45 s, battery 300/120 s
+    CHECK(soil >= day.durationS / 120 * 9 / 10 && soil <= day.durationS / (120 - 30) + 1);
+    CHECK(bmp >= day.durationS / 180 * 9 / 10 && bmp <= day.durationS / (180 - 45) + 1);
+    CHECK(battery >= day.durationS / 300 * 9 / 10 && battery <= day.durationS / (300 - 120) + 1);
+
+    // the tip log has every tip, stamped within a second or two
+    size_t logged = 0, dropped = 0, badStamps = 0;
+    for (const Received& r : log) {
+        if (r.topic != std::string(topic) + "tips") continue;
+        JsonDocument doc;
+        if (deserializeJson(doc, r.payload.data(), r.payload.size())) continue;
+        time_t t = doc["t0"].as<long>();
+        JsonArray dt = doc["dt"].as<JsonArray>();
+        for (size_t i = 0; i < dt.size(); i++) {
+            t += dt[i].as<long>();
+            long tipS = (long)(t - fakeNtpEpoch);
+            if (logged >= fired.size() || labs(tipS - (long)fired[logged]) > 2) badStamps++;
+            logged++;
+        }
+        dropped += doc["dropped"].as<unsigned long>();
+    }
+    CHECK_EQ(logged + dropped, fired.size());
+    CHECK_EQ(badStamps, 0);
+
+    // the ULP counts the shower in sleep: far fewer wakes than tips, and
+    // the radio only on a fraction of the wakes
+    size_t radioWakes = 0, ulpWakes = 0;
+    for (size_t i = 0; i < sim->wakeCount; i++) {
+        radioWakes += sim->wakes[i].radio;
+        ulpWakes += sim->wakes[i].cause == ESP_SLEEP_WAKEUP_ULP;
+    }
+    printf("day: %zu wakes (%zu ULP), %zu with radio, %zu tips, %zu publishes\n",
+           sim->wakeCount, ulpWakes, radioWakes, fired.size(), log.size());
+    CHECK(sim->wakeCount < day.durationS / 60);
+    CHECK(radioWakes * 3 < sim->wakeCount);
+    CHECK(ulpWakes > 0);
+
+    // coalescing saves wakes, and the health reports carry both counts
+    size_t reports = 0;
+    unsigned long reportedSaved = 0, reportedSessions = 0;
+    for (const Received& r : log) {
+        JsonDocument doc;
+        if (r.topic != topic || deserializeJson(doc, r.payload.data(), r.payload.size())) continue;
+        JsonArray records = doc.as<JsonArray>();   // batched with the readings
+        for (size_t i = 0; i < records.size(); i++) {
+            JsonVariant record = records[i];
+            if (record["sensor_health"].isNull()) continue;
+            CHECK(record["wakes_saved"].as<unsigned long>() >= reportedSaved);
+            CHECK(record["radio_sessions"].as<unsigned long>() > reportedSessions);
+            reportedSaved = record["wakes_saved"].as<unsigned long>();
+            reportedSessions = record["radio_sessions"].as<unsigned long>();
+            reports++;
+        }
+    }
+    printf("day: %lu wakes saved by coalescing, %lu radio sessions, %zu health reports\n",
+           schedulerWakesSaved, transmitRadioSessions, reports);
+    CHECK(schedulerWakesSaved > 0);
+    CHECK_EQ(transmitRadioSessions, radioWakes);
+    CHECK_EQ(reports, day.durationS * 1000UL / SCHEDULER_HEALTH_REPORT_MS - 1);
+    CHECK(reportedSaved > 0 && reportedSaved <= schedulerWakesSaved);
+    CHECK(reportedSessions > 0 && reportedSessions < transmitRadioSessions);
+}
+
+/**
+ * Broker down for six hours: readings pile up in RTC, get compressed and
+ * spilled to flash, and all of them arrive once the broker is back.
+ */
+static void testBrokerOutage() {
+    const Scenario& outage = scenarios[SCENARIO_OUTAGE];
+    CHECK(simulate(SCENARIO_OUTAGE));
+
+    std::vector<Received> log = brokerLog();
+    std::vector<Reading> all = readings(log);
+    double inches = 0;
+    size_t soil = 0;
+    bool duringOutage = false;
+    for (const Reading& r : all) {
+        if (r.rain > 0) inches += r.rain;
+        soil += r.soil;
+    }
+    for (const Received& r : log) {
+        uint32_t atS = (uint32_t)(r.atUs / 1000000ULL);
+        if (atS >= outage.brokerDownS && atS < outage.brokerUpS) duringOutage = true;
+    }
+    printf("outage: %zu wakes, %zu publishes, %zu readings, %lu spilled to flash\n",
+           sim->wakeCount, log.size(), all.size(), (unsigned long)spillAppends);
+    CHECK(!duringOutage);
+    CHECK_EQ(lround(inches / unit_of_rain), tipTimes(outage.durationS).size());
+    CHECK(soil >= outage.durationS / 120 * 9 / 10);
+    CHECK(spillAppends > 0);
+    CHECK_EQ(spillDropped, 0);
+    CHECK_EQ(spillCount, 0);
+}
+
+int main() {
+    if (sim != nullptr) boot();   // a wake process
+
+    simFd = memfd_create("test_firmware", 0);
+    if (simFd < 0 || ftruncate(simFd, simBytes()) != 0) {
+        perror("memfd");
+        return 1;
+    }
+    sim = (SimShared*)mmap(nullptr, simBytes(), PROT_READ | PROT_WRITE, MAP_SHARED, simFd, 0);
+    if (sim == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    sim->rtcSize = rtcSize();
+
+    RUN(testDayWithShowers);
+    RUN(testBrokerOutage);
+    return checkFailures;
+}
@@ -0,0 +1,263 @@
+// FlashSpillLog on the in-memory LittleFS: spill and drain in FIFO order,
+// unreadable records and failed mounts that must not block the queue,
+// torn tails cut off at power-on recovery, dropping when full, and the
+// append/drain cost and block erases of spill bursts.
+
+#include "check.h"
+#include <chrono>
+#include "inc/FlashSpillLog.h"
+
+typedef MqttMessageQueue<2> SmallQueue;
+
+static void resetFlash() {
+    fakeFs = FakeFs();
+    spillMagic = 0;
+    spillAppends = spillDrained = spillDropped = spillUnreadable = 0;
+    spillSegmentsErased = spillBytesWritten = 0;
+}
+
+static JsonDocument reading(int value, size_t padding = 0) {
+    JsonDocument doc;
+    doc["v"] = value;
+    if (padding > 0) doc["pad"] = std::string(padding, 'x').c_str();
+    return doc;
+}
+
+static int valueOf(const MqttRecord& record) {
+    JsonDocument doc;
+    if (deserializeJson(doc, record.payload, record.length)) return -1;
+    return doc["v"].as<int>();
+}
+
+/**
+ * Pops everything and returns the values in drain order
+ */
+static std::vector<int> drain(SmallQueue& queue) {
+    std::vector<int> values;
+    MqttRecord record;
+    while (queue.peek(record)) {
+        values.push_back(valueOf(record));
+        queue.pop();
+    }
+    return values;
+}
+
+static std::string segmentName(uint32_t seq) {
+    char path[32];
+    snprintf(path, sizeof(path), SPILL_DIR "/%08lu.log", (unsigned long)seq);
+    return path;
+}
+
+static void testSpillAndDrainInOrder() {
+    resetFlash();
+    FlashSpillLog spill;
+    CHECK(spill.begin());
+    SmallQueue queue;
+    queue.setSpill(&spill);
+    for (int i = 0; i < 200; i++) CHECK(queue.enqueue("t/", reading(i, 40)));
+    CHECK_EQ(spill.count(), 198);
+    CHECK(spillLastSeq > spillFirstSeq);   // spans several segments
+
+    std::vector<int> values = drain(queue);
+    CHECK_EQ(values.size(), 200);
+    for (size_t i = 0; i < values.size(); i++) CHECK_EQ(values[i], (int)i);
+    CHECK_EQ(spill.count(), 0);
+    CHECK_EQ(fakeFs.files.size(), 0);      // drained segments deleted
+}
+
+/**
+ * Offsets of the records in a segment file, by walking their headers
+ */
+static std::vector<size_t> recordOffsets(const std::vector<uint8_t>& bytes) {
+    std::vector<size_t> offsets;
+    for (size_t at = 0; at + SPILL_HEADER_BYTES <= bytes.size(); ) {
+        offsets.push_back(at);
+        at += SPILL_HEADER_BYTES + bytes[at + 2] + (bytes[at] | bytes[at + 1] << 8);
+    }
+    return offsets;
+}
+
+static void testCorruptRecordIsSkipped() {
+    resetFlash();
+    FlashSpillLog spill;
+    CHECK(spill.begin());
+    SmallQueue queue;
+    queue.setSpill(&spill);
+    for (int i = 0; i < 200; i++) CHECK(queue.enqueue("t/", reading(i, 40)));
+
+    // zero topic length in the second record of the oldest segment
+    std::vector<uint8_t>& bytes = fakeFs.files[segmentName(spillFirstSeq)];
+    std::vector<size_t> offsets = recordOffsets(bytes);
+    size_t inFirst = offsets.size();
+    CHECK(inFirst > 2);
+    bytes[offsets[1] + 2] = 0;
+
+    Serial.output.clear();
+    std::vector<int> values = drain(queue);
+    CHECK_EQ(spill.count(), 0);
+    CHECK_EQ(spillUnreadable, inFirst - 1);
+    CHECK_EQ(values.size(), 200 - (inFirst - 1));
+    // primary records, the readable head of the segment, then the next segment
+    CHECK_EQ(values[2], 2);
+    CHECK_EQ(values[3], (int)(2 + inFirst));
+    CHECK_EQ(values.back(), 199);
+    CHECK(Serial.contains("unreadable"));
+}
+
+static void testMountFailureDoesNotBlock() {
+    resetFlash();
+    {
+        FlashSpillLog spill;
+        CHECK(spill.begin());
+        SmallQueue queue;
+        queue.setSpill(&spill);
+        for (int i = 0; i < 10; i++) CHECK(queue.enqueue("t/", reading(i)));
+        queue.pop();
+        queue.pop();
+    }
+
+    // next wake: RTC positions trusted, but the partition won't mount
+    fakeReboot();
+    fakeFs.mountFails = true;
+    FlashSpillLog spill;
+    CHECK(spill.begin());
+    SmallQueue queue;
+    queue.setSpill(&spill);
+    CHECK_EQ(queue.size(), 8);
+    MqttRecord record;
+    CHECK(!queue.peek(record));
+    CHECK_EQ(queue.size(), 0);
+    CHECK_EQ(spillUnreadable, 8);
+
+    // primary storage takes new messages again
+    CHECK(queue.enqueue("t/", reading(42)));
+    CHECK(queue.peek(record));
+    CHECK_EQ(valueOf(record), 42);
+}
+
+static void testTornTailCutOnRecovery() {
+    resetFlash();
+    {
+        FlashSpillLog spill;
+        CHECK(spill.begin());
+        SmallQueue queue;
+        queue.setSpill(&spill);
+        for (int i = 0; i < 5; i++) CHECK(queue.enqueue("t/", reading(i)));
+        spill.sync();
+    }
+    // power lost halfway through a fourth spilled record
+    std::vector<uint8_t>& bytes = fakeFs.files[segmentName(spillLastSeq)];
+    CHECK_EQ(recordOffsets(bytes).size(), 3);
+    size_t recordBytes = bytes.size() / 3;   // same length: single-digit values
+    bytes.insert(bytes.end(), bytes.begin(), bytes.begin() + recordBytes / 2);
+
+    fakeReboot();
+    spillMagic = 0;
+    FlashSpillLog spill;
+    CHECK(spill.begin());
+    CHECK_EQ(spill.count(), 3);
+    CHECK_EQ(spillWriteOffset, 3 * recordBytes);
+    CHECK_EQ(fakeFs.files[segmentName(spillLastSeq)].size(), 3 * recordBytes);
+    CHECK(Serial.contains("torn record"));
+
+    // an append after recovery stays readable
+    SmallQueue queue;
+    queue.setSpill(&spill);
+    CHECK(queue.enqueue("t/", reading(9)));
+    std::vector<int> values = drain(queue);
+    CHECK_EQ(values.size(), 4);
+    CHECK_EQ(values[2], 4);
+    CHECK_EQ(values[3], 9);
+    CHECK_EQ(spillUnreadable, 0);
+}
+
+static void testDropsOldestWhenFull() {
+    resetFlash();
+    FlashSpillLog spill;
+    CHECK(spill.begin());
+    SmallQueue queue;
+    queue.setSpill(&spill);
+    int n = 0;
+    while (spillDropped == 0) CHECK(queue.enqueue("t/", reading(n++, 100)));
+    CHECK(spillLastSeq - spillFirstSeq < SPILL_MAX_SEGMENTS);
+    CHECK_EQ(spillUnreadable, 0);
+
+    std::vector<int> values = drain(queue);
+    CHECK_EQ(values.size() + spillDropped, (size_t)n);
+    CHECK_EQ(values[2], (int)(2 + spillDropped));   // oldest spilled records went first
+}
+
+struct SpillCost {
+    double appendUs;        // host time per appended record
+    double drainUs;         // host time per drained record
+    long blockErases;
+    long commits;
+};
+
+/**
+ * Spills `records` messages in wakes of `perWake` appends, each wake
+ * ending with the sync() before deep sleep, then drains them all
+ */
+static SpillCost spillBursts(int records, int perWake) {
+    resetFlash();
+    FlashSpillLog spill;
+    CHECK(spill.begin());
+    JsonDocument doc = reading(1, 60);
+    char payload[MQTT_MAX_PAYLOAD_LENGTH];
+    size_t length = serializeJson(doc, payload, sizeof(payload));
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < records; i++) {
+        CHECK(spill.append("rain/", 5, payload, length, 1700000000 + i));
+        if ((i + 1) % perWake == 0) spill.sync();
+    }
+    spill.sync();
+    auto appended = std::chrono::steady_clock::now();
+    long erases = fakeFs.blockErases;
+    MqttRecord record;
+    int drained = 0;
+    while (spill.front(record)) {
+        spill.popFront();
+        drained++;
+    }
+    auto end = std::chrono::steady_clock::now();
+    CHECK_EQ(drained, records);
+    CHECK_EQ(spillDropped, 0);
+
+    SpillCost cost;
+    cost.appendUs = std::chrono::duration<double, std::micro>(appended - start).count() / records;
+    cost.drainUs = std::chrono::duration<double, std::micro>(end - appended).count() / records;
+    cost.blockErases = erases;
+    cost.commits = fakeFs.commits;
+    return cost;
+}
+
+static void testBurstAppendErases() {
+    const int records = 600;     // ~48 KB, inside SPILL_MAX_SEGMENTS
+    SpillCost perRecord = spillBursts(records, 1);
+    SpillCost burst = spillBursts(records, 12);
+    long blocks = (spillBytesWritten + SPILL_SEGMENT_BYTES - 1) / SPILL_SEGMENT_BYTES;
+    printf("sync per record: %.2f us/append, %.2f us/drain, %ld block erases, %ld commits\n",
+           perRecord.appendUs, perRecord.drainUs, perRecord.blockErases, perRecord.commits);
+    printf("sync per wake:   %.2f us/append, %.2f us/drain, %ld block erases, %ld commits "
+           "(%lu bytes, %ld blocks)\n",
+           burst.appendUs, burst.drainUs, burst.blockErases, burst.commits,
+           (unsigned long)spillBytesWritten, blocks);
+
+    // reopening a partly filled block copies it: about one erase per record
+    CHECK(perRecord.blockErases >= records * 9 / 10);
+    // held open: one erase per block filled, plus one per wake resuming a partial block
+    CHECK(burst.blockErases <= blocks + SPILL_MAX_SEGMENTS + records / 12);
+    CHECK(burst.blockErases * 8 < perRecord.blockErases);
+    CHECK(burst.commits * 8 < perRecord.commits);
+}
+
+int main() {
+    RUN(testSpillAndDrainInOrder);
+    RUN(testCorruptRecordIsSkipped);
+    RUN(testMountFailureDoesNotBlock);
+    RUN(testTornTailCutOnRecovery);
+    RUN(testDropsOldestWhenFull);
+    RUN(testBurstAppendErases);
+    return checkFailures;
+}
@@ -0,0 +1,167 @@
+// The same readings encoded the four ways the firmware can send them:
+// one JSON publish per record, a batched JSON array, a merged JSON
+// object and a batched MessagePack array. Reports payload, packet and
+// estimated wire bytes of each, checks their ordering, and round-trips
+// MessagePack records and batches back to the same values.
+//
+// Per-record publishes carry no "ts" (sendQueuedMessages() sends the
+// stored payload), so they are the smallest payloads but pay the TCP/IP
+// headers of one segment per reading.
+
+#include "check.h"
+#include "inc/Utils.h"
+
+#define TCP_IP_HEADER_BYTES 40      // IPv4 + TCP, no options
+#define TCP_MSS 1436
+
+int latest_Raincount = 0;
+
+typedef MqttMessageQueue<64> JsonQueue;
+typedef MqttMessageQueue<64, MqttSlotStorage<64>, MsgPackEncoder> MsgPackQueue;
+
+static const time_t T0 = 1700000000;
+
+struct Sizes {
+    size_t publishes;
+    size_t payload;     // payload bytes
+    size_t packets;     // PUBLISH packets: fixed header, topic, payload
+    size_t wire;        // packets plus the TCP/IP headers of their segments
+};
+
+static Sizes sizesOf(const PubSubClient& client) {
+    Sizes sizes = {client.published.size(), 0, 0, 0};
+    for (auto& p : client.published) {
+        size_t remaining = 2 + p.topic.size() + p.payload.size();
+        size_t lengthBytes = remaining < 128 ? 1 : remaining < 16384 ? 2 : 3;
+        sizes.payload += p.payload.size();
+        size_t packet = 1 + lengthBytes + remaining;
+        sizes.packets += packet;
+        sizes.wire += packet + TCP_IP_HEADER_BYTES * ((packet + TCP_MSS - 1) / TCP_MSS);
+    }
+    return sizes;
+}
+
+/**
+ * One wake's readings, all stamped with the wake's time
+ */
+template<class Queue>
+static void enqueueWake(Queue& queue, time_t ts, int wake) {
+    fakeSetEpoch(ts);
+    const char* fields[] = {"rain", "soil_temp", "bmp_temp", "bmp_pressure", "battery"};
+    float values[] = {0.02386f * (wake % 3), 71.6f + wake * 0.1f, 18.43f, 101325.8f - wake * 3, 3.912f};
+    for (int i = 0; i < 5; i++) {
+        JsonDocument doc;
+        doc[fields[i]] = values[i];
+        CHECK(queue.enqueue("raingauge/", doc));
+    }
+}
+
+static void report(const char* name, const Sizes& s) {
+    printf("  %-22s %3u publishes %5u payload %5u packet %5u wire bytes\n",
+           name, (unsigned)s.publishes, (unsigned)s.payload, (unsigned)s.packets, (unsigned)s.wire);
+}
+
+/**
+ * Publishes `wakes` wakes of readings each of the four ways
+ */
+static void encodeFourWays(int wakes, Sizes out[4]) {
+    JsonQueue perRecord, array, object;
+    MsgPackQueue msgpack;
+    for (int w = 0; w < wakes; w++) {
+        enqueueWake(perRecord, T0 + w * 300, w);
+        enqueueWake(array, T0 + w * 300, w);
+        enqueueWake(object, T0 + w * 300, w);
+        enqueueWake(msgpack, T0 + w * 300, w);
+    }
+    PubSubClient clients[4];
+    for (auto& c : clients) c.setBufferSize(MQTT_CLIENT_BUFFER_BYTES);
+    sendQueuedMessages(clients[0], perRecord);
+    sendBatchedMessages(clients[1], array);
+    sendBatchedMessages(clients[2], object, nullptr, BATCH_OBJECT);
+    sendBatchedMessages(clients[3], msgpack);
+    for (int i = 0; i < 4; i++) out[i] = sizesOf(clients[i]);
+
+    printf("%d wake(s), %d readings:\n", wakes, wakes * 5);
+    report("per-record JSON", out[0]);
+    report("JSON array", out[1]);
+    report("merged JSON object", out[2]);
+    report("MessagePack array", out[3]);
+    CHECK_EQ(perRecord.size() + array.size() + object.size() + msgpack.size(), 0);
+}
+
+static void testOneWake() {
+    Sizes s[4];
+    encodeFourWays(1, s);
+    CHECK_EQ(s[0].publishes, 5);
+    CHECK_EQ(s[1].publishes, 1);
+    CHECK(s[2].payload < s[1].payload);     // one "ts" instead of five
+    CHECK(s[1].wire < s[0].wire);
+    CHECK(s[2].wire < s[1].wire);
+    CHECK(s[3].payload < s[1].payload);
+}
+
+static void testOneHour() {
+    Sizes s[4];
+    encodeFourWays(12, s);
+    CHECK(s[1].wire < s[0].wire);
+    CHECK(s[2].payload == s[1].payload);    // timestamps differ: object falls back to the array
+    CHECK(s[3].payload * 10 < s[1].payload * 8);
+}
+
+static void testMsgPackRecordRoundTrip() {
+    MsgPackQueue queue;
+    fakeSetEpoch(T0);
+    JsonDocument doc;
+    doc["bmp_pressure"] = 101325.8f;
+    doc["count"] = 70000;
+    doc["delta"] = -200;
+    doc["ok"] = true;
+    doc["id"] = "gauge-1";
+    CHECK(queue.enqueue("raingauge/", doc));
+
+    MqttRecord record;
+    CHECK(queue.peek(record));
+    CHECK_STR(record.topic, "raingauge/msgpack");
+    CHECK((uint8_t)record.payload[0] == 0x85);             // fixmap of 5
+    JsonDocument back;
+    CHECK(!MsgPackEncoder::decode(back, record.payload, record.length));
+    CHECK_EQ(back["count"].as<long>(), 70000);
+    CHECK_EQ(back["delta"].as<int>(), -200);
+    CHECK(back["ok"].as<bool>());
+    CHECK_STR(back["id"].as<const char*>(), "gauge-1");
+    CHECK(back["bmp_pressure"].as<float>() == 101325.8f);
+}
+
+static void testMsgPackBatchRoundTrip() {
+    JsonQueue json;
+    MsgPackQueue msgpack;
+    for (int w = 0; w < 3; w++) {
+        enqueueWake(json, T0 + w * 300, w);
+        enqueueWake(msgpack, T0 + w * 300, w);
+    }
+    PubSubClient jsonClient, msgpackClient;
+    jsonClient.setBufferSize(MQTT_CLIENT_BUFFER_BYTES);
+    msgpackClient.setBufferSize(MQTT_CLIENT_BUFFER_BYTES);
+    sendBatchedMessages(jsonClient, json);
+    sendBatchedMessages(msgpackClient, msgpack);
+    CHECK_EQ(msgpackClient.published.size(), 1);
+
+    // the spliced MessagePack batch decodes to what the JSON batch says
+    const std::string& packed = msgpackClient.published[0].payload;
+    JsonDocument fromMsgPack, fromJson;
+    CHECK(!deserializeMsgPack(fromMsgPack, packed.data(), packed.size()));
+    CHECK(!deserializeJson(fromJson, jsonClient.published[0].payload.c_str()));
+    CHECK_EQ(fromMsgPack.size(), 15);
+    CHECK_STR(fakejson::text(fromMsgPack).c_str(), fakejson::text(fromJson).c_str());
+
+    // and is byte-identical to encoding that document directly
+    CHECK(fakejson::msgpack(fromMsgPack) == packed);
+}
+
+int main() {
+    RUN(testOneWake);
+    RUN(testOneHour);
+    RUN(testMsgPackRecordRoundTrip);
+    RUN(testMsgPackBatchRoundTrip);
+    return checkFailures;
+}
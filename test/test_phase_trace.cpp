@@ -0,0 +1,74 @@
+// PhaseTrace: the summary covers every wake since the previous one, with
+// percentiles within the 25% bucket resolution, and starts a new window.
+
+#include "check.h"
+#include "inc/PhaseTrace.h"
+#include "inc/MqttMessageQueue.h"
+
+static JsonDocument summary(MqttMessageQueue<4>& queue) {
+    MqttRecord record;
+    JsonDocument doc;
+    CHECK(queue.peek(record));
+    CHECK(!deserializeJson(doc, record.payload, record.length));
+    queue.pop();
+    return doc;
+}
+
+static void testWindowPercentiles() {
+    MqttMessageQueue<4> queue;
+    // 100 wakes, wifi takes 1..100 ms x 10: p50 ~ 500 ms, p95 ~ 950 ms
+    for (uint32_t i = 1; i <= 100; i++) {
+        PhaseTrace trace;
+        trace.onWake();
+        trace.record(PHASE_WIFI, 0, i * 10000);
+        trace.record(PHASE_AWAKE, 0, i * 10000 + 200000);
+    }
+    PhaseTrace trace;
+    CHECK(trace.reportDue(100));
+    CHECK(trace.publishSummary(&queue, "t/"));
+    CHECK(!trace.reportDue(1));
+
+    JsonDocument doc = summary(queue);
+    CHECK_EQ(doc["trace_wakes"].as<int>(), 100);
+    JsonObject wifi = doc["trace"]["wifi"].as<JsonObject>();
+    CHECK_EQ(wifi["n"].as<int>(), 100);
+    CHECK(wifi["p50"].as<int>() >= 500 && wifi["p50"].as<int>() <= 625);
+    CHECK(wifi["p95"].as<int>() >= 950 && wifi["p95"].as<int>() <= 1000);
+    CHECK_EQ(wifi["max"].as<int>(), 1000);
+    CHECK(doc["trace"]["ntp"].isNull());
+    CHECK_EQ(doc["trace"]["awake"]["n"].as<int>(), 100);
+}
+
+static void testNewWindowAfterSummary() {
+    MqttMessageQueue<4> queue;
+    PhaseTrace trace;
+    trace.onWake();
+    trace.record(PHASE_MQTT, 0, 5000000);
+    CHECK(trace.publishSummary(&queue, "t/"));
+    summary(queue);
+
+    trace.onWake();
+    trace.record(PHASE_MQTT, 0, 40000);
+    CHECK(trace.publishSummary(&queue, "t/"));
+    JsonDocument doc = summary(queue);
+    CHECK_EQ(doc["trace"]["mqtt"]["n"].as<int>(), 1);
+    CHECK_EQ(doc["trace"]["mqtt"]["max"].as<int>(), 40);
+    CHECK_EQ(doc["trace"]["mqtt"]["p95"].as<int>(), 40);
+}
+
+static void testLongSpansHitLastBucket() {
+    MqttMessageQueue<4> queue;
+    PhaseTrace trace;
+    trace.onWake();
+    trace.record(PHASE_SENSORS, 0, 90000000);   // 90 s, past the last bucket bound
+    CHECK(trace.publishSummary(&queue, "t/"));
+    JsonDocument doc = summary(queue);
+    CHECK_EQ(doc["trace"]["sensors"]["p50"].as<int>(), 90000);
+}
+
+int main() {
+    RUN(testWindowPercentiles);
+    RUN(testNewWindowAfterSummary);
+    RUN(testLongSpansHitLastBucket);
+    return checkFailures;
+}
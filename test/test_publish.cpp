@@ -0,0 +1,211 @@
+// sendBatchedMessages() against the recording PubSubClient fake: payload
+// layout of both batch formats, per-record timestamps, records spliced as
+// stored (strings with JSON syntax in them), batches split to fit the
+// publish buffer and the client buffer (which is never resized), each
+// batch sent in a single write, what stays queued
+// when the connection drops partway, and the single PINGREQ/PINGRESP
+// round-trip after the last batch that confirms delivery before messages
+// are popped, skipping unexpected packets on the way.
+
+#include "check.h"
+#include "inc/Utils.h"
+
+int latest_Raincount = 0;
+
+typedef MqttMessageQueue<20> Queue;
+
+static const time_t T0 = 1700000000;
+
+static void enqueueAt(Queue& queue, time_t ts, const char* field, int value) {
+    fakeSetEpoch(ts);
+    JsonDocument doc;
+    doc[field] = value;
+    CHECK(queue.enqueue("t/", doc));
+}
+
+static void testArrayKeepsTimestamps() {
+    Queue queue;
+    PubSubClient client;
+    enqueueAt(queue, T0, "rain", 1);
+    enqueueAt(queue, T0 + 1, "battery", 4);
+    PublishStats stats = sendBatchedMessages(client, queue);
+    CHECK_EQ(stats.messages, 2);
+    CHECK_EQ(client.published.size(), 1);
+    CHECK_STR(client.published[0].payload.c_str(),
+              "[{\"rain\":1,\"ts\":1700000000},{\"battery\":4,\"ts\":1700000001}]");
+    CHECK_EQ(queue.size(), 0);
+}
+
+static void testLargeBatchInOneWrite() {
+    Queue queue;
+    PubSubClient client;
+    client.setBufferSize(MQTT_CLIENT_BUFFER_BYTES);
+    for (int i = 0; i < 20; i++) enqueueAt(queue, T0 + i, "soil_temp", 70 + i);
+    sendBatchedMessages(client, queue);
+    CHECK_EQ(client.published.size(), 1);
+    CHECK_EQ(client.published[0].writes, 1);
+    CHECK(client.published[0].payload.size() > 256);   // past the default buffer
+    CHECK_EQ(client.getBufferSize(), MQTT_CLIENT_BUFFER_BYTES);
+    CHECK_EQ(queue.size(), 0);
+}
+
+static void testBatchesFitClientBuffer() {
+    Queue queue;
+    PubSubClient client;                                 // default 256 byte buffer
+    for (int i = 0; i < 20; i++) enqueueAt(queue, T0 + i, "soil_temp", 70 + i);
+    PublishStats stats = sendBatchedMessages(client, queue);
+    CHECK_EQ(stats.messages, 20);
+    CHECK(client.published.size() > 1);
+    for (auto& p : client.published) {
+        CHECK(MQTT_MAX_HEADER_SIZE + 2 + p.topic.size() + p.payload.size() <= 256);
+    }
+    CHECK_EQ(client.getBufferSize(), 256);
+}
+
+static void testObjectMergesSameTimestamp() {
+    Queue queue;
+    PubSubClient client;
+    enqueueAt(queue, T0, "rain", 1);
+    enqueueAt(queue, T0, "battery", 4);
+    sendBatchedMessages(client, queue, nullptr, BATCH_OBJECT);
+    CHECK_STR(client.published[0].payload.c_str(), "{\"rain\":1,\"battery\":4,\"ts\":1700000000}");
+}
+
+static void testObjectKeepsDifferentTimestamps() {
+    Queue queue;
+    PubSubClient client;
+    enqueueAt(queue, T0, "rain", 1);
+    enqueueAt(queue, T0 + 60, "battery", 4);
+    enqueueAt(queue, T0 + 120, "rain", 2);
+    sendBatchedMessages(client, queue, nullptr, BATCH_OBJECT);
+    CHECK_STR(client.published[0].payload.c_str(),
+              "[{\"rain\":1,\"ts\":1700000000},{\"battery\":4,\"ts\":1700000060},{\"rain\":2,\"ts\":1700000120}]");
+}
+
+static void testSplicesStoredText() {
+    Queue queue;
+    PubSubClient client;
+    fakeSetEpoch(T0);
+    JsonDocument doc;
+    doc["note"] = "a,\"b\":{c}";
+    doc["list"][0] = 1;
+    doc["list"][1]["x"] = "]";
+    CHECK(queue.enqueue("t/", doc));
+    enqueueAt(queue, T0, "rain", 2);
+    sendBatchedMessages(client, queue, nullptr, BATCH_OBJECT);
+    CHECK_STR(client.published[0].payload.c_str(),
+              "{\"note\":\"a,\\\"b\\\":{c}\",\"list\":[1,{\"x\":\"]\"}],\"rain\":2,\"ts\":1700000000}");
+}
+
+static void testBatchesFitPublishBuffer() {
+    Queue queue;
+    PubSubClient client;
+    client.setBufferSize(MQTT_CLIENT_BUFFER_BYTES);
+    for (int i = 0; i < 20; i++) {
+        fakeSetEpoch(T0 + i);
+        JsonDocument doc;
+        doc["v"] = i;
+        doc["pad"] = std::string(150, 'x').c_str();
+        CHECK(queue.enqueue("t/", doc));
+    }
+    PublishStats stats = sendBatchedMessages(client, queue);
+    CHECK_EQ(stats.messages, 20);
+    CHECK(client.published.size() > 1);
+    int next = 0;
+    for (auto& p : client.published) {
+        CHECK(p.payload.size() <= MQTT_PUBLISH_BUFFER_BYTES);
+        JsonDocument batch;
+        CHECK(!deserializeJson(batch, p.payload.c_str(), p.payload.size()));
+        for (size_t i = 0; i < batch.size(); i++) CHECK_EQ(batch[i]["v"].as<int>(), next++);
+    }
+    CHECK_EQ(next, 20);
+}
+
+static void testFailureKeepsQueued() {
+    Queue queue;
+    PubSubClient client;
+    client.failAfter = 0;
+    enqueueAt(queue, T0, "rain", 1);
+    PublishStats stats = sendBatchedMessages(client, queue);
+    CHECK_EQ(stats.messages, 0);
+    CHECK_EQ(queue.size(), 1);
+}
+
+static void testPopsOnlyConfirmed() {
+    Queue queue;
+    PubSubClient client;
+    WiFiClient link;
+    enqueueAt(queue, T0, "rain", 1);
+    enqueueAt(queue, T0, "battery", 4);
+    fakeSetEpoch(T0);
+    JsonDocument doc;
+    doc["soil_temp"] = 70;
+    CHECK(queue.enqueue("u/", doc));                      // second topic, second batch
+    PublishStats stats = sendBatchedMessages(client, queue, &link);
+    CHECK_EQ(client.published.size(), 2);
+    CHECK_EQ(stats.messages, 3);
+    CHECK(stats.confirmed);
+    CHECK_EQ(queue.size(), 0);
+    CHECK(link.sent == std::string("\xC0\x00", 2));     // one PINGREQ after the last batch
+    CHECK_EQ(link.inbound.size(), 0);                     // PINGRESP consumed
+}
+
+static void testConfirmsEarlierPublishes() {
+    Queue queue;
+    PubSubClient client;
+    WiFiClient link;
+    PublishStats stats = sendBatchedMessages(client, queue, &link, BATCH_ARRAY, true);
+    CHECK_EQ(client.published.size(), 0);
+    CHECK(stats.confirmed);
+    CHECK(link.sent == std::string("\xC0\x00", 2));
+}
+
+static void testConfirmSkipsUnexpectedPacket() {
+    PubSubClient client;
+    WiFiClient link;
+    link.inbound = std::string("\x30\x06\x00\x02t/\xD0\x00", 8);  // PUBLISH whose payload looks like PINGRESP
+    CHECK(confirmDelivery(client, link));
+    CHECK_EQ(link.inbound.size(), 0);
+    CHECK(Serial.contains("Skipping packet 0x30"));
+}
+
+static void testUnconfirmedStaysQueued() {
+    Queue queue;
+    PubSubClient client;
+    WiFiClient link;
+    link.answerPings = false;
+    enqueueAt(queue, T0, "rain", 1);
+    unsigned long start = millis();
+    PublishStats stats = sendBatchedMessages(client, queue, &link);
+    CHECK_EQ(client.published.size(), 1);   // written to the socket...
+    CHECK_EQ(stats.messages, 0);            // ...but not known to have arrived
+    CHECK_EQ(queue.size(), 1);
+    CHECK(millis() - start >= MQTT_CONFIRM_TIMEOUT_MS);
+    CHECK(Serial.contains("delivery unconfirmed"));
+}
+
+static void testConfirmFailsOnDroppedLink() {
+    PubSubClient client;
+    WiFiClient link;
+    link.rttMs = 500;
+    CHECK(confirmDelivery(client, link));
+    link.linkUp = false;
+    CHECK(!confirmDelivery(client, link));
+}
+
+int main() {
+    RUN(testArrayKeepsTimestamps);
+    RUN(testLargeBatchInOneWrite);
+    RUN(testBatchesFitClientBuffer);
+    RUN(testObjectMergesSameTimestamp);
+    RUN(testObjectKeepsDifferentTimestamps);
+    RUN(testSplicesStoredText);
+    RUN(testBatchesFitPublishBuffer);
+    RUN(testFailureKeepsQueued);
+    RUN(testPopsOnlyConfirmed);
+    RUN(testConfirmsEarlierPublishes);
+    RUN(testConfirmSkipsUnexpectedPacket);
+    RUN(testUnconfirmedStaysQueued);
+    RUN(testConfirmFailsOnDroppedLink);
+    return checkFailures;
+}
@@ -0,0 +1,272 @@
+// SensorScheduler across simulated deep sleep cycles: each wake builds a
+// new scheduler (RTC globals and the sensors' last-update times persist),
+// runs due sensors and sleeps for getNextWakeTime(). Also times those steps
+// against the number of registered sensors.
+
+#include <chrono>
+#include "check.h"
+#include "inc/SensorScheduler.h"
+#include "inc/MqttMessageQueue.h"
+
+class FakeSensor : public BaseSensor {
+public:
+    FakeSensor(const char* id, unsigned long interval, unsigned long tolerance = 0)
+        : id(id), interval(interval), tolerance(tolerance) {}
+
+    void begin() override { begins++; }
+    void handle() override { runs++; }
+    unsigned long getUpdateInterval() override { return interval; }
+    unsigned long getUpdateTolerance() override { return tolerance; }
+    bool needsUpdate() override { return false; }
+    bool isHealthy() override { return healthy; }
+    String getSensorId() override { return String(id); }
+    unsigned long* getLastUpdatePtr() override { return &lastUpdate; }
+
+    const char* id;
+    unsigned long interval;
+    unsigned long tolerance;
+    unsigned long lastUpdate = 0;   // stands in for the sensor's RTC variable
+    bool healthy = true;
+    int begins = 0;
+    int runs = 0;
+};
+
+static void resetRtc() {
+    schedulerLastWakeTime = 0;
+    schedulerSleepDuration = 0;
+    schedulerSleepStartUs = 0;
+    schedulerSensorWakes = 0;
+    schedulerCoalescedRuns = 0;
+    schedulerWakesSaved = 0;
+    schedulerSkippedCount = 0;
+    schedulerHealthChanged = false;
+    schedulerHealthReportedAt = 0;
+    memset(schedulerSensorFailures, 0, sizeof(schedulerSensorFailures));
+    memset(schedulerSensorFailedAt, 0, sizeof(schedulerSensorFailedAt));
+    fakeWakeupCause = ESP_SLEEP_WAKEUP_UNDEFINED;
+    fakeReboot();
+    fakeAdvanceMs(5);   // millis() at the first boot's scheduler construction
+}
+
+/**
+ * Runs one wake with the given sensors and returns the chosen sleep time;
+ * a rain alert after cutShortMs ends the following sleep early
+ */
+static unsigned long wake(std::vector<FakeSensor*> sensors, unsigned long* wakeTime = nullptr,
+                          unsigned long cutShortMs = ULONG_MAX) {
+    SensorScheduler scheduler;
+    for (FakeSensor* s : sensors) scheduler.addSensor(s);
+    scheduler.checkAndUpdateAll();
+    unsigned long sleepMs = scheduler.getNextWakeTime();
+    if (wakeTime) *wakeTime = scheduler.getCurrentWakeTime();
+    scheduler.prepareSleep(sleepMs);
+    fakeAdvanceMs(sleepMs < cutShortMs ? sleepMs : cutShortMs);
+    fakeReboot();
+    fakeWakeupCause = sleepMs <= cutShortMs ? ESP_SLEEP_WAKEUP_TIMER : ESP_SLEEP_WAKEUP_ULP;
+    return sleepMs;
+}
+
+static void testIntervals() {
+    resetRtc();
+    FakeSensor fast("fast", 60000), slow("slow", 300000);
+    unsigned long total = 0;
+    std::vector<unsigned long> slowRuns;
+    while (total < 3600000UL) {
+        total += wake({&fast, &slow});
+        if (slowRuns.empty() || slowRuns.back() != slow.lastUpdate) slowRuns.push_back(slow.lastUpdate);
+    }
+    CHECK_EQ(fast.runs, 60);
+    CHECK_EQ(slow.runs, 12);
+    for (size_t i = 1; i < slowRuns.size(); i++) {
+        CHECK_EQ(slowRuns[i] - slowRuns[i - 1], 300000);
+    }
+}
+
+static void testCoalescing() {
+    resetRtc();
+    // "drift" is due 5 s after "base" every time; its tolerance pulls it forward
+    FakeSensor base("base", 60000), drift("drift", 60000, 10000);
+    unsigned long now;
+    wake({&base, &drift});
+    drift.lastUpdate += 5000;
+    schedulerSensorWakes = 0;
+    schedulerCoalescedRuns = 0;
+    schedulerWakesSaved = 0;
+
+    unsigned long wakes = 0, total = 0;
+    while (total < 600000UL) {
+        total += wake({&base, &drift}, &now);
+        wakes++;
+    }
+    CHECK_EQ(wakes, 10);                 // one wake per minute, not two
+    CHECK_EQ(drift.runs, base.runs);
+    CHECK_EQ(schedulerCoalescedRuns, 1); // drift runs in step with base from then on
+    CHECK_EQ(schedulerWakesSaved, 1);
+}
+
+static void testCoalescingOntoExistingWake() {
+    resetRtc();
+    // "drift" is pulled into base's wake, but "fixed" wakes the device at
+    // drift's deadline anyway: runs are coalesced, no wake is saved
+    FakeSensor base("base", 60000), drift("drift", 60000, 10000), fixed("fixed", 60000);
+    wake({&base, &drift, &fixed});
+    drift.lastUpdate += 5000;
+    fixed.lastUpdate += 5000;
+    schedulerCoalescedRuns = 0;
+    schedulerWakesSaved = 0;
+
+    unsigned long wakes = 0, total = 0;
+    while (total < 600000UL) {
+        total += wake({&base, &drift, &fixed});
+        wakes++;
+    }
+    CHECK_EQ(wakes, 20);
+    CHECK(schedulerCoalescedRuns > 0);
+    CHECK_EQ(schedulerWakesSaved, 0);
+}
+
+static void testEarlyWakeUsesTimeSlept() {
+    resetRtc();
+    FakeSensor sensor("sensor", 60000);
+    unsigned long start, now;
+    wake({&sensor}, &start, 20000);   // rain alert 20 s into the 60 s sleep
+
+    unsigned long sleepMs = wake({&sensor}, &now);
+    CHECK_EQ(now - start, 20000);
+    CHECK_EQ(sensor.runs, 1);         // not due yet
+    CHECK_EQ(sleepMs, 40000);         // the rest of the interval
+
+    wake({&sensor}, &now);
+    CHECK_EQ(now - start, 60000);
+    CHECK_EQ(sensor.runs, 2);
+}
+
+static void testFaultBackoff() {
+    resetRtc();
+    FakeSensor good("good", 60000), bad("bad", 60000);
+    bad.healthy = false;
+
+    wake({&good, &bad});
+    CHECK_EQ(bad.begins, 1);
+    CHECK_EQ(bad.runs, 0);                // unhealthy after begin(): never handled
+    CHECK_EQ(schedulerSensorFailures[1], 1);
+    CHECK(schedulerHealthChanged);
+
+    // No begin() retry until SENSOR_RETRY_BASE_MS has passed
+    unsigned long total = 0;
+    while (total + 60000 < SENSOR_RETRY_BASE_MS) total += wake({&good, &bad});
+    CHECK_EQ(bad.begins, 1);
+    while (bad.begins == 1) total += wake({&good, &bad});
+    CHECK_EQ(schedulerSensorFailures[1], 2);
+
+    // Recovery clears the fault count
+    bad.healthy = true;
+    while (bad.runs == 0) wake({&good, &bad});
+    CHECK_EQ(schedulerSensorFailures[1], 0);
+}
+
+static void testHealthReport() {
+    resetRtc();
+    FakeSensor good("good", 60000), bad("bad", 60000);
+    bad.healthy = false;
+    SensorScheduler scheduler;
+    scheduler.addSensor(&good);
+    scheduler.addSensor(&bad);
+
+    MqttMessageQueue<4> queue;
+    schedulerWakesSaved = 4;
+    CHECK(scheduler.healthReportDue());
+    CHECK(scheduler.publishHealth(&queue, "t/", 7));
+    CHECK(!scheduler.healthReportDue());
+
+    MqttRecord record;
+    CHECK(queue.peek(record));
+    char expected[160];
+    snprintf(expected, sizeof(expected),
+             "{\"sensor_health\":{\"good\":{\"ok\":true},\"bad\":{\"ok\":false,\"faults\":1,\"retry_s\":%lu}},"
+             "\"wakes_saved\":4,\"radio_sessions\":7}",
+             SENSOR_RETRY_BASE_MS / 1000);
+    CHECK_STR(record.payload, expected);
+
+    // Repeated after SCHEDULER_HEALTH_REPORT_MS without a health change
+    fakeAdvanceMs(SCHEDULER_HEALTH_REPORT_MS);
+    SensorScheduler later;
+    later.addSensor(&good);
+    CHECK(later.healthReportDue());
+}
+
+struct SchedulerCost {
+    double setupUs;     // constructor and addSensor() calls, per wake
+    double updateUs;    // checkAndUpdateAll(), per wake
+    double nextUs;      // getNextWakeTime(), per wake
+    long wakes;
+    long runs;
+};
+
+/**
+ * Runs an hour of wakes with `count` sensors on staggered 1-5 minute
+ * intervals and times each step of the wake cycle
+ */
+static SchedulerCost scheduleHour(size_t count) {
+    resetRtc();
+    std::vector<FakeSensor> sensors;
+    sensors.reserve(count);
+    for (size_t i = 0; i < count; i++) sensors.emplace_back("probe", 60000 * (1 + i % 5));
+
+    using Clock = std::chrono::steady_clock;
+    Clock::duration setup{}, update{}, next{};
+    SchedulerCost cost = {};
+    unsigned long total = 0;
+    while (total < 3600000UL) {
+        Serial.output.clear();   // the fake keeps every log line
+        auto start = Clock::now();
+        SensorScheduler scheduler;
+        for (FakeSensor& s : sensors) scheduler.addSensor(&s);
+        auto added = Clock::now();
+        scheduler.checkAndUpdateAll();
+        auto updated = Clock::now();
+        unsigned long sleepMs = scheduler.getNextWakeTime();
+        auto end = Clock::now();
+        setup += added - start;
+        update += updated - added;
+        next += end - updated;
+
+        scheduler.prepareSleep(sleepMs);
+        fakeAdvanceMs(sleepMs);
+        fakeReboot();
+        fakeWakeupCause = ESP_SLEEP_WAKEUP_TIMER;
+        total += sleepMs;
+        cost.wakes++;
+    }
+    for (FakeSensor& s : sensors) cost.runs += s.runs;
+    cost.setupUs = std::chrono::duration<double, std::micro>(setup).count() / cost.wakes;
+    cost.updateUs = std::chrono::duration<double, std::micro>(update).count() / cost.wakes;
+    cost.nextUs = std::chrono::duration<double, std::micro>(next).count() / cost.wakes;
+    return cost;
+}
+
+static void testOverheadBySensorCount() {
+    printf("sensors  wakes   runs  setup us  update us  next us\n");
+    for (size_t count = 1; count <= 32; count *= 2) {
+        SchedulerCost cost = scheduleHour(count);
+        printf("%7u %6ld %6ld %9.2f %10.2f %8.3f\n", (unsigned)count, cost.wakes, cost.runs,
+               cost.setupUs, cost.updateUs, cost.nextUs);
+
+        // every interval is a multiple of a minute: one wake per minute
+        CHECK_EQ(cost.wakes, 60);
+        long expected = 0;
+        for (size_t i = 0; i < count; i++) expected += 60 / (1 + i % 5);
+        CHECK_EQ(cost.runs, expected);
+    }
+}
+
+int main() {
+    RUN(testIntervals);
+    RUN(testCoalescing);
+    RUN(testCoalescingOntoExistingWake);
+    RUN(testEarlyWakeUsesTimeSlept);
+    RUN(testFaultBackoff);
+    RUN(testHealthReport);
+    RUN(testOverheadBySensorCount);
+    return checkFailures;
+}
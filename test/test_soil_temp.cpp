@@ -0,0 +1,99 @@
+// Tempsensor on the host DS18B20 bus model: setting the resolution keeps
+// each probe's alarm bytes, survives a probe power cycle only when saved
+// to EEPROM, and the parasite-power wait follows the resolution read back
+// from the probes.
+
+#include "check.h"
+#include <PubSubClient.h>
+#include "inc/SoilTemp.h"
+
+typedef Tempsensor<MqttMessageQueue<4>> SoilSensor;
+
+static void resetBus(bool parasite) {
+    fakeOneWire = FakeOneWireBus();
+    fakeOneWire.parasite = parasite;
+    soilTempRomMagic = 0;
+    soilTempProbeCount = 0;
+    soilTempResolution = 0;
+    soilTempStableReads = 0;
+    fakeReboot();
+}
+
+/**
+ * Runs one handle() and returns how long it waited for the conversion
+ */
+static unsigned long conversionWaitMs(SoilSensor& sensor) {
+    unsigned long start = millis();
+    sensor.handle();
+    return millis() - start;
+}
+
+static void testKeepsAlarmBytes() {
+    resetBus(false);
+    int a = fakeOneWireAddProbe(1, 12.5f);
+    int b = fakeOneWireAddProbe(2, 14.0f);
+    fakeOneWire.probes[a].eeprom[0] = 0x19;   // TH 25 C
+    fakeOneWire.probes[a].eeprom[1] = 0x05;   // TL 5 C
+    fakeOneWirePowerCycle();
+
+    MqttMessageQueue<4> queue;
+    SoilSensor sensor(4, nullptr, &queue, "t/");
+    sensor.begin();
+    sensor.setResolution(10, true);
+    CHECK_EQ(soilTempResolution, 10);
+
+    // the EEPROM copy keeps every probe's own TH/TL next to the new config
+    fakeOneWirePowerCycle();
+    CHECK_EQ(fakeOneWire.probes[a].scratchpad[2], 0x19);
+    CHECK_EQ(fakeOneWire.probes[a].scratchpad[3], 0x05);
+    CHECK_EQ(fakeOneWire.probes[a].scratchpad[4], 0x3F);
+    CHECK_EQ(fakeOneWire.probes[b].scratchpad[2], 0x4B);
+    CHECK_EQ(fakeOneWire.probes[b].scratchpad[3], 0x46);
+    CHECK_EQ(fakeOneWire.probes[b].scratchpad[4], 0x3F);
+}
+
+static void testScratchpadOnlyChangeIsLostOnPowerCycle() {
+    resetBus(false);
+    fakeOneWireAddProbe(1, 12.5f);
+    MqttMessageQueue<4> queue;
+    SoilSensor sensor(4, nullptr, &queue, "t/");
+    sensor.begin();
+    int writes = fakeOneWire.eepromWrites;
+    sensor.setResolution(9, false);
+    CHECK_EQ(fakeOneWire.eepromWrites, writes);
+    CHECK_EQ(fakeOneWire.probes[0].scratchpad[4], 0x1F);
+
+    fakeOneWirePowerCycle();
+    CHECK_EQ(fakeOneWire.probes[0].scratchpad[4], (SOIL_TEMP_RESOLUTION - 9) << 5 | 0x1F);
+}
+
+static void testParasiteWaitFollowsReadBack() {
+    resetBus(true);
+    fakeOneWireAddProbe(1, 12.5f);
+    MqttMessageQueue<4> queue;
+    SoilSensor sensor(4, nullptr, &queue, "t/");
+    sensor.begin();
+
+    // stable readings: the next conversion drops to 10 bits, 188 ms with no busy signal
+    soilTempStableReads = SOIL_TEMP_STABLE_READS;
+    unsigned long waitMs = conversionWaitMs(sensor);
+    CHECK_EQ(soilTempResolution, SOIL_TEMP_STABLE_RESOLUTION);
+    CHECK(waitMs >= 188 && waitMs < 200);
+
+    // a probe that cannot be read leaves the resolution unknown: full wait
+    resetBus(true);
+    fakeOneWireAddProbe(1, 12.5f);
+    SoilSensor absent(4, nullptr, &queue, "t/");
+    absent.begin();
+    fakeOneWire.probes[0].rom[1] ^= 0xFF;      // Match ROM no longer answers
+    absent.setResolution(9, false);
+    CHECK_EQ(soilTempResolution, 0);
+    CHECK_EQ(absent.conversionTimeMs(), DS18B20_CONVERSION_MS);
+}
+
+int main() {
+    RUN(testKeepsAlarmBytes);
+    RUN(testScratchpadOnlyChangeIsLostOnPowerCycle);
+    RUN(testParasiteWaitFollowsReadBack);
+    return checkFailures;
+}
@@ -0,0 +1,100 @@
+// TransmitPolicy: transmit triggers, connection backoff doubling and its
+// cap, outage report, radio session count, and the deadline used to size the sleep.
+
+#include "check.h"
+#include "inc/TransmitPolicy.h"
+#include "inc/MqttMessageQueue.h"
+
+static const unsigned long MINUTE = 60000UL;
+
+static void resetRtc() {
+    transmitLastTime = 0;
+    transmitDone = false;
+    transmitSampleWakes = 0;
+    transmitFailures = 0;
+    transmitFailedAt = 0;
+    transmitOutageStart = 0;
+    transmitSkippedWakes = 0;
+    transmitRadioSessions = 0;
+}
+
+static void testTriggers() {
+    resetRtc();
+    TransmitPolicy policy(16, 15 * MINUTE);
+    CHECK(policy.transmitDue(0, 1000, false));          // first transmit
+    policy.markTransmitted(1000);
+
+    CHECK(!policy.transmitDue(15, 2 * MINUTE, false));
+    CHECK(policy.transmitDue(16, 2 * MINUTE, false));   // watermark
+    CHECK(policy.transmitDue(1, 2 * MINUTE, true));     // priority data
+    CHECK(!policy.transmitDue(0, 20 * MINUTE, false));  // nothing buffered
+    CHECK(policy.transmitDue(1, 1000 + 15 * MINUTE, false)); // max latency
+}
+
+static void testBackoffDoublesUpToCap() {
+    resetRtc();
+    TransmitPolicy policy(16, 15 * MINUTE);
+    policy.markTransmitted(0);
+
+    unsigned long now = MINUTE;
+    policy.markFailed(now);
+    CHECK_EQ(policy.backoffMs(), 0);                    // below TX_BACKOFF_AFTER_FAILURES
+    policy.markFailed(now);
+    CHECK_EQ(policy.backoffMs(), TX_BACKOFF_BASE_MS);
+    CHECK(policy.inBackoff(now + TX_BACKOFF_BASE_MS - 1));
+    CHECK(!policy.inBackoff(now + TX_BACKOFF_BASE_MS));
+
+    policy.markFailed(now);
+    CHECK_EQ(policy.backoffMs(), 2 * TX_BACKOFF_BASE_MS);
+    for (int i = 0; i < 20; i++) policy.markFailed(now);
+    CHECK_EQ(policy.backoffMs(), TX_BACKOFF_MAX_MS);
+
+    // A priority transmit is held back too, and counted as skipped
+    CHECK(!policy.transmitDue(1, now + MINUTE, true));
+    CHECK_EQ(transmitSkippedWakes, 1);
+    CHECK(policy.transmitDue(1, now + TX_BACKOFF_MAX_MS, true));
+}
+
+static void testOutageReport() {
+    resetRtc();
+    TransmitPolicy policy(16, 15 * MINUTE);
+    policy.markTransmitted(0);
+    policy.markFailed(MINUTE);
+    policy.markFailed(2 * MINUTE);
+    policy.transmitDue(1, 3 * MINUTE, true);             // skipped by backoff
+    CHECK(policy.outageReportDue());
+
+    MqttMessageQueue<4> queue;
+    CHECK(policy.publishOutage(&queue, "t/", 10 * MINUTE));
+    MqttRecord record;
+    CHECK(queue.peek(record));
+    CHECK_STR(record.payload, "{\"outage\":{\"duration_s\":540,\"failed_wakes\":2,\"skipped_wakes\":1}}");
+
+    policy.markTransmitted(10 * MINUTE);
+    CHECK(!policy.outageReportDue());
+    CHECK_EQ(transmitSkippedWakes, 0);
+    CHECK_EQ(policy.radioSessions(), 4);                  // the skipped wake brought up no radio
+}
+
+static void testDeadline() {
+    resetRtc();
+    TransmitPolicy policy(16, 15 * MINUTE);
+    CHECK_EQ(policy.timeUntilDeadline(3, 0), ULONG_MAX); // never transmitted
+    policy.markTransmitted(0);
+    CHECK_EQ(policy.timeUntilDeadline(0, MINUTE), ULONG_MAX);
+    CHECK_EQ(policy.timeUntilDeadline(3, MINUTE), 14 * MINUTE);
+
+    // Overdue and backing off: wake for the next probe
+    policy.markFailed(16 * MINUTE);
+    policy.markFailed(16 * MINUTE);
+    CHECK_EQ(policy.timeUntilDeadline(3, 17 * MINUTE), TX_BACKOFF_BASE_MS - MINUTE);
+    CHECK_EQ(policy.timeUntilDeadline(3, 16 * MINUTE + TX_BACKOFF_BASE_MS), ULONG_MAX);
+}
+
+int main() {
+    RUN(testTriggers);
+    RUN(testBackoffDoublesUpToCap);
+    RUN(testOutageReport);
+    RUN(testDeadline);
+    return checkFailures;
+}
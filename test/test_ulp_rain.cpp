@@ -0,0 +1,215 @@
+// UlpRainCounter running on the host ULP model: debouncing of the rain
+// pin, tip timestamps, survival of the program and the RTC IO setup across
+// deep sleep, the alert wake and its rate gate, the rain rate from tip
+// intervals, interrupt-path tips kept across sleep, and Raingauge leaving
+// the pad to the ULP.
+
+#include "check.h"
+#include <PubSubClient.h>
+#include "inc/Rain.h"
+
+static const time_t T0 = 1700000000;
+
+static void coldBoot() {
+    memset(fakeRtcSlowMem, 0, sizeof(fakeRtcSlowMem));
+    fakeUlp = FakeUlp();
+    fakeRtcGpio = FakeRtcGpio();
+    memset(fakePinModeCalls, 0, sizeof(fakePinModeCalls));
+    fakeWakeupCause = ESP_SLEEP_WAKEUP_UNDEFINED;
+    fakeReboot();
+}
+
+static void deepSleep() {
+    fakeReboot();
+    fakeWakeupCause = ESP_SLEEP_WAKEUP_TIMER;
+}
+
+/**
+ * Holds the rain pin LOW for lowMs, then HIGH for highMs
+ */
+static void pulse(unsigned long lowMs, unsigned long highMs = 200) {
+    fakeUlp.pinLevel = 0;
+    fakeUlpRunFor(lowMs);
+    fakeUlp.pinLevel = 1;
+    fakeUlpRunFor(highMs);
+}
+
+static void testCountsDebouncedTips() {
+    coldBoot();
+    UlpRainCounter counter(GPIO_NUM_27);
+    CHECK(counter.begin());
+    CHECK_EQ(fakeUlp.loads, 1);
+    CHECK_EQ(fakeUlp.periodUs, ULP_RAIN_PERIOD_US);
+
+    pulse(80);
+    CHECK_EQ(counter.takeTips(), 1);
+
+    // contact bounce shorter than the debounce window is not a tip
+    for (int i = 0; i < 5; i++) pulse(ULP_RAIN_PERIOD_US / 1000, ULP_RAIN_PERIOD_US / 1000);
+    fakeUlpRunFor(200);
+    CHECK_EQ(counter.pendingTips(), 0);
+
+    // a tip that bounces on closing still counts once
+    pulse(10, 10);
+    pulse(60);
+    for (int i = 0; i < 2; i++) pulse(50);
+    CHECK_EQ(counter.takeTips(), 3);
+    CHECK_EQ(counter.takeTips(), 0);
+}
+
+static void testTipTimes() {
+    coldBoot();
+    fakeSetEpoch(T0);
+    UlpRainCounter counter(GPIO_NUM_27);
+    CHECK(counter.begin());
+    fakeUlpRunFor(5000);
+    pulse(80);                    // tip at ~T0 + 5 s
+    fakeUlpRunFor(60000);
+    pulse(80);                    // tip at ~T0 + 65 s
+    fakeUlpRunFor(30000);
+
+    time_t times[4];
+    uint16_t timed;
+    CHECK_EQ(counter.takeTips(times, 4, timed), 2);
+    CHECK_EQ(timed, 2);
+    CHECK(labs((long)(times[0] - (T0 + 5))) <= 1);
+    CHECK(labs((long)(times[1] - (T0 + 65))) <= 1);
+}
+
+static void testWarmWakeReappliesPin() {
+    coldBoot();
+    {
+        UlpRainCounter counter(GPIO_NUM_27);
+        CHECK(counter.begin());
+        CHECK(fakeRtcGpio.held);
+        pulse(80);
+    }
+    // the pad lost its configuration while the CPU was awake
+    fakeRtcGpio.pullup = false;
+    fakeRtcGpio.held = false;
+    deepSleep();
+    fakeUlpRunFor(1000);
+
+    UlpRainCounter counter(GPIO_NUM_27);
+    CHECK(counter.begin());
+    CHECK_EQ(fakeUlp.loads, 1);   // program kept running
+    CHECK_EQ(fakeRtcGpio.inits, 2);
+    CHECK(fakeRtcGpio.pullup);
+    CHECK(fakeRtcGpio.held);
+    CHECK(!fakeRtcGpio.configuredWhileHeld);
+    CHECK_EQ(counter.takeTips(), 1);
+}
+
+static void testAlertWakesCpu() {
+    coldBoot();
+    UlpRainCounter counter(GPIO_NUM_27);
+    CHECK(counter.begin());
+    counter.armAlert(2);
+    pulse(80);
+    CHECK_EQ(fakeUlp.wakes, 0);
+    pulse(80);
+    CHECK_EQ(fakeUlp.wakes, 1);
+    pulse(80);
+    CHECK_EQ(fakeUlp.wakes, 1);   // once per arm
+
+    CHECK_EQ(counter.takeTips(), 3);
+    counter.armAlert(0);
+    for (int i = 0; i < 3; i++) pulse(80);
+    CHECK_EQ(fakeUlp.wakes, 1);
+}
+
+static void testAlertNeedsHeavyRate() {
+    coldBoot();
+    fakeSetEpoch(T0);
+    latest_Raincount = 0;
+    MqttMessageQueue<4> queue;
+    Raingauge<MqttMessageQueue<4>> rain(GPIO_NUM_27, nullptr, &queue, "t/");
+    rain.begin();
+    for (int i = 0; i < RAIN_ALERT_MIN_TIPS; i++) pulse(80);
+
+    rainLastReadTime = time(nullptr) - 60;    // 3 tips in a minute: 180/h
+    CHECK(rain.needsUpdate());
+    rainLastReadTime = time(nullptr) - 600;   // 3 tips in ten minutes: drizzle
+    CHECK(!rain.needsUpdate());
+    rainLastReadTime = 0;
+}
+
+static void testRateFromTipIntervals() {
+    coldBoot();
+    fakeSetEpoch(T0);
+    latest_Raincount = 0;
+    rainLastReadTime = 0;
+    rainLastTipTime = 0;
+    rainTipIntervalMs = 0;
+    MqttMessageQueue<4> queue;
+    Raingauge<MqttMessageQueue<4>> rain(GPIO_NUM_27, nullptr, &queue, "t/");
+    rain.begin();
+
+    // a tip every 10 s: 360/h, reported at the intense cadence
+    for (int i = 0; i < 6; i++) {
+        pulse(80);
+        fakeUlpRunFor(10000 - 280);
+    }
+    rain.handle();
+    CHECK(rainRateTipsPerHour >= 300 && rainRateTipsPerHour <= 400);
+    CHECK_EQ(rain.getUpdateInterval(), RAIN_INTERVAL_INTENSE_MS);
+
+    // no tip for a minute: the rate decays with the time since the last tip
+    fakeUlpRunFor(60000);
+    rain.handle();
+    CHECK(rainRateTipsPerHour > 0 && rainRateTipsPerHour < 60);
+    CHECK_EQ(rain.getUpdateInterval(), RAIN_INTERVAL_MS);
+
+    // the next tip after the shower gap has no rate until a second one
+    fakeUlpRunFor(RAIN_SHOWER_GAP_S * 1000UL);
+    pulse(80);
+    rain.handle();
+    CHECK_EQ(rainRateTipsPerHour, 0);
+    CHECK_EQ(rainTipIntervalMs, 0);
+    rainLastReadTime = 0;
+}
+
+static void testInterruptTipsSurviveSleep() {
+    coldBoot();
+    latest_Raincount = 0;
+    rainPendingTips = 0;
+    MqttMessageQueue<4> queue;
+    {
+        Raingauge<MqttMessageQueue<4>> rain(GPIO_NUM_27, nullptr, &queue, "t/");
+        rain.takePendingTips();
+        fakeAdvanceMs(200);
+        rain.isr();                   // tips after the last take, right before sleep
+        fakeAdvanceMs(200);
+        rain.isr();
+    }
+    deepSleep();
+    Raingauge<MqttMessageQueue<4>> rain(GPIO_NUM_27, nullptr, &queue, "t/");
+    rain.takePendingTips();
+    CHECK_EQ(latest_Raincount, 2);
+    CHECK_EQ(rainPendingTips.load(), 0);
+}
+
+static void testRaingaugeLeavesPinToUlp() {
+    coldBoot();
+    MqttMessageQueue<4> queue;
+    for (int boot = 0; boot < 2; boot++) {
+        Raingauge<MqttMessageQueue<4>> rain(GPIO_NUM_27, nullptr, &queue, "t/");
+        rain.begin();
+        deepSleep();
+    }
+    CHECK_EQ(fakePinModeCalls[GPIO_NUM_27], 0);
+    CHECK_EQ(fakeRtcGpio.inits, 2);
+    CHECK(fakeRtcGpio.held);
+}
+
+int main() {
+    RUN(testCountsDebouncedTips);
+    RUN(testTipTimes);
+    RUN(testWarmWakeReappliesPin);
+    RUN(testAlertWakesCpu);
+    RUN(testAlertNeedsHeavyRate);
+    RUN(testRateFromTipIntervals);
+    RUN(testInterruptTipsSurviveSleep);
+    RUN(testRaingaugeLeavesPinToUlp);
+    return checkFailures;
+}